@@ -0,0 +1,780 @@
+// Benchmark suite of the scanner, the compiler, the interpreter and the memory layer (target blissx_bench)
+// Every input is generated deterministically (see Corpus), so results can be compared between commits and machines
+// Usage : blissx_bench [--json] [--quick] [--filter text]
+//  --json : machine readable results on stdout, instead of the table
+//  --quick : shorter measures, for a smoke run
+//  --filter : only the benchmarks whose name contains text
+
+#include "Corpus.hpp"
+
+#include "AotScript.hpp"
+#include "BatchEvaluator.hpp"
+#include "Debug.hpp"
+#include "Snapshot.hpp"
+#include "TypeInference.hpp"
+#include "Verifier.hpp"
+#include "VirtualMachine.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(BLISSX_DISPATCH_TAIL_CALL)
+    #define DISPATCH_NAME "tail-call"
+#elif defined(BLISSX_DISPATCH_COMPUTED_GOTO)
+    #define DISPATCH_NAME "computed-goto"
+#else
+    #define DISPATCH_NAME "switch"
+#endif
+
+#ifdef BLISSX_TOS_CACHING
+    #define TOS_CACHING true
+#else
+    #define TOS_CACHING false
+#endif
+
+// Translation of bench/Damage.bx, generated by the build
+extern const AotDefinition benchDamage;
+
+#ifdef __VERSION__
+    #define COMPILER_VERSION __VERSION__
+#else
+    #define COMPILER_VERSION "unknown"
+#endif
+
+namespace
+{
+    // Results written here can't be optimized away
+    volatile std::uint64_t gSink;
+
+    struct Result
+    {
+        std::string name;
+        const char* unit;
+        double value;
+        // Bytes processed per second, 0 when it doesn't apply
+        double bytesPerSecond;
+        std::uint64_t iterations;
+    };
+
+    struct Options
+    {
+        bool json = false;
+        bool quick = false;
+        const char* filter = nullptr;
+    };
+
+    class Suite
+    {
+        public:
+            Suite(const Options& options)
+                : mOptions(options)
+            {
+            }
+
+            bool enabled(const char* name) const
+            {
+                return mOptions.filter == nullptr || strstr(name, mOptions.filter) != nullptr;
+            }
+
+            // function runs one iteration, doing 'work' units of work (and 'bytes' bytes of input if not 0)
+            // The reported value is the best batch, in nanoseconds per unit of work
+            template <typename F>
+            void measure(const char* name, const char* unit, double work, double bytes, F function)
+            {
+                if (!enabled(name)) return;
+
+                const double batchSeconds = mOptions.quick ? 0.005 : 0.05;
+                const int batchCount = mOptions.quick ? 3 : 7;
+
+                function();
+
+                std::uint64_t iterations = 1;
+                for (;;)
+                {
+                    double seconds = time(function, iterations);
+                    if (seconds >= batchSeconds) break;
+                    iterations *= seconds <= 0.0 ? 10 : std::max<std::uint64_t>(2, (std::uint64_t)(batchSeconds / seconds) + 1);
+                }
+
+                double best = 0.0;
+                for (int i = 0; i < batchCount; i++)
+                {
+                    double seconds = time(function, iterations) / (double)iterations;
+                    if (i == 0 || seconds < best) best = seconds;
+                }
+
+                Result result;
+                result.name = name;
+                result.unit = unit;
+                result.value = best * 1e9 / work;
+                result.bytesPerSecond = bytes > 0.0 ? bytes / best : 0.0;
+                result.iterations = iterations * (std::uint64_t)batchCount;
+                mResults.push_back(result);
+
+                if (!mOptions.json)
+                {
+                    if (result.bytesPerSecond > 0.0)
+                    {
+                        printf("%-28s %12.3f %-18s %10.2f MB/s\n", name, result.value, unit, result.bytesPerSecond / (1024.0 * 1024.0));
+                    }
+                    else
+                    {
+                        printf("%-28s %12.3f %s\n", name, result.value, unit);
+                    }
+                    fflush(stdout);
+                }
+            }
+
+            void report() const
+            {
+                if (!mOptions.json) return;
+
+                printf("{\n  \"configuration\": {\"dispatch\": \"%s\", \"tosCaching\": %s, \"compiler\": \"%s\"},\n",
+                    DISPATCH_NAME, TOS_CACHING ? "true" : "false", COMPILER_VERSION);
+                printf("  \"benchmarks\": [\n");
+                for (std::size_t i = 0; i < mResults.size(); i++)
+                {
+                    const Result& result = mResults[i];
+                    printf("    {\"name\": \"%s\", \"unit\": \"%s\", \"value\": %.6g, \"bytesPerSecond\": %.6g, \"iterations\": %llu}%s\n",
+                        result.name.c_str(), result.unit, result.value, result.bytesPerSecond, (unsigned long long)result.iterations,
+                        i + 1 < mResults.size() ? "," : "");
+                }
+                printf("  ]\n}\n");
+            }
+
+        private:
+            template <typename F>
+            static double time(F& function, std::uint64_t iterations)
+            {
+                auto begin = std::chrono::steady_clock::now();
+                for (std::uint64_t i = 0; i < iterations; i++)
+                {
+                    function();
+                }
+                auto end = std::chrono::steady_clock::now();
+                return std::chrono::duration<double>(end - begin).count();
+            }
+
+        private:
+            Options mOptions;
+            std::vector<Result> mResults;
+    };
+
+    std::size_t countInstructions(const Chunk& chunk, std::uint8_t only = Chunk::Op_Count)
+    {
+        std::size_t count = 0;
+        for (std::size_t offset = 0; offset < chunk.size(); offset += Chunk::getInstructionLength(chunk.getCode(offset)))
+        {
+            if (only == Chunk::Op_Count || chunk.getCode(offset) == only) count++;
+        }
+        return count;
+    }
+
+    bool compile(VirtualMachine& virtualMachine, const std::string& source, Chunk* chunk)
+    {
+        if (virtualMachine.compile(source.c_str(), chunk) != VirtualMachine::Interpret_Ok)
+        {
+            fprintf(stderr, "bench: compile error in\n%s\n", source.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    double increment(double value)
+    {
+        return value + 1.0;
+    }
+
+    void scannerBenchmarks(Suite& suite)
+    {
+        std::string source = Corpus::generateSource(1, 1024 * 1024);
+
+        std::size_t tokens = 0;
+        Scanner scanner;
+        scanner.newSource(source.c_str());
+        while (scanner.scanToken().type != Token::Type::Token_EndOfFile)
+        {
+            tokens++;
+        }
+
+        suite.measure("scanner/scanToken", "ns/token", (double)tokens, (double)source.size(), [&]()
+        {
+            Scanner scanner;
+            scanner.newSource(source.c_str());
+            std::uint64_t sum = 0;
+            for (;;)
+            {
+                Token token = scanner.scanToken();
+                sum += token.length;
+                if (token.type == Token::Type::Token_EndOfFile) break;
+            }
+            gSink = sum;
+        });
+
+        TokenStream stream;
+        suite.measure("scanner/tokenize", "ns/token", (double)tokens, (double)source.size(), [&]()
+        {
+            stream.tokenize(source.c_str());
+            gSink = stream.size();
+        });
+
+        // Localized text : mostly non ASCII string literals with a few escapes, scanned then decoded
+        std::string strings;
+        std::size_t literals = 0;
+        while (strings.size() < 1024 * 1024)
+        {
+            strings += "\"Ça coûte " + std::to_string(literals) + " € — 残り時間 \\u{23F3} : Привет\\n\"\n";
+            literals++;
+        }
+        std::vector<char> decoded;
+        suite.measure("scanner/strings", "ns/literal", (double)literals, (double)strings.size(), [&]()
+        {
+            Scanner scanner;
+            scanner.newSource(strings.c_str());
+            std::uint64_t sum = 0;
+            for (;;)
+            {
+                Token token = scanner.scanToken();
+                if (token.type != Token::Type::Token_String) break;
+                decoded.resize((std::size_t)token.decodedLength);
+                Scanner::decodeString(token, decoded.data());
+                sum += decoded.size();
+            }
+            gSink = sum;
+        });
+    }
+
+    void compilerBenchmarks(Suite& suite, const std::vector<std::string>& corpus)
+    {
+        std::size_t bytes = 0;
+        for (const std::string& script : corpus)
+        {
+            bytes += script.size();
+        }
+
+        Compiler compiler;
+        Chunk chunk;
+        suite.measure("compiler/compile", "ns/KB", (double)bytes / 1024.0, (double)bytes, [&]()
+        {
+            for (const std::string& script : corpus)
+            {
+                chunk.clear();
+                gSink = compiler.compile(script.c_str(), &chunk);
+            }
+        });
+    }
+
+    // vm/<name> interprets the chunk, jit/<name> executes its native code
+    void executeBenchmark(Suite& suite, const char* name, const std::string& source, const Environment* environment = nullptr)
+    {
+        for (bool jit : { false, true })
+        {
+            std::string fullName = (jit ? "jit/" : "vm/") + std::string(name);
+            if (!suite.enabled(fullName.c_str())) continue;
+
+            VirtualMachine virtualMachine;
+            virtualMachine.setEnvironment(environment);
+            virtualMachine.setJitEnabled(jit);
+            virtualMachine.setJitThreshold(0);
+            Chunk chunk;
+            if (!compile(virtualMachine, source, &chunk)) return;
+
+            suite.measure(fullName.c_str(), "ns/instruction", (double)countInstructions(chunk), 0.0, [&]()
+            {
+                gSink = virtualMachine.execute(chunk);
+            });
+        }
+    }
+
+    // 501 instructions of mixed arithmetic
+    std::string arithmeticSource()
+    {
+        static const char* const operators[] = { " + ", " * ", " - ", " / " };
+        std::string arithmetic = "1.5";
+        for (int i = 0; i < 250; i++)
+        {
+            arithmetic += operators[i % 4];
+            arithmetic += std::to_string(i % 7 + 2);
+        }
+        return arithmetic;
+    }
+
+    void vmBenchmarks(Suite& suite)
+    {
+        executeBenchmark(suite, "arithmetic", arithmeticSource());
+
+        static const char* const comparisons[] = { " < ", " >= ", " > ", " <= " };
+        std::string comparison = "(1 < 2)";
+        for (int i = 0; i < 120; i++)
+        {
+            comparison += i % 2 ? " == " : " != ";
+            comparison += "(" + std::to_string(i % 5) + comparisons[i % 4] + std::to_string(i % 3) + ")";
+        }
+        executeBenchmark(suite, "comparison", comparison);
+
+        std::string negate(2000, '-');
+        executeBenchmark(suite, "negate", negate + "1");
+
+        Environment environment;
+        environment.bind<&increment>("increment");
+        std::string native;
+        for (int i = 0; i < 1000; i++) native += "increment(";
+        native += "0";
+        native += std::string(1000, ')');
+        executeBenchmark(suite, "native", native, &environment);
+
+        // Functions of libm, declared noexcept, bound directly and through a pointer
+        environment.bind<&hypot>("hypot");
+        environment.bind("sqrt", static_cast<double (*)(double)>(&sqrt));
+        std::string math = "0";
+        for (int i = 0; i < 200; i++)
+        {
+            math = "hypot(sqrt(" + std::to_string(i % 9 + 1) + "), " + math + ")";
+        }
+        executeBenchmark(suite, "math", math, &environment);
+
+        // Locals are stack slots and globals indices into an array of the VM : no lookup by name
+        std::string locals = "var x = 1.5; var y = 2; var z = 0;";
+        for (int i = 0; i < 100; i++)
+        {
+            locals += i % 2 ? " z = x * y - z;" : " x = z / y + x;";
+        }
+        executeBenchmark(suite, "locals", locals + " z");
+
+        Environment globalEnvironment;
+        globalEnvironment.addGlobal("g");
+        globalEnvironment.addGlobal("h");
+        std::string globals = "g = 1.5; h = 2;";
+        for (int i = 0; i < 100; i++)
+        {
+            globals += i % 2 ? " g = g * 0.5 + h;" : " h = h - g * 0.25;";
+        }
+        executeBenchmark(suite, "globals", globals + " g", &globalEnvironment);
+    }
+
+    // budget/unspent : the cost of counting instructions with a budget never reached, to compare with vm/arithmetic
+    // budget/slices : the execution yields every 100 instructions and is resumed until it completes
+    void budgetBenchmarks(Suite& suite)
+    {
+        VirtualMachine virtualMachine;
+        Chunk chunk;
+        if (!compile(virtualMachine, arithmeticSource(), &chunk)) return;
+        double instructions = (double)countInstructions(chunk);
+
+        virtualMachine.setInstructionBudget(1000000);
+        suite.measure("budget/unspent", "ns/instruction", instructions, 0.0, [&]()
+        {
+            gSink = virtualMachine.execute(chunk);
+        });
+
+        virtualMachine.setInstructionBudget(100);
+        suite.measure("budget/slices", "ns/instruction", instructions, 0.0, [&]()
+        {
+            VirtualMachine::InterpretResult status = virtualMachine.execute(chunk);
+            while (status == VirtualMachine::Interpret_Yield)
+            {
+                status = virtualMachine.resume();
+            }
+            gSink = status;
+        });
+    }
+
+    // types/checked : arithmetic on the result of an input, with every instruction turned back into its checked variant
+    // types/unchecked : the same chunk as compiled, the operand types inferred from the first operation are proven
+    // False when the verifier accepts a forged chunk giving a string to an unchecked instruction
+    bool typeBenchmarks(Suite& suite)
+    {
+        Chunk forged;
+        forged.addConstant(Value((Obj*)ObjString::copyString(forged.getHeap(), "s", 1)));
+        forged.addConstant(Value(1.5));
+        forged.push(Chunk::Op_Constant, 1);
+        forged.push(0, 1);
+        forged.push(Chunk::Op_Constant, 1);
+        forged.push(1, 1);
+        forged.push(Chunk::Op_AddDouble, 1);
+        forged.push(Chunk::Op_Return, 1);
+        fprintf(stderr, "bench: verifying a forged chunk, it must be reported as invalid\n");
+        if (Verifier::verify(forged))
+        {
+            fprintf(stderr, "bench: the verifier accepted a string given to Op_AddDouble\n");
+            return false;
+        }
+
+        Environment environment;
+        environment.addInput("a");
+        environment.addInput("b");
+        VirtualMachine virtualMachine;
+        virtualMachine.setEnvironment(&environment);
+        virtualMachine.setJitEnabled(false);
+
+        std::string source = "(a - b)";
+        for (int i = 0; i < 120; i++) source += " * 1.5 - 0.25";
+        Chunk unchecked;
+        if (!compile(virtualMachine, source, &unchecked)) return true;
+
+        Chunk checked;
+        for (std::size_t i = 0; i < unchecked.constantCount(); i++) checked.addConstant(unchecked.getConstant(i));
+        for (std::size_t offset = 0; offset < unchecked.size(); offset += Chunk::getInstructionLength(unchecked.getCode(offset)))
+        {
+            checked.push(TypeInference::generalize(unchecked.getCode(offset)), unchecked.getLine(offset));
+            for (std::size_t i = 1; i < Chunk::getInstructionLength(unchecked.getCode(offset)); i++) checked.push(unchecked.getCode(offset + i), unchecked.getLine(offset + i));
+        }
+        if (!Verifier::verify(checked)) return true;
+
+        Value inputs[2] = { Value((std::int64_t)7), Value(0.5) };
+        double instructions = (double)countInstructions(unchecked);
+        suite.measure("types/checked", "ns/instruction", instructions, 0.0, [&]()
+        {
+            gSink = virtualMachine.execute(checked, nullptr, inputs);
+        });
+        suite.measure("types/unchecked", "ns/instruction", instructions, 0.0, [&]()
+        {
+            gSink = virtualMachine.execute(unchecked, nullptr, inputs);
+        });
+        return true;
+    }
+
+    void stringBenchmarks(Suite& suite)
+    {
+        VirtualMachine virtualMachine;
+        virtualMachine.setJitEnabled(false);
+
+        std::string concatenation = "\"entity\"";
+        for (int i = 0; i < 200; i++)
+        {
+            concatenation += " + \"_" + std::to_string(i) + "\"";
+        }
+        Chunk concatenationChunk;
+        if (suite.enabled("strings/concatenate") && compile(virtualMachine, concatenation, &concatenationChunk))
+        {
+            suite.measure("strings/concatenate", "ns/concatenation", (double)countInstructions(concatenationChunk, Chunk::Op_Add), 0.0, [&]()
+            {
+                gSink = virtualMachine.execute(concatenationChunk);
+                virtualMachine.resetHeap();
+            });
+        }
+
+        // Equal strings of increasing length, compared then the results compared together
+        std::string equality = "true";
+        for (int i = 0; i < 60; i++)
+        {
+            std::string text((std::size_t)(4 + i * 4), (char)('a' + i % 26));
+            equality += " == (\"" + text + "\" == \"" + text + "\")";
+        }
+        Chunk equalityChunk;
+        if (suite.enabled("strings/equal") && compile(virtualMachine, equality, &equalityChunk))
+        {
+            suite.measure("strings/equal", "ns/comparison", (double)countInstructions(equalityChunk, Chunk::Op_Equal), 0.0, [&]()
+            {
+                gSink = virtualMachine.execute(equalityChunk);
+            });
+        }
+    }
+
+    // Counts the written bytes, so only the formatting and the buffering are measured
+    class CountingSink : public OutputSink
+    {
+        public:
+            void write(const char* data, std::size_t size) override
+            {
+                gSink = gSink + size + (std::uint8_t)data[0];
+            }
+
+            using OutputSink::write;
+    };
+
+    // output/printf formats numbers like before (printf("%.17g"), one write per value), output/numbers is the path
+    // of interpret (shortest round trip formatting into the buffer of the VM), output/file also writes to /dev/null
+    void outputBenchmarks(Suite& suite)
+    {
+        const std::size_t count = 1024;
+        std::vector<Value> values;
+        for (std::size_t i = 0; i < count; i++)
+        {
+            values.push_back(i % 4 == 3 ? Value((std::int64_t)(i * 7919)) : Value((double)i * 1.37 / 3.0));
+        }
+
+        CountingSink counting;
+        suite.measure("output/printf", "ns/value", (double)count, 0.0, [&]()
+        {
+            for (const Value& value : values)
+            {
+                if (value.isInteger()) counting.print("%lld\n", (long long)value.asInteger());
+                else counting.print("%.17g\n", value.asDouble());
+            }
+        });
+
+        BufferedSink buffered(&counting);
+        suite.measure("output/numbers", "ns/value", (double)count, 0.0, [&]()
+        {
+            for (const Value& value : values)
+            {
+                Debug::printValue(value, buffered);
+                buffered.write("\n", 1);
+            }
+        });
+        buffered.flush();
+
+        FILE* file = fopen("/dev/null", "w");
+        if (file == nullptr) return;
+        FileSink fileSink(file);
+        buffered.setDestination(&fileSink);
+        suite.measure("output/file", "ns/value", (double)count, 0.0, [&]()
+        {
+            for (const Value& value : values)
+            {
+                Debug::printValue(value, buffered);
+                buffered.write("\n", 1);
+            }
+        });
+        buffered.flush();
+        buffered.setDestination(&counting);
+        fclose(file);
+    }
+
+    void memoryBenchmarks(Suite& suite)
+    {
+        // Mixed sizes, freed in allocation order after a window, like short lived strings
+        const std::size_t count = 4096;
+        const std::size_t window = 64;
+        std::vector<void*> blocks(window, nullptr);
+        std::vector<std::size_t> sizes(window, 0);
+        suite.measure("memory/churn", "ns/allocation", (double)count, 0.0, [&]()
+        {
+            for (std::size_t i = 0; i < count; i++)
+            {
+                std::size_t slot = i % window;
+                MEMORY_FREE_ARRAY(char, (char*)blocks[slot], sizes[slot]);
+                sizes[slot] = 16 << (i * 7 % 9);
+                blocks[slot] = MEMORY_ALLOCATE(char, sizes[slot]);
+                ((char*)blocks[slot])[0] = (char)i;
+            }
+        });
+        for (std::size_t slot = 0; slot < window; slot++)
+        {
+            MEMORY_FREE_ARRAY(char, (char*)blocks[slot], sizes[slot]);
+        }
+
+        Heap heap;
+        static const char text[] = "inventory_slot_42";
+        suite.measure("memory/strings", "ns/string", 1024.0, 0.0, [&]()
+        {
+            for (int i = 0; i < 1024; i++)
+            {
+                ObjString::copyString(heap, text, (int)(sizeof(text) - 1 - i % 8));
+            }
+            gSink = heap.size();
+            heap.clear();
+        });
+    }
+
+    // The same formula for every entity : one VM execution per entity against one batch execution
+    void batchBenchmarks(Suite& suite)
+    {
+        Environment environment;
+        int health = environment.addInput("health");
+        int armor = environment.addInput("armor");
+        VirtualMachine virtualMachine;
+        virtualMachine.setEnvironment(&environment);
+        virtualMachine.setJitEnabled(false);
+        Chunk chunk;
+        // The same formula as bench/Damage.bx, translated to C++ at build time for batch/aot
+        if (!compile(virtualMachine, "(health * 1.5 - armor * 0.5) / 2 + 1 > armor", &chunk)) return;
+
+        const std::size_t count = 16384;
+        std::vector<double> healths(count);
+        std::vector<double> armors(count);
+        for (std::size_t i = 0; i < count; i++)
+        {
+            healths[i] = (double)(i % 100);
+            armors[i] = (double)(i % 37);
+        }
+        std::vector<Value> results(count);
+
+        suite.measure("batch/scalar", "ns/entity", (double)count, 0.0, [&]()
+        {
+            Value inputs[2];
+            for (std::size_t i = 0; i < count; i++)
+            {
+                inputs[health] = Value(healths[i]);
+                inputs[armor] = Value(armors[i]);
+                virtualMachine.execute(chunk, &results[i], inputs);
+            }
+            gSink = results[count - 1].asBool();
+        });
+
+        VirtualMachine jitMachine;
+        jitMachine.setJitThreshold(0);
+        suite.measure("batch/jit", "ns/entity", (double)count, 0.0, [&]()
+        {
+            Value inputs[2];
+            for (std::size_t i = 0; i < count; i++)
+            {
+                inputs[health] = Value(healths[i]);
+                inputs[armor] = Value(armors[i]);
+                jitMachine.execute(chunk, &results[i], inputs);
+            }
+            gSink = results[count - 1].asBool();
+        });
+
+        AotScript script;
+        if (script.link(benchDamage, &environment))
+        {
+            suite.measure("batch/aot", "ns/entity", (double)count, 0.0, [&]()
+            {
+                Value inputs[2];
+                for (std::size_t i = 0; i < count; i++)
+                {
+                    inputs[health] = Value(healths[i]);
+                    inputs[armor] = Value(armors[i]);
+                    virtualMachine.execute(script, &results[i], inputs);
+                }
+                gSink = results[count - 1].asBool();
+            });
+        }
+
+        BatchEvaluator batch;
+        batch.setInput(health, healths.data());
+        batch.setInput(armor, armors.data());
+        suite.measure("batch/evaluate", "ns/entity", (double)count, 0.0, [&]()
+        {
+            gSink = batch.execute(chunk, count, results.data());
+        });
+    }
+
+    void corpusBenchmarks(Suite& suite, const std::vector<std::string>& corpus)
+    {
+        VirtualMachine virtualMachine;
+        virtualMachine.setJitEnabled(false);
+        std::vector<Chunk> chunks(corpus.size());
+        std::size_t instructions = 0;
+        for (std::size_t i = 0; i < corpus.size(); i++)
+        {
+            if (!compile(virtualMachine, corpus[i], &chunks[i])) return;
+            if (virtualMachine.execute(chunks[i]) != VirtualMachine::Interpret_Ok)
+            {
+                fprintf(stderr, "bench: runtime error in\n%s\n", corpus[i].c_str());
+                return;
+            }
+            instructions += countInstructions(chunks[i]);
+        }
+
+        suite.measure("corpus/execute", "ns/instruction", (double)instructions, 0.0, [&]()
+        {
+            for (const Chunk& chunk : chunks)
+            {
+                gSink = virtualMachine.execute(chunk);
+            }
+            virtualMachine.resetHeap();
+        });
+
+        VirtualMachine jitMachine;
+        jitMachine.setJitThreshold(0);
+        suite.measure("corpus/jit", "ns/instruction", (double)instructions, 0.0, [&]()
+        {
+            for (const Chunk& chunk : chunks)
+            {
+                gSink = jitMachine.execute(chunk);
+            }
+            jitMachine.resetHeap();
+        });
+
+        Chunk chunk;
+        suite.measure("corpus/compile-execute", "ns/script", (double)corpus.size(), 0.0, [&]()
+        {
+            for (const std::string& script : corpus)
+            {
+                virtualMachine.compile(script.c_str(), &chunk);
+                gSink = virtualMachine.execute(chunk);
+            }
+            virtualMachine.resetHeap();
+        });
+    }
+
+    // Two ways to get the chunks of the corpus ready to execute : compiling the scripts, or opening a snapshot of them
+    void snapshotBenchmarks(Suite& suite, const std::vector<std::string>& corpus)
+    {
+        static const char path[] = "blissx_bench.bxs";
+
+        VirtualMachine virtualMachine;
+        std::vector<Chunk> chunks(corpus.size());
+        std::vector<const Chunk*> pointers;
+        for (std::size_t i = 0; i < corpus.size(); i++)
+        {
+            if (!compile(virtualMachine, corpus[i], &chunks[i])) return;
+            pointers.push_back(&chunks[i]);
+        }
+
+        suite.measure("snapshot/compile", "ns/script", (double)corpus.size(), 0.0, [&]()
+        {
+            for (std::size_t i = 0; i < corpus.size(); i++)
+            {
+                gSink = virtualMachine.compile(corpus[i].c_str(), &chunks[i]);
+            }
+        });
+
+        if (!suite.enabled("snapshot/open") || !Snapshot::write(path, pointers.data(), pointers.size(), nullptr, 0)) return;
+        Snapshot snapshot;
+        suite.measure("snapshot/open", "ns/script", (double)corpus.size(), 0.0, [&]()
+        {
+            gSink = snapshot.open(path, nullptr);
+        });
+        snapshot.close();
+        remove(path);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--json") == 0)
+        {
+            options.json = true;
+        }
+        else if (strcmp(argv[i], "--quick") == 0)
+        {
+            options.quick = true;
+        }
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+        {
+            options.filter = argv[++i];
+        }
+        else
+        {
+            fprintf(stderr, "Usage: blissx_bench [--json] [--quick] [--filter text]\n");
+            return 64;
+        }
+    }
+
+    if (!options.json)
+    {
+        printf("BlissX benchmarks (%s%s, %s)\n", DISPATCH_NAME, TOS_CACHING ? "+tos" : "", COMPILER_VERSION);
+    }
+
+    std::vector<std::string> corpus = Corpus::generateScripts(1, 64);
+
+    Suite suite(options);
+    scannerBenchmarks(suite);
+    compilerBenchmarks(suite, corpus);
+    vmBenchmarks(suite);
+    budgetBenchmarks(suite);
+    if (!typeBenchmarks(suite))
+    {
+        return 1;
+    }
+    stringBenchmarks(suite);
+    outputBenchmarks(suite);
+    memoryBenchmarks(suite);
+    batchBenchmarks(suite);
+    corpusBenchmarks(suite, corpus);
+    snapshotBenchmarks(suite, corpus);
+    suite.report();
+    return 0;
+}
@@ -0,0 +1,225 @@
+#include "Corpus.hpp"
+
+namespace
+{
+    // xorshift32
+    class Random
+    {
+        public:
+            Random(std::uint32_t seed)
+                : mState(seed * 2654435761u + 1)
+            {
+            }
+
+            std::uint32_t next()
+            {
+                mState ^= mState << 13;
+                mState ^= mState >> 17;
+                mState ^= mState << 5;
+                return mState;
+            }
+
+            std::uint32_t below(std::uint32_t bound)
+            {
+                return next() % bound;
+            }
+
+        private:
+            std::uint32_t mState;
+    };
+
+    const char* const names[] = {
+        "player", "enemy", "spawn", "health", "armor", "shard", "quest", "reward", "inventory", "weapon",
+        "damage", "shield", "level", "boss", "loot", "npc", "dialog", "door", "key", "trigger"
+    };
+
+    // Typed generation, so every script runs without runtime error
+    class Generator
+    {
+        public:
+            Generator(std::uint32_t seed, int constantBudget)
+                : mRandom(seed)
+                , mBudget(constantBudget)
+            {
+            }
+
+            std::string script(std::uint32_t seed)
+            {
+                mSource = "// generated script " + std::to_string(seed) + "\n";
+                if (mRandom.below(2) == 0)
+                {
+                    number(6);
+                }
+                else
+                {
+                    boolean(6);
+                }
+                mSource += "\n";
+                return mSource;
+            }
+
+        private:
+            void separator()
+            {
+                if (mRandom.below(5) == 0)
+                {
+                    mSource += mRandom.below(4) == 0 ? " // tuning\n    " : "\n    ";
+                }
+                else
+                {
+                    mSource += " ";
+                }
+            }
+
+            void numberLiteral()
+            {
+                mBudget--;
+                switch (mRandom.below(4))
+                {
+                    case 0: mSource += std::to_string(mRandom.below(100)); break;
+                    case 1: mSource += std::to_string(mRandom.below(1000)) + "." + std::to_string(mRandom.below(100)); break;
+                    case 2: mSource += "0." + std::to_string(mRandom.below(1000) + 1); break;
+                    default: mSource += std::to_string(mRandom.below(100000)); break;
+                }
+            }
+
+            void stringLiteral()
+            {
+                mBudget--;
+                mSource += "\"";
+                mSource += names[mRandom.below(sizeof(names) / sizeof(names[0]))];
+                if (mRandom.below(2) == 0)
+                {
+                    mSource += "_" + std::to_string(mRandom.below(50));
+                }
+                mSource += "\"";
+            }
+
+            void number(int depth)
+            {
+                if (depth == 0 || mBudget < 4)
+                {
+                    numberLiteral();
+                    return;
+                }
+
+                switch (mRandom.below(6))
+                {
+                    case 0:
+                        mSource += "-";
+                        number(depth - 1);
+                        break;
+                    case 1:
+                        mSource += "(";
+                        number(depth - 1);
+                        mSource += ")";
+                        break;
+                    case 2:
+                        numberLiteral();
+                        break;
+                    default:
+                    {
+                        static const char* const operators[] = { "+", "-", "*", "/" };
+                        mSource += "(";
+                        number(depth - 1);
+                        separator();
+                        mSource += operators[mRandom.below(4)];
+                        mSource += " ";
+                        number(depth - 1);
+                        mSource += ")";
+                        break;
+                    }
+                }
+            }
+
+            void string(int depth)
+            {
+                if (depth == 0 || mBudget < 4 || mRandom.below(3) == 0)
+                {
+                    stringLiteral();
+                    return;
+                }
+
+                string(depth - 1);
+                separator();
+                mSource += "+ ";
+                string(depth - 1);
+            }
+
+            void boolean(int depth)
+            {
+                if (depth == 0 || mBudget < 4)
+                {
+                    mSource += mRandom.below(2) == 0 ? "true" : "false";
+                    return;
+                }
+
+                switch (mRandom.below(5))
+                {
+                    case 0:
+                    {
+                        static const char* const comparisons[] = { "<", "<=", ">", ">=", "==", "!=" };
+                        mSource += "(";
+                        number(depth - 1);
+                        separator();
+                        mSource += comparisons[mRandom.below(6)];
+                        mSource += " ";
+                        number(depth - 1);
+                        mSource += ")";
+                        break;
+                    }
+                    case 1:
+                        mSource += "(";
+                        string(depth - 1);
+                        separator();
+                        mSource += mRandom.below(2) == 0 ? "== " : "!= ";
+                        string(depth - 1);
+                        mSource += ")";
+                        break;
+                    case 2:
+                        mSource += "!";
+                        boolean(depth - 1);
+                        break;
+                    default:
+                        mSource += "(";
+                        boolean(depth - 1);
+                        separator();
+                        mSource += mRandom.below(2) == 0 ? "== " : "!= ";
+                        boolean(depth - 1);
+                        mSource += ")";
+                        break;
+                }
+            }
+
+        private:
+            Random mRandom;
+            int mBudget;
+            std::string mSource;
+    };
+}
+
+std::string Corpus::generateScript(std::uint32_t seed, int constantBudget)
+{
+    Generator generator(seed, constantBudget);
+    return generator.script(seed);
+}
+
+std::vector<std::string> Corpus::generateScripts(std::uint32_t seed, std::size_t count)
+{
+    std::vector<std::string> scripts;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        scripts.push_back(generateScript(seed + (std::uint32_t)i));
+    }
+    return scripts;
+}
+
+std::string Corpus::generateSource(std::uint32_t seed, std::size_t size)
+{
+    std::string source;
+    for (std::uint32_t i = 0; source.size() < size; i++)
+    {
+        source += generateScript(seed + i);
+    }
+    return source;
+}
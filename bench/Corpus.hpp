@@ -0,0 +1,26 @@
+#ifndef BENCH_CORPUS_HPP
+#define BENCH_CORPUS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Deterministic generator of scripts resembling what the game scripts look like today : multi-line expressions mixing
+// arithmetic, comparisons, strings and comments. The same seed always gives the same scripts, on every machine.
+class Corpus
+{
+    public:
+        Corpus() = delete;
+
+        // One script, compilable and executable without error, using at most constantBudget constants
+        static std::string generateScript(std::uint32_t seed, int constantBudget = 200);
+
+        // count scripts from consecutive seeds
+        static std::vector<std::string> generateScripts(std::uint32_t seed, std::size_t count);
+
+        // Scripts one after the other until size bytes : scanner input, not a valid script as a whole
+        static std::string generateSource(std::uint32_t seed, std::size_t size);
+};
+
+#endif // BENCH_CORPUS_HPP
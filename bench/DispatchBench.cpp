@@ -0,0 +1,137 @@
+// Compares the interpreter dispatch strategies (see BLISSX_DISPATCH_* in Common.hpp)
+// This file is built once per strategy by dispatch.sh, each build runs the same generated scripts
+// The measures are reported on stderr
+
+#include "VirtualMachine.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#if defined(BLISSX_DISPATCH_TAIL_CALL)
+    #define DISPATCH_NAME "tail-call"
+#elif defined(BLISSX_DISPATCH_COMPUTED_GOTO)
+    #define DISPATCH_NAME "computed-goto"
+#else
+    #define DISPATCH_NAME "switch"
+#endif
+
+#ifdef BLISSX_TOS_CACHING
+    #define CACHING_NAME "+tos"
+#else
+    #define CACHING_NAME ""
+#endif
+
+// Operators mixing precedences, at most 255 literals because of the constant limit of a chunk
+std::string arithmeticScript()
+{
+    static const char* const operators[] = { " + ", " * ", " - ", " / " };
+    std::string source = "1.5";
+    for (int i = 0; i < 250; i++)
+    {
+        source += operators[i % 4];
+        source += std::to_string(i % 7 + 2);
+    }
+    return source;
+}
+
+std::string comparisonScript()
+{
+    static const char* const comparisons[] = { " < ", " >= ", " > ", " <= " };
+    static const char* const equalities[] = { " == ", " != " };
+    std::string source = "(1 < 2)";
+    for (int i = 0; i < 120; i++)
+    {
+        source += equalities[i % 2];
+        source += "(" + std::to_string(i % 5) + comparisons[i % 4] + std::to_string(i % 3) + ")";
+    }
+    return source;
+}
+
+std::string unaryScript(const char* prefix, const char* operand)
+{
+    std::string source;
+    for (int i = 0; i < 2000; i++)
+    {
+        source += prefix;
+    }
+    return source + operand;
+}
+
+double increment(double value)
+{
+    return value + 1.0;
+}
+
+// Nested calls of a native function, measures the cost of a script to host call
+std::string nativeScript()
+{
+    std::string source;
+    for (int i = 0; i < 1000; i++)
+    {
+        source += "increment(";
+    }
+    source += "0";
+    for (int i = 0; i < 1000; i++)
+    {
+        source += ")";
+    }
+    return source;
+}
+
+std::size_t countInstructions(const Chunk& chunk)
+{
+    std::size_t count = 0;
+    for (std::size_t offset = 0; offset < chunk.size(); offset += Chunk::getInstructionLength(chunk.getCode(offset)))
+    {
+        count++;
+    }
+    return count;
+}
+
+void benchmark(const char* name, const std::string& source)
+{
+    Environment environment;
+    environment.bind<&increment>("increment");
+
+    Compiler compiler;
+    compiler.setEnvironment(&environment);
+    Chunk chunk;
+    if (!compiler.compile(source.c_str(), &chunk))
+    {
+        fprintf(stderr, "%s: compile error\n", name);
+        return;
+    }
+
+    std::size_t instructions = countInstructions(chunk);
+    VirtualMachine virtualMachine;
+    // Measures the interpreter loop only
+    virtualMachine.setJitEnabled(false);
+
+    // Warm up, then run for a fixed number of instructions
+    for (int i = 0; i < 100; i++)
+    {
+        virtualMachine.execute(chunk);
+    }
+
+    const std::size_t runs = 50000000 / instructions + 1;
+    auto begin = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < runs; i++)
+    {
+        virtualMachine.execute(chunk);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double nanoseconds = std::chrono::duration<double, std::nano>(end - begin).count();
+    fprintf(stderr, "%-18s %-12s %6zu instructions  %7.3f ns/instruction\n", DISPATCH_NAME CACHING_NAME, name, instructions, nanoseconds / (double)(runs * instructions));
+}
+
+int main()
+{
+    benchmark("arithmetic", arithmeticScript());
+    benchmark("comparison", comparisonScript());
+    benchmark("negate", unaryScript("-", "1"));
+    benchmark("not", unaryScript("!", "true"));
+    benchmark("native", nativeScript());
+    return 0;
+}
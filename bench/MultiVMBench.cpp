@@ -0,0 +1,165 @@
+// Runs N VirtualMachine on N threads, all executing the same compiled chunks (see the threading model in VirtualMachine.hpp)
+// Every run is checked against the output of a single threaded reference run, so this also serves as a stress test
+// when built with ThreadSanitizer (multivm.sh --tsan)
+// Usage : MultiVMBench [max threads] [runs per thread], the throughput is measured for 1, 2, 4 ... max threads
+
+#include "Debug.hpp"
+#include "VirtualMachine.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Keeps the output of a VM in memory to compare it with the expected one
+class StringSink : public OutputSink
+{
+    public:
+        void write(const char* data, std::size_t size) override
+        {
+            mString.append(data, size);
+        }
+
+        using OutputSink::write;
+
+        std::string& getString()
+        {
+            return mString;
+        }
+
+    private:
+        std::string mString;
+};
+
+std::vector<std::string> scripts()
+{
+    std::vector<std::string> sources;
+
+    std::string arithmetic = "1.5";
+    static const char* const operators[] = { " + ", " * ", " - ", " / " };
+    for (int i = 0; i < 200; i++)
+    {
+        arithmetic += operators[i % 4];
+        arithmetic += std::to_string(i % 7 + 2);
+    }
+    sources.push_back(arithmetic);
+
+    // Constant strings are shared through the chunk, the concatenations are allocated in the heap of each VM
+    std::string strings = "\"shard\"";
+    for (int i = 0; i < 40; i++)
+    {
+        strings += " + \"-" + std::to_string(i) + "\"";
+    }
+    sources.push_back(strings);
+    sources.push_back("(" + strings + ") == (" + strings + ")");
+
+    std::string comparisons = "(1 < 2)";
+    for (int i = 0; i < 60; i++)
+    {
+        comparisons += i % 2 ? " == " : " != ";
+        comparisons += "(" + std::to_string(i % 5) + (i % 3 ? " <= " : " > ") + std::to_string(i % 3) + ")";
+    }
+    sources.push_back(comparisons);
+
+    return sources;
+}
+
+// Executes the chunk and prints its result into sink
+bool execute(VirtualMachine& virtualMachine, const Chunk& chunk, OutputSink& sink)
+{
+    Value result;
+    if (virtualMachine.execute(chunk, &result) != VirtualMachine::Interpret_Ok)
+    {
+        return false;
+    }
+    Debug::printValue(result, sink);
+    sink.write("\n");
+    virtualMachine.resetHeap();
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t maxThreads = argc > 1 ? strtoul(argv[1], nullptr, 10) : std::thread::hardware_concurrency();
+    std::size_t runs = argc > 2 ? strtoul(argv[2], nullptr, 10) : 20000;
+    if (maxThreads == 0) maxThreads = 1;
+
+    // Compiled once, then only read by every thread
+    std::vector<std::string> sources = scripts();
+    std::vector<Chunk> chunks(sources.size());
+    std::vector<std::string> expected(sources.size());
+    VirtualMachine reference;
+    StringSink referenceSink;
+    for (std::size_t i = 0; i < sources.size(); i++)
+    {
+        if (reference.compile(sources[i].c_str(), &chunks[i]) != VirtualMachine::Interpret_Ok || !execute(reference, chunks[i], referenceSink))
+        {
+            fprintf(stderr, "script %zu: failed\n", i);
+            return 1;
+        }
+        expected[i].swap(referenceSink.getString());
+    }
+
+    double baseline = 0.0;
+    bool failed = false;
+    for (std::size_t threadCount = 1; ; threadCount = std::min(threadCount * 2, maxThreads))
+    {
+        std::vector<std::size_t> mismatches(threadCount, 0);
+
+        auto work = [&](std::size_t index)
+        {
+            VirtualMachine virtualMachine;
+            StringSink sink;
+            virtualMachine.setOutputSink(&sink);
+
+            // Compiling from several threads at once is also allowed, each VM has its own compiler
+            virtualMachine.interpret(sources[index % sources.size()].c_str());
+            virtualMachine.flushOutput();
+            if (sink.getString() != expected[index % sources.size()]) mismatches[index]++;
+            sink.getString().clear();
+
+            for (std::size_t run = 0; run < runs; run++)
+            {
+                std::size_t script = (run + index) % chunks.size();
+                if (!execute(virtualMachine, chunks[script], sink) || sink.getString() != expected[script])
+                {
+                    mismatches[index]++;
+                }
+                sink.getString().clear();
+            }
+        };
+
+        auto begin = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (std::size_t i = 1; i < threadCount; i++)
+        {
+            threads.emplace_back(work, i);
+        }
+        work(0);
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        std::size_t mismatchCount = 0;
+        for (std::size_t count : mismatches)
+        {
+            mismatchCount += count;
+        }
+        failed = failed || mismatchCount != 0;
+
+        double seconds = std::chrono::duration<double>(end - begin).count();
+        double throughput = (double)(threadCount * runs) / seconds;
+        if (threadCount == 1) baseline = throughput;
+        fprintf(stderr, "%3zu threads  %12.0f runs/s  speedup %5.2f  efficiency %5.1f%%  %zu mismatches\n",
+            threadCount, throughput, throughput / baseline, 100.0 * throughput / baseline / (double)threadCount, mismatchCount);
+
+        if (threadCount == maxThreads) break;
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,156 @@
+// Runs ticks of many independent script tasks through a Scheduler, for 1, 2, 4 ... max workers
+// Reports the throughput, the latency of whole ticks (submission to the completion of the last task) and the latency
+// of single tasks (submission of their tick to their completion), as percentiles over every tick
+// Every result is checked against a single VM run, so this also serves as a stress test of the scheduler
+// Usage : SchedulerBench [max workers] [tasks per tick] [ticks] [tasks per submission]
+
+#include "Environment.hpp"
+#include "Scheduler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+struct TickState
+{
+    ScriptTask* tasks;
+    Clock::time_point start;
+    // Nanoseconds from the start of the tick to the completion of each task
+    std::vector<double>* latencies;
+};
+
+void recordCompletion(ScriptTask& task, void* userData)
+{
+    TickState& state = *(TickState*)userData;
+    (*state.latencies)[&task - state.tasks] = std::chrono::duration<double, std::nano>(Clock::now() - state.start).count();
+}
+
+double percentile(std::vector<double>& values, double fraction)
+{
+    std::size_t index = std::min(values.size() - 1, (std::size_t)(fraction * (double)values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+std::vector<std::string> scripts()
+{
+    std::vector<std::string> sources;
+    sources.push_back("(health * 1.5 - armor * 0.5) / 2 + 1 > armor");
+    sources.push_back("health - armor * 2 + 10");
+    sources.push_back("(health > 50) == (armor < 20)");
+
+    // A few longer tasks among the short ones
+    std::string arithmetic = "health";
+    static const char* const operators[] = { " + ", " * ", " - ", " / " };
+    for (int i = 0; i < 200; i++)
+    {
+        arithmetic += operators[i % 4];
+        arithmetic += i % 3 ? std::to_string(i % 7 + 2) : "armor";
+    }
+    sources.push_back(arithmetic);
+
+    return sources;
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t maxWorkers = argc > 1 ? strtoul(argv[1], nullptr, 10) : std::thread::hardware_concurrency();
+    std::size_t taskCount = argc > 2 ? strtoul(argv[2], nullptr, 10) : 20000;
+    std::size_t tickCount = argc > 3 ? strtoul(argv[3], nullptr, 10) : 100;
+    std::size_t batchSize = argc > 4 ? strtoul(argv[4], nullptr, 10) : 1024;
+    if (maxWorkers == 0) maxWorkers = 1;
+    if (taskCount == 0) taskCount = 1;
+    if (tickCount == 0) tickCount = 1;
+    if (batchSize == 0) batchSize = taskCount;
+
+    Environment environment;
+    environment.addInput("health");
+    environment.addInput("armor");
+
+    VirtualMachine reference;
+    reference.setEnvironment(&environment);
+    std::vector<std::string> sources = scripts();
+    std::vector<Chunk> chunks(sources.size());
+    for (std::size_t i = 0; i < sources.size(); i++)
+    {
+        if (reference.compile(sources[i].c_str(), &chunks[i]) != VirtualMachine::Interpret_Ok)
+        {
+            fprintf(stderr, "script %zu: compile error\n", i);
+            return 1;
+        }
+    }
+
+    // Mostly short scripts, one task in 16 is the long one
+    std::vector<Value> inputs(taskCount * 2);
+    std::vector<ScriptTask> tasks(taskCount);
+    std::vector<Value> expected(taskCount);
+    for (std::size_t i = 0; i < taskCount; i++)
+    {
+        inputs[i * 2] = Value((double)(i % 97 + 1));
+        inputs[i * 2 + 1] = Value((std::int64_t)(i % 31));
+        tasks[i].chunk = &chunks[i % 16 == 15 ? 3 : i % 3];
+        tasks[i].inputs = &inputs[i * 2];
+        if (reference.execute(*tasks[i].chunk, &expected[i], tasks[i].inputs) != VirtualMachine::Interpret_Ok)
+        {
+            fprintf(stderr, "task %zu: runtime error\n", i);
+            return 1;
+        }
+    }
+
+    fprintf(stderr, "%zu tasks per tick, %zu per submission, %zu ticks\n", taskCount, batchSize, tickCount);
+
+    double baseline = 0.0;
+    bool failed = false;
+    for (std::size_t workerCount = 1; ; workerCount = std::min(workerCount * 2, maxWorkers))
+    {
+        Scheduler scheduler(workerCount);
+
+        std::vector<double> taskLatencies;
+        std::vector<double> tickLatencies;
+        std::vector<double> latencies(taskCount);
+        taskLatencies.reserve(taskCount * tickCount);
+        std::size_t mismatches = 0;
+
+        TickState state = { tasks.data(), Clock::time_point(), &latencies };
+        TaskGroup group(&recordCompletion, &state);
+
+        Clock::time_point begin = Clock::now();
+        for (std::size_t tick = 0; tick < tickCount; tick++)
+        {
+            state.start = Clock::now();
+            for (std::size_t first = 0; first < taskCount; first += batchSize)
+            {
+                scheduler.submit(&tasks[first], std::min(batchSize, taskCount - first), group);
+            }
+            group.wait();
+            tickLatencies.push_back(std::chrono::duration<double, std::nano>(Clock::now() - state.start).count());
+
+            for (std::size_t i = 0; i < taskCount; i++)
+            {
+                if (tasks[i].status != VirtualMachine::Interpret_Ok || !tasks[i].result.isEquals(expected[i])) mismatches++;
+            }
+            taskLatencies.insert(taskLatencies.end(), latencies.begin(), latencies.end());
+        }
+        Clock::time_point end = Clock::now();
+        failed = failed || mismatches != 0;
+
+        double seconds = std::chrono::duration<double>(end - begin).count();
+        double throughput = (double)(taskCount * tickCount) / seconds;
+        if (workerCount == 1) baseline = throughput;
+        fprintf(stderr, "%3zu workers  %12.0f tasks/s  speedup %5.2f  tick p50 %9.1f us  p99 %9.1f us  max %9.1f us"
+            "  task p99 %9.1f us  %zu mismatches\n",
+            workerCount, throughput, throughput / baseline,
+            percentile(tickLatencies, 0.5) / 1000.0, percentile(tickLatencies, 0.99) / 1000.0,
+            *std::max_element(tickLatencies.begin(), tickLatencies.end()) / 1000.0,
+            percentile(taskLatencies, 0.99) / 1000.0, mismatches);
+
+        if (workerCount == maxWorkers) break;
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,26 @@
+#!/bin/sh
+# Builds bench/DispatchBench.cpp once per dispatch strategy, with and without top of stack caching,
+# and runs them on the same scripts
+# Usage : bench/dispatch.sh [output directory], the compiler can be changed with CXX (tail calls need Clang)
+
+cd "$(dirname "$0")/.." || exit 1
+
+CXX=${CXX:-c++}
+CXXFLAGS=${CXXFLAGS:-"-O2"}
+OUTPUT=${1:-bench_build}
+
+mkdir -p "$OUTPUT"
+
+for DISPATCH in SWITCH COMPUTED_GOTO TAIL_CALL
+do
+    for CACHING in "" TOS_CACHING
+    do
+        NAME="dispatch_$DISPATCH${CACHING:+_$CACHING}"
+        if $CXX -std=c++17 $CXXFLAGS -DNDEBUG -DBLISSX_DISPATCH_$DISPATCH ${CACHING:+-DBLISSX_$CACHING} -Iinclude src/*.cpp bench/DispatchBench.cpp -pthread -o "$OUTPUT/$NAME" 2> "$OUTPUT/$NAME.log"
+        then
+            "$OUTPUT/$NAME"
+        else
+            echo "$NAME : build failed (see $OUTPUT/$NAME.log)"
+        fi
+    done
+done
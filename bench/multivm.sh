@@ -0,0 +1,31 @@
+#!/bin/sh
+# Builds and runs bench/MultiVMBench.cpp : N VirtualMachine on N threads sharing the same compiled chunks
+# Usage : bench/multivm.sh [--tsan] [max threads] [runs per thread]
+# With --tsan the benchmark is built with ThreadSanitizer and runs as a stress test (fails on any race or mismatch),
+# on at least 4 threads by default so it still checks something on machines with fewer cores
+
+cd "$(dirname "$0")/.." || exit 1
+
+CXX=${CXX:-c++}
+CXXFLAGS=${CXXFLAGS:-"-O2"}
+OUTPUT=${OUTPUT:-bench_build}
+NAME=multivm
+
+if [ "$1" = "--tsan" ]
+then
+    shift
+    CXXFLAGS="-O1 -g -fsanitize=thread"
+    NAME=multivm_tsan
+    export TSAN_OPTIONS="halt_on_error=1 ${TSAN_OPTIONS}"
+    if [ -z "$1" ]
+    then
+        THREADS=$(nproc 2>/dev/null || echo 1)
+        [ "$THREADS" -lt 4 ] && THREADS=4
+        set -- "$THREADS"
+    fi
+fi
+
+mkdir -p "$OUTPUT"
+
+$CXX -std=c++17 $CXXFLAGS -DNDEBUG -Iinclude src/*.cpp bench/MultiVMBench.cpp -pthread -o "$OUTPUT/$NAME" || exit 1
+"$OUTPUT/$NAME" "$@"
@@ -0,0 +1,31 @@
+#!/bin/sh
+# Builds and runs bench/SchedulerBench.cpp : ticks of script tasks run by a Scheduler with 1, 2, 4 ... workers
+# Usage : bench/scheduler.sh [--tsan] [max workers] [tasks per tick] [ticks] [tasks per submission]
+# With --tsan the benchmark is built with ThreadSanitizer and runs as a stress test (fails on any race or mismatch),
+# with at least 4 workers by default so it still checks something on machines with fewer cores
+
+cd "$(dirname "$0")/.." || exit 1
+
+CXX=${CXX:-c++}
+CXXFLAGS=${CXXFLAGS:-"-O2"}
+OUTPUT=${OUTPUT:-bench_build}
+NAME=scheduler
+
+if [ "$1" = "--tsan" ]
+then
+    shift
+    CXXFLAGS="-O1 -g -fsanitize=thread"
+    NAME=scheduler_tsan
+    export TSAN_OPTIONS="halt_on_error=1 ${TSAN_OPTIONS}"
+    if [ -z "$1" ]
+    then
+        WORKERS=$(nproc 2>/dev/null || echo 1)
+        [ "$WORKERS" -lt 4 ] && WORKERS=4
+        set -- "$WORKERS"
+    fi
+fi
+
+mkdir -p "$OUTPUT"
+
+$CXX -std=c++17 $CXXFLAGS -DNDEBUG -Iinclude src/*.cpp bench/SchedulerBench.cpp -pthread -o "$OUTPUT/$NAME" || exit 1
+"$OUTPUT/$NAME" "$@"
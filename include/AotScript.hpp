@@ -0,0 +1,129 @@
+#ifndef AOTSCRIPT_HPP
+#define AOTSCRIPT_HPP
+
+#include "Arithmetic.hpp"
+#include "Environment.hpp"
+#include "VirtualMachine.hpp"
+
+#include <cmath>
+
+// A chunk translated to C++ ahead of time (see CppTranslator), compiled and linked into the program
+// The generated translation unit defines one AotDefinition, e.g. extern const AotDefinition damage;
+struct AotDefinition
+{
+    // natives holds the bindings of nativeNames, in the same order (see AotScript::link)
+    typedef VirtualMachine::InterpretResult (*Function)(VirtualMachine& virtualMachine, const NativeBinding* natives,
+                                                        const Value* inputs, Value* result);
+
+    const char* name;
+    Function function;
+    // Native functions called by the script and their argument counts, resolved by name when linking
+    const char* const* nativeNames;
+    const int* nativeArities;
+    std::size_t nativeCount;
+    // Same as Chunk::getInputCount and Chunk::getGlobalCount
+    std::size_t inputCount;
+    std::size_t globalCount;
+};
+
+// A translated script bound to the native functions of an environment, executed by VirtualMachine::execute
+// Once linked it is only read : it can be executed by several VirtualMachine at the same time
+class AotScript
+{
+    public:
+        AotScript();
+        ~AotScript();
+
+        AotScript(const AotScript&) = delete;
+        AotScript& operator=(const AotScript&) = delete;
+
+        // False when a native function is missing from the environment or takes another argument count
+        // The environment is copied, it only has to live while linking
+        bool link(const AotDefinition& definition, const Environment* environment);
+        bool isLinked() const;
+
+        const AotDefinition& getDefinition() const;
+        const NativeBinding* getNatives() const;
+
+    private:
+        const AotDefinition* mDefinition;
+        NativeBinding* mNatives;
+};
+
+// Slow paths called by the generated code, with the semantics of the VirtualMachine handlers
+// Errors are reported like VirtualMachine::runtimeError, the generated code then returns Interpret_RuntimeError
+class AotRuntime
+{
+    public:
+        AotRuntime() = delete;
+
+        // Any operands, false on a runtime error
+        static bool binary(VirtualMachine& virtualMachine, std::uint8_t instruction, const Value& a, const Value& b, Value* result, int line);
+        static bool negate(const Value& value, Value* result, int line);
+        static bool callNative(const NativeBinding& native, const Value* arguments, Value* result, int line);
+        // The error of the instruction when an operand isn't a number
+        static VirtualMachine::InterpretResult operandError(std::uint8_t instruction, int line);
+        // Any value, false when it is an object
+        static bool setGlobal(VirtualMachine& virtualMachine, std::size_t index, const Value& value, int line);
+
+        // VirtualMachine::execute grew the globals to the count of the definition
+        static inline Value getGlobal(const VirtualMachine& virtualMachine, std::size_t index)
+        {
+            return virtualMachine.mGlobals[index];
+        }
+
+        // A value which is not an object
+        static inline void storeGlobal(VirtualMachine& virtualMachine, std::size_t index, const Value& value)
+        {
+            virtualMachine.mGlobals[index] = value;
+        }
+
+        // Two integers, the result is a double when it doesn't fit or the division isn't exact
+        static inline Value add(std::int64_t a, std::int64_t b)
+        {
+            std::int64_t result;
+            return Arithmetic::checkedAdd(a, b, &result) ? Value((double)a + (double)b) : Value(result);
+        }
+
+        static inline Value substract(std::int64_t a, std::int64_t b)
+        {
+            std::int64_t result;
+            return Arithmetic::checkedSubstract(a, b, &result) ? Value((double)a - (double)b) : Value(result);
+        }
+
+        static inline Value multiply(std::int64_t a, std::int64_t b)
+        {
+            std::int64_t result;
+            return Arithmetic::checkedMultiply(a, b, &result) ? Value((double)a * (double)b) : Value(result);
+        }
+
+        static inline Value divide(std::int64_t a, std::int64_t b)
+        {
+            std::int64_t result;
+            return Arithmetic::checkedDivide(a, b, &result) ? Value((double)a / (double)b) : Value(result);
+        }
+
+        static inline Value negate(std::int64_t value)
+        {
+            return value != INT64_MIN ? Value(-value) : Value(-(double)value);
+        }
+
+        // Two numbers : -1, 0, 1 or NaN so 'order(a, b) op 0.0' is exactly 'a op b', integers are never rounded
+        static inline double order(const Value& a, const Value& b)
+        {
+            if (a.isInteger() && b.isInteger())
+            {
+                return a.asInteger() < b.asInteger() ? -1.0 : a.asInteger() > b.asInteger() ? 1.0 : 0.0;
+            }
+            if (a.isInteger()) return Arithmetic::compareMixed(a.asInteger(), b.asDouble());
+            if (b.isInteger()) return -Arithmetic::compareMixed(b.asInteger(), a.asDouble());
+            double x = a.asDouble();
+            double y = b.asDouble();
+            return x < y ? -1.0 : x > y ? 1.0 : x == y ? 0.0 : NAN;
+        }
+
+    private:
+        static void runtimeError(int line, const char* format, ...);
+};
+
+#endif // AOTSCRIPT_HPP
@@ -0,0 +1,75 @@
+#ifndef ARITHMETIC_HPP
+#define ARITHMETIC_HPP
+
+#include <cstdint>
+
+// Integer arithmetic shared by every engine executing chunks (VirtualMachine, BatchEvaluator, Jit, AotRuntime)
+// The checked operations return true when the result doesn't fit in 64 bits, like the GCC / Clang builtins,
+// the caller then does the operation again on doubles
+class Arithmetic
+{
+    public:
+        Arithmetic() = delete;
+
+        static inline bool checkedAdd(std::int64_t a, std::int64_t b, std::int64_t* result)
+        {
+#if defined(__GNUC__)
+            return __builtin_add_overflow(a, b, result);
+#else
+            if ((b > 0 && a > INT64_MAX - b) || (b < 0 && a < INT64_MIN - b)) return true;
+            *result = a + b;
+            return false;
+#endif
+        }
+
+        static inline bool checkedSubstract(std::int64_t a, std::int64_t b, std::int64_t* result)
+        {
+#if defined(__GNUC__)
+            return __builtin_sub_overflow(a, b, result);
+#else
+            if ((b < 0 && a > INT64_MAX + b) || (b > 0 && a < INT64_MIN + b)) return true;
+            *result = a - b;
+            return false;
+#endif
+        }
+
+        static inline bool checkedMultiply(std::int64_t a, std::int64_t b, std::int64_t* result)
+        {
+#if defined(__GNUC__)
+            return __builtin_mul_overflow(a, b, result);
+#else
+            if (a != 0 && b != 0)
+            {
+                if ((a == -1 && b == INT64_MIN) || (b == -1 && a == INT64_MIN)) return true;
+                if (a > 0 ? (b > 0 ? a > INT64_MAX / b : b < INT64_MIN / a) : (b > 0 ? a < INT64_MIN / b : a < INT64_MAX / b)) return true;
+            }
+            *result = a * b;
+            return false;
+#endif
+        }
+
+        // Only exact divisions stay integers, 7 / 2 is 3.5
+        static inline bool checkedDivide(std::int64_t a, std::int64_t b, std::int64_t* result)
+        {
+            if (b == 0 || (a == INT64_MIN && b == -1) || a % b != 0) return true;
+            *result = a / b;
+            return false;
+        }
+
+        // Exact ordering of an integer and a double, the integer isn't rounded to a double (2^53 + 1 > 2^53.0) :
+        // -1, 0 or 1, NaN when the double is NaN, so 'compareMixed(a, b) op 0.0' is exactly 'a op b' for every comparison
+        // Consistent with Value::isEquals
+        static inline double compareMixed(std::int64_t a, double b)
+        {
+            if (b != b) return b;
+            if (b >= 9223372036854775808.0) return -1.0;
+            if (b < -9223372036854775808.0) return 1.0;
+            // In range, the truncation is exact and so is the fractional part
+            std::int64_t integral = (std::int64_t)b;
+            if (a != integral) return a < integral ? -1.0 : 1.0;
+            double fraction = b - (double)integral;
+            return fraction > 0.0 ? -1.0 : fraction < 0.0 ? 1.0 : 0.0;
+        }
+};
+
+#endif // ARITHMETIC_HPP
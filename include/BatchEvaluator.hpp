@@ -0,0 +1,98 @@
+#ifndef BATCHEVALUATOR_HPP
+#define BATCHEVALUATOR_HPP
+
+#include "VirtualMachine.hpp"
+
+// Lanes evaluated by each pass over the instructions, the dispatch of an instruction is paid once per block of lanes
+#define BATCH_LANES 256
+
+// Executes one chunk for many entities at once, e.g. the same formula for every entity of a game tick
+// The inputs are host columns (structure of arrays) : one array of doubles per input slot, one element per lane
+// Each instruction runs over a whole block of lanes :
+//  - constants and everything computed only from constants are evaluated once for the block
+//  - numeric columns go through SIMD kernels (SSE2 when available, plain loops otherwise)
+//  - lanes holding different types (e.g. the results of a native function) fall back to the scalar semantics of
+//    VirtualMachine, lane by lane
+// Results are the same as executing the chunk once per lane with VirtualMachine::execute, there is no trace nor profiling
+// Globals are the same for every lane : chunks assigning them are refused, each lane would see the previous ones
+// Same threading rules as a VirtualMachine : an evaluator is used by one thread at a time, verified chunks are shared
+class BatchEvaluator
+{
+    public:
+        BatchEvaluator();
+        ~BatchEvaluator();
+
+        BatchEvaluator(const BatchEvaluator&) = delete;
+        BatchEvaluator& operator=(const BatchEvaluator&) = delete;
+
+        // Column read by the input slot (see Environment::addInput), one value per lane
+        // It is not copied : it must live while executing
+        void setInput(std::size_t slot, const double* column);
+
+        // Value read by the global (see Environment::addGlobal) in every lane, null until set
+        // Same as VirtualMachine::setGlobal : false for an object
+        bool setGlobal(std::size_t index, Value value);
+
+        // Evaluates the chunk for count lanes, results receives one value per lane
+        // On a runtime error the failing lane is reported and the following results are not written
+        VirtualMachine::InterpretResult execute(const Chunk& chunk, std::size_t count, Value* results);
+
+        // Objects created while executing (e.g. concatenated strings) live until the heap is reset
+        void resetHeap();
+
+    private:
+        // Representation of one stack slot over a block of lanes
+        enum Kind
+        {
+            Kind_Uniform,   // the same value in every lane
+            Kind_Doubles,   // a double in every lane, in numbers
+            Kind_Bools,     // a bool in every lane
+            Kind_Values     // any value in every lane
+        };
+
+        struct Column
+        {
+            Kind kind;
+            Value uniform;
+            // Either the storage of the column or a block of an input column
+            const double* numbers;
+            double* doubles;
+            std::uint8_t* bools;
+            Value* values;
+        };
+
+        void reserveColumns(std::size_t depth);
+
+        static Value laneValue(const Column& column, std::size_t lane);
+        // Copies the lanes into the storage of the destination, only blocks of input columns are shared
+        static void copyColumn(Column& destination, const Column& source, std::size_t lanes);
+        // Moves a column of values back to a faster kind when all its lanes have the same type
+        static void normalize(Column& column, std::size_t lanes);
+
+        VirtualMachine::InterpretResult runBlock(std::size_t first, std::size_t lanes, Value* results);
+        bool binary(std::uint8_t instruction, Column& a, const Column& b, std::size_t lanes);
+        bool unary(std::uint8_t instruction, Column& column, std::size_t lanes);
+        bool callNative(const ObjNative* native, Column* arguments, std::size_t argumentCount, std::size_t lanes);
+
+        // Scalar semantics, the same as the VirtualMachine handlers, false on a runtime error
+        bool binaryScalar(std::uint8_t instruction, const Value& a, const Value& b, Value* result);
+        bool unaryScalar(std::uint8_t instruction, const Value& value, Value* result);
+
+        void runtimeError(std::size_t offset, std::size_t lane);
+
+        const Chunk* mChunk;
+        const double* mInputs[ENVIRONMENT_MAX_INPUTS];
+        Value mGlobals[ENVIRONMENT_MAX_GLOBALS];
+
+        Column* mColumns;
+        std::size_t mColumnCapacity;
+
+        // Message of the last runtime error and the lane of the block where it happened
+        const char* mError;
+        char mErrorBuffer[128];
+        std::size_t mErrorLane;
+
+        Heap mHeap;
+};
+
+#endif // BATCHEVALUATOR_HPP
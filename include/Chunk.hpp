@@ -1,53 +1,74 @@
 #ifndef CHUNK_HPP
 #define CHUNK_HPP
 
+#include "OpCodes.hpp"
 #include "Value.hpp"
 
 // TODO : Chunks of Bytecode : Challenge 1
 // TODO : Chunks of Bytecode : Challenge 2
 
+// Once verified (Compiler::compile does it) a chunk is only read while running, so the same chunk can be executed by
+// several VirtualMachine at the same time, on different threads, without copying it
 class Chunk
 {
     public:
         enum OpCode
         {
-            Op_Constant,
-            Op_Null,
-            Op_True,
-            Op_False,
-            Op_Equal,
-            Op_BangEqual,
-            Op_Greater,
-            Op_GreaterEqual,
-            Op_Less,
-            Op_LessEqual,
-            Op_Add,
-            Op_Substract,
-            Op_Multiply,
-            Op_Divide,
-            Op_Not,
-            Op_Negate,
-            Op_Return,
+            #define BLISSX_OPCODE_ENUM(name, format, pops, pushes) Op_##name,
+            BLISSX_OPCODES(BLISSX_OPCODE_ENUM)
+            #undef BLISSX_OPCODE_ENUM
+
+            Op_Count
         };
 
         Chunk();
         ~Chunk();
 
+        // Opcode and operand bytes of a valid instruction (below Op_Count), see the formats in OpCodes.hpp
+        static std::size_t getInstructionLength(std::uint8_t instruction);
+
+        // The name is kept
         void clear();
+        // Same as clear, but the code, lines and constants buffers are kept for the next compilation
+        void reset();
+
+        // Used by the debug and profiling output, "script" by default
+        void setName(const char* name);
+        const char* getName() const;
 
         void push(std::uint8_t byte, int line);
         void reserve(std::size_t size);
 
         std::size_t addConstant(Value value);
 
+        // Makes the chunk a view of code, lines and constants it doesn't own (see Snapshot), they must outlive it
+        // The objects of the constants aren't in the heap of the chunk. The chunk must be verified again
+        // Pushing code or constants copies them first
+        void setExternal(const std::uint8_t* code, const int* lines, std::size_t count, Value* constants, std::size_t constantCount);
+
         std::size_t size() const;
         std::size_t capacity() const;
+        std::size_t constantCount() const;
 
         const int& getLine(std::size_t index) const;
         const std::uint8_t& getCode(std::size_t index) const;
         const Value& getConstant(std::size_t constantIndex) const;
 
-        std::uint8_t* beginOfCode();
+        const std::uint8_t* beginOfCode() const;
+
+        // Owner of the objects referenced by the constants
+        Heap& getHeap();
+
+        // Set by the Verifier, any modification of the chunk invalidates it
+        void setVerified(std::size_t maxStackDepth, std::size_t inputCount, std::size_t globalCount);
+        bool isVerified() const;
+        std::size_t getMaxStackDepth() const;
+        // Number of inputs the execution must provide : one more than the highest slot read by Op_GetInput
+        std::size_t getInputCount() const;
+        // Number of globals the VM must hold : one more than the highest index used by Op_GetGlobal or Op_SetGlobal
+        std::size_t getGlobalCount() const;
+        // Different for every verification, even of another chunk at the same address : caches of translated code use it
+        std::uint64_t getVerifiedId() const;
 
     private:
         std::size_t mCount;
@@ -55,6 +76,13 @@ class Chunk
         std::uint8_t* mCode;
         int* mLines;
         ValueArray mConstants;
+        Heap mHeap;
+        char* mName;
+        std::size_t mMaxStackDepth;
+        std::size_t mInputCount;
+        std::size_t mGlobalCount;
+        std::uint64_t mVerifiedId;
+        bool mVerified;
 };
 
 #endif // CHUNK_HPP
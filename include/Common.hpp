@@ -3,7 +3,28 @@
 
 #include <cstdint>
 
-#define DEBUG_PRINT_CODE
-#define DEBUG_TRACE_EXECUTION
+// Dispatch strategy of VirtualMachine::run, chosen at build time by defining one of :
+//  - BLISSX_DISPATCH_SWITCH : a single switch in a loop (portable)
+//  - BLISSX_DISPATCH_COMPUTED_GOTO : table of label addresses, each handler ends with its own indirect jump (GCC, Clang)
+//  - BLISSX_DISPATCH_TAIL_CALL : one function per handler, chained with guaranteed tail calls (Clang)
+#if !defined(BLISSX_DISPATCH_SWITCH) && !defined(BLISSX_DISPATCH_COMPUTED_GOTO) && !defined(BLISSX_DISPATCH_TAIL_CALL)
+    #if defined(__GNUC__)
+        #define BLISSX_DISPATCH_COMPUTED_GOTO
+    #else
+        #define BLISSX_DISPATCH_SWITCH
+    #endif
+#endif
+
+// Define BLISSX_TOS_CACHING to keep the top of the stack in a local (register) across instructions in VirtualMachine::run
+// It is only written back to the stack when an instruction needs deeper access, on runtime errors and on return
+
+// Define BLISSX_PROFILE_OPCODES to count and time the executed instructions (see OpCodeProfile)
+// This slows the interpreter down, it is meant for dedicated profiling builds
+
+// BLISSX_JIT compiles hot chunks to native code (see Jit), on x86-64 Linux only
+// Define BLISSX_NO_JIT to keep the interpreter only, profiling builds never use it since they count every instruction
+#if !defined(BLISSX_NO_JIT) && defined(__x86_64__) && defined(__linux__) && !defined(BLISSX_PROFILE_OPCODES)
+    #define BLISSX_JIT
+#endif
 
 #endif // COMMON_HPP
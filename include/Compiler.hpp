@@ -2,8 +2,18 @@
 #define COMPILER_HPP
 
 #include "Chunk.hpp"
-#include "Scanner.hpp"
+#include "Environment.hpp"
+#include "TokenStream.hpp"
+#include "TypeInference.hpp"
 
+// Locals are read by a one byte operand
+#define COMPILER_MAX_LOCALS (UINT8_MAX + 1)
+
+// A script is a sequence of statements : variable declarations and expressions ending with ';', the last one may omit it
+// Its result is the value of its last statement when it is an expression, null otherwise
+// Names are resolved while compiling, nothing is looked up by name while running :
+//  - locals declared by var are stack slots, in order of declaration
+//  - inputs, globals and native functions are the indices the environment gives them (see Environment)
 class Compiler
 {
     public:
@@ -30,7 +40,7 @@ class Compiler
             bool panicMode;
         };
 
-        typedef void (*ParseFn)();
+        typedef void (Compiler::*ParseFn)(bool canAssign);
 
         struct ParseRule
         {
@@ -39,38 +49,82 @@ class Compiler
             Precedence precedence;
         };
 
-        Compiler() = delete;
+        struct Local
+        {
+            Token name;
+            // Type of the value last stored into the slot, see TypeInference
+            TypeInference::Type type;
+        };
+
+        Compiler();
+
+        Compiler(const Compiler&) = delete;
+        Compiler& operator=(const Compiler&) = delete;
 
-        static bool compile(const char* source, Chunk* chunk);
+        // The chunk is verified once compiled, it can then be shared between VirtualMachine (see Chunk)
+        // A compiler keeps its buffers from one compilation to the next, one compiler can't be used by several threads at once
+        bool compile(const char* source, Chunk* chunk);
+
+        // Native functions callable and inputs readable by the compiled scripts, none by default
+        void setEnvironment(const Environment* environment);
 
     private:
-        static void advance();
-        static void errorAtCurrent(const char* message);
-        static void errorAt(Token* token, const char* message);
-        static void consume(Token::Type type, const char* message);
-
-        static void emitByte(std::uint8_t byte);
-        static void emitBytes(std::uint8_t byte1, std::uint8_t byte2);
-        static void emitReturn();
-        static void emitConstant(Value value);
-        static void endCompiler();
-
-        static void literal();
-        static void binary();
-        static void grouping();
-        static void number();
-        static void string();
-        static void unary();
-        static void expression();
-        static void parsePrecedence(Precedence precedence);
+        void advance();
+        // Token after current, lexing is done up front so any distance is available
+        Token peekToken(std::size_t distance);
+        void errorAtCurrent(const char* message);
+        void errorAt(Token* token, const char* message);
+        void consume(Token::Type type, const char* message);
+        bool match(Token::Type type);
+        // The statement ends with a semicolon, or with the end of the script
+        void endStatement(const char* message);
+        // Skips to the start of the next statement after an error
+        void synchronize();
+
+        void emitByte(std::uint8_t byte);
+        void emitBytes(std::uint8_t byte1, std::uint8_t byte2);
+        void emitReturn();
+        void emitConstant(Value value);
+        // Emits the unchecked variant of the instruction when the operand types allow it, reports it at the operator
+        // when it would always fail. Left is ignored for unary operators
+        void emitTyped(Chunk::OpCode instruction, Token* op, TypeInference::Type left, TypeInference::Type right);
+        void endCompiler();
+
+        void literal(bool canAssign);
+        void binary(bool canAssign);
+        void grouping(bool canAssign);
+        void number(bool canAssign);
+        void integer(bool canAssign);
+        void string(bool canAssign);
+        void unary(bool canAssign);
+        void identifier(bool canAssign);
+        void native();
+        void expression();
+        // True for an expression statement, its value stays on the stack
+        bool declaration();
+        void varDeclaration();
+        void parsePrecedence(Precedence precedence);
+
+        void addLocal(Token name);
+        // Slot of the local, -1 when the name isn't a local
+        int resolveLocal(const Token& name) const;
 
         static const ParseRule* getRule(Token::Type type);
-        static Chunk* currentChunk();
-        static std::uint8_t makeConstant(Value value);
+        Chunk* currentChunk();
+        std::uint8_t makeConstant(Value value);
+        std::uint8_t makeNative(const NativeBinding& binding);
 
     private:
-        static Chunk* mChunk;
-        static Parser mParser;
+        Chunk* mChunk;
+        const Environment* mEnvironment;
+        Parser mParser;
+        TokenStream mTokens;
+        std::size_t mTokenIndex;
+        // Type of the last compiled expression, operators with proven operand types get unchecked instructions
+        TypeInference::Type mType;
+        // Declared locals, the slot of a local is its index : the values of expression statements are popped
+        Local mLocals[COMPILER_MAX_LOCALS];
+        int mLocalCount;
         static const ParseRule mRules[];
 };
 
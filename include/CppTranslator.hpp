@@ -0,0 +1,22 @@
+#ifndef CPPTRANSLATOR_HPP
+#define CPPTRANSLATOR_HPP
+
+#include "Chunk.hpp"
+#include "OutputSink.hpp"
+
+// Translates a verified chunk to a C++ translation unit defining an AotDefinition named identifier (see AotScript)
+// - constants are static : numbers are literals, strings are static objects
+// - every stack slot is a local, typed when its type is known while translating (constants, typed results),
+//   so the C++ compiler sees plain arithmetic and only the unknown values keep their runtime checks
+// - native functions are called by name, resolved when the script is linked to an environment
+// The translated code has the semantics and the runtime errors of VirtualMachine
+class CppTranslator
+{
+    public:
+        CppTranslator() = delete;
+
+        // False (reported on stderr) when the chunk isn't verified or the identifier isn't a valid C++ identifier
+        static bool translate(const Chunk& chunk, const char* identifier, OutputSink& sink);
+};
+
+#endif // CPPTRANSLATOR_HPP
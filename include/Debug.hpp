@@ -2,24 +2,27 @@
 #define DEBUG_HPP
 
 #include "Chunk.hpp"
-
-#include <cstdio>
+#include "OutputSink.hpp"
 
 class Debug
 {
     public:
         Debug() = delete;
 
-        static void disassembleChunk(const Chunk& chunk, const char* name);
+        static void disassembleChunk(const Chunk& chunk, const char* name, OutputSink& sink = OutputSink::getStandardOutput());
+
+        static std::size_t disassembleInstruction(const Chunk& chunk, std::size_t offset, OutputSink& sink = OutputSink::getStandardOutput());
 
-        static std::size_t disassembleInstruction(const Chunk& chunk, std::size_t offset);
+        static const char* getOpCodeName(std::uint8_t instruction);
 
-        static void printValue(Value value);
-        static void printObject(Value value);
+        static void printValue(Value value, OutputSink& sink = OutputSink::getStandardOutput());
+        static void printObject(Value value, OutputSink& sink = OutputSink::getStandardOutput());
 
     private:
-        static std::size_t constantInstruction(const char* name, const Chunk& chunk, std::size_t offset);
-        static std::size_t simpleInstruction(const char* name, std::size_t offset);
+        static std::size_t constantInstruction(const char* name, const Chunk& chunk, std::size_t offset, OutputSink& sink);
+        static std::size_t callInstruction(const char* name, const Chunk& chunk, std::size_t offset, OutputSink& sink);
+        static std::size_t byteInstruction(const char* name, const Chunk& chunk, std::size_t offset, OutputSink& sink);
+        static std::size_t simpleInstruction(const char* name, const Chunk& chunk, std::size_t offset, OutputSink& sink);
 };
 
 #endif // DEBUG_HPP
@@ -0,0 +1,224 @@
+#ifndef ENVIRONMENT_HPP
+#define ENVIRONMENT_HPP
+
+#include "Value.hpp"
+
+#include <climits>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+// Conversion between script values and the C++ types allowed in native function signatures
+// Everything is resolved at compile time, add a specialization to support another type
+template <typename T>
+struct NativeType
+{
+    static_assert(sizeof(T) == 0, "Unsupported type in a native function signature");
+};
+
+template <>
+struct NativeType<double>
+{
+    static bool is(const Value& value) { return value.isNumber(); }
+    static double from(const Value& value) { return value.asNumber(); }
+    static Value to(double value) { return Value(value); }
+};
+
+template <>
+struct NativeType<float>
+{
+    static bool is(const Value& value) { return value.isNumber(); }
+    static float from(const Value& value) { return (float)value.asNumber(); }
+    static Value to(float value) { return Value((double)value); }
+};
+
+// Doubles are truncated, those without an integer in range (NaN, infinities, beyond 2^63) are invalid arguments
+template <>
+struct NativeType<std::int64_t>
+{
+    static bool is(const Value& value) { return value.isInteger() || (value.isDouble() && value.asDouble() >= -9223372036854775808.0 && value.asDouble() < 9223372036854775808.0); }
+    static std::int64_t from(const Value& value) { return value.isInteger() ? value.asInteger() : (std::int64_t)value.asDouble(); }
+    static Value to(std::int64_t value) { return Value(value); }
+};
+
+template <>
+struct NativeType<int>
+{
+    static bool is(const Value& value) { return NativeType<std::int64_t>::is(value) && NativeType<std::int64_t>::from(value) >= INT_MIN && NativeType<std::int64_t>::from(value) <= INT_MAX; }
+    static int from(const Value& value) { return (int)NativeType<std::int64_t>::from(value); }
+    static Value to(int value) { return Value((std::int64_t)value); }
+};
+
+template <>
+struct NativeType<bool>
+{
+    static bool is(const Value& value) { return value.isBool(); }
+    static bool from(const Value& value) { return value.asBool(); }
+    static Value to(bool value) { return Value(value); }
+};
+
+// Only valid during the call, returning strings would need a heap
+template <>
+struct NativeType<const char*>
+{
+    static bool is(const Value& value) { return value.isString(); }
+    static const char* from(const Value& value) { return value.asCString(); }
+};
+
+template <>
+struct NativeType<Value>
+{
+    static bool is(const Value&) { return true; }
+    static Value from(const Value& value) { return value; }
+    static Value to(Value value) { return value; }
+};
+
+template <typename Signature>
+struct NativeSignature;
+
+template <typename R, typename... Args>
+struct NativeSignature<R (*)(Args...)>
+{
+    static constexpr int arity = (int)sizeof...(Args);
+
+    // Checks the argument types then calls the function, false if an argument has the wrong type
+    template <typename Function, std::size_t... I>
+    static bool invoke(Function function, const Value* arguments, Value* result, std::index_sequence<I...>)
+    {
+        if (!(true && ... && NativeType<std::decay_t<Args>>::is(arguments[I])))
+        {
+            return false;
+        }
+
+        if constexpr (std::is_void_v<R>)
+        {
+            function(NativeType<std::decay_t<Args>>::from(arguments[I])...);
+            *result = Value();
+        }
+        else
+        {
+            *result = NativeType<std::decay_t<R>>::to(function(NativeType<std::decay_t<Args>>::from(arguments[I])...));
+        }
+        return true;
+    }
+
+    template <typename Function>
+    static bool invoke(Function function, const Value* arguments, Value* result)
+    {
+        return invoke(function, arguments, result, std::index_sequence_for<Args...>());
+    }
+};
+
+// Most libc and libm functions are declared noexcept, as may be the lambdas given to bind
+template <typename R, typename... Args>
+struct NativeSignature<R (*)(Args...) noexcept> : NativeSignature<R (*)(Args...)>
+{
+};
+
+// Type of a function pointer without the attributes of its declaration (e.g. glibc declares hypot const),
+// which g++ warns about when they reach a template argument. Only used in decltype
+template <typename R, typename... Args>
+auto nativePointer(R (*)(Args...)) -> R (*)(Args...);
+template <typename R, typename... Args>
+auto nativePointer(R (*)(Args...) noexcept) -> R (*)(Args...) noexcept;
+
+// Inputs and globals are read by a one byte operand
+#define ENVIRONMENT_MAX_INPUTS (UINT8_MAX + 1)
+#define ENVIRONMENT_MAX_GLOBALS (UINT8_MAX + 1)
+
+struct NativeBinding
+{
+    const char* name;
+    int length;
+    NativeThunk thunk;
+    NativeFunction function;
+    int arity;
+};
+
+// Host functions callable from scripts, resolved by name when compiling (see VirtualMachine::setEnvironment)
+// The compiled chunk keeps its own copy of the bindings it calls, the environment only has to live while compiling
+// Binding is not thread safe, an environment can be shared by several compilers once it is filled
+class Environment
+{
+    public:
+        Environment();
+        ~Environment();
+
+        Environment(const Environment&) = delete;
+        Environment& operator=(const Environment&) = delete;
+
+        // Function known at compile time : the call is inlined into its thunk
+        // e.g. environment.bind<&hypot>("hypot")
+        template <auto Function>
+        void bind(const char* name)
+        {
+            typedef NativeSignature<decltype(nativePointer(Function))> Signature;
+            static_assert(Signature::arity <= UINT8_MAX, "Too many parameters for a native function");
+            add(name, &staticThunk<Function>, nullptr, Signature::arity);
+        }
+
+        // Function pointer or lambda without captures, called through a pointer
+        // e.g. environment.bind("log", [](const char* message) { puts(message); })
+        template <typename F>
+        void bind(const char* name, F function)
+        {
+            auto pointer = +function;
+            typedef NativeSignature<decltype(pointer)> Signature;
+            static_assert(Signature::arity <= UINT8_MAX, "Too many parameters for a native function");
+            add(name, &pointerThunk<decltype(pointer)>, reinterpret_cast<NativeFunction>(pointer), Signature::arity);
+        }
+
+        const NativeBinding* find(const char* name, int length) const;
+
+        std::size_t size() const;
+
+        // Named value read by the scripts, given to each execution (see VirtualMachine::execute, BatchEvaluator::setInput)
+        // Returns the slot of the input, the same slot when the name is already an input, -1 when there are too many inputs
+        int addInput(const char* name);
+        int findInput(const char* name, int length) const;
+        std::size_t inputCount() const;
+
+        // Named value kept by each VirtualMachine from one execution to the next, read and assigned by the scripts
+        // The scripts reach it by its index (see VirtualMachine::setGlobal), names are only used while compiling
+        // Returns the index of the global, the same index when the name is already a global, -1 when there are too many globals
+        int addGlobal(const char* name);
+        int findGlobal(const char* name, int length) const;
+        std::size_t globalCount() const;
+
+    private:
+        // Copies of the names of the inputs or of the globals, the position of a name is its slot
+        struct Names
+        {
+            std::size_t count;
+            std::size_t capacity;
+            char** names;
+        };
+
+        static int addName(Names& names, const char* name, std::size_t max);
+        static int findName(const Names& names, const char* name, int length);
+        static void freeNames(Names& names);
+
+        template <auto Function>
+        static bool staticThunk(NativeFunction, const Value* arguments, Value* result)
+        {
+            return NativeSignature<decltype(nativePointer(Function))>::invoke(Function, arguments, result);
+        }
+
+        template <typename Pointer>
+        static bool pointerThunk(NativeFunction function, const Value* arguments, Value* result)
+        {
+            return NativeSignature<Pointer>::invoke(reinterpret_cast<Pointer>(function), arguments, result);
+        }
+
+        void add(const char* name, NativeThunk thunk, NativeFunction function, int arity);
+
+    private:
+        std::size_t mCount;
+        std::size_t mCapacity;
+        NativeBinding* mBindings;
+
+        Names mInputs;
+        Names mGlobals;
+};
+
+#endif // ENVIRONMENT_HPP
@@ -0,0 +1,32 @@
+#ifndef HEAP_HPP
+#define HEAP_HPP
+
+#include "Memory.hpp"
+
+struct Obj;
+
+// Owner of a set of objects, freed all together with the heap
+// A heap is not thread safe : a chunk owns the objects of its constants, a VirtualMachine the objects created while running
+class Heap
+{
+    public:
+        Heap();
+        ~Heap();
+
+        Heap(const Heap&) = delete;
+        Heap& operator=(const Heap&) = delete;
+
+        void add(Obj* object);
+        void clear();
+
+        std::size_t size() const;
+
+    private:
+        static void freeObject(Obj* object);
+
+    private:
+        Obj* mObjects;
+        std::size_t mCount;
+};
+
+#endif // HEAP_HPP
@@ -0,0 +1,88 @@
+#ifndef JIT_HPP
+#define JIT_HPP
+
+#include "Chunk.hpp"
+#include "Common.hpp"
+
+#ifdef BLISSX_JIT
+
+#include "X64Assembler.hpp"
+
+// Executions of a chunk in the interpreter before it is compiled to native code
+#define JIT_DEFAULT_THRESHOLD 64
+// Shorter chunks (in bytes of code) are always interpreted : entering native code costs more than it saves on them
+#define JIT_MIN_CHUNK_SIZE 16
+// Past this number of chunks the cache of a VM is emptied
+#define JIT_MAX_CHUNKS 1024
+
+// Native code of one chunk, made by Jit
+struct JitCode
+{
+    // Where the native code stopped : the instruction the interpreter continues with, and the number of values on the stack
+    // Stopping on the Op_Return means the chunk completed, its result is on the top of the stack
+    struct Exit
+    {
+        std::size_t offset;
+        std::size_t depth;
+    };
+
+    // Read and execute only, the pages are never writable once the code is in them
+    void* memory;
+    std::size_t size;
+
+    // stack is the first slot of a stack with room for the maximum depth of the chunk, globals has room for its globals
+    Exit run(Value* stack, const Value* inputs, Value* globals) const;
+};
+
+// Baseline JIT of a VirtualMachine : chunks executed often enough are translated to x86-64 code, one template per instruction
+// The values stay in the stack of the VM, with the same representation and the same semantics as in the interpreter :
+// - the types known while translating (constants, results of typed instructions) need no check
+// - the other ones are checked, and anything the templates don't handle (strings, errors, ...) goes back to the
+//   interpreter at the current instruction, nothing of this instruction having been done yet
+// The code is owned by the VM : it is never shared between threads
+class Jit
+{
+    public:
+        Jit();
+        ~Jit();
+
+        Jit(const Jit&) = delete;
+        Jit& operator=(const Jit&) = delete;
+
+        void setThreshold(std::size_t executions);
+        std::size_t getThreshold() const;
+
+        // Counts one execution of the chunk, its native code once it is hot, nullptr while it must be interpreted
+        const JitCode* enter(const Chunk& chunk);
+
+        // Frees all the native code
+        void clear();
+
+    private:
+        struct Entry
+        {
+            const Chunk* chunk;
+            // Chunk::getVerifiedId of the chunk when it was counted, another id is another bytecode at the same address
+            std::uint64_t id;
+            std::size_t executions;
+            // Translated at most once, memory stays null if it failed
+            bool translated;
+            JitCode code;
+        };
+
+        Entry* findEntry(const Chunk* chunk);
+        std::size_t slotOf(const Chunk* chunk) const;
+        bool translate(const Chunk& chunk, JitCode* code);
+        void freeCode(JitCode* code);
+
+        Entry* mEntries;
+        std::size_t mCount;
+        std::size_t mCapacity;
+        std::size_t mThreshold;
+
+        X64Assembler mAssembler;
+};
+
+#endif // BLISSX_JIT
+
+#endif // JIT_HPP
@@ -0,0 +1,82 @@
+#ifndef LINEPROFILER_HPP
+#define LINEPROFILER_HPP
+
+#include "Chunk.hpp"
+#include "OutputSink.hpp"
+
+#include <atomic>
+
+// Sampling profiler of the script lines, attached to VirtualMachine with setLineProfiler
+// A sample records the chunk and the line of the instruction about to be executed, it is taken either :
+//  - every 'interval' instructions (deterministic, counts instructions rather than time)
+//  - when the profiling timer fires (startTimer, POSIX only) : proportional to the CPU time
+// The VM only checks for samples in a dedicated instantiation of its loop, without profiler there is no cost at all
+// A profiler must only be used by one VM at a time, the timer is process wide : with several VMs each tick is taken
+// by the first profiled VM that sees it
+class LineProfiler
+{
+    public:
+        // interval 0 : only sample on timer ticks
+        LineProfiler(std::uint32_t interval = 0);
+        ~LineProfiler();
+
+        LineProfiler(const LineProfiler&) = delete;
+        LineProfiler& operator=(const LineProfiler&) = delete;
+
+        static bool startTimer(std::uint32_t periodMicroseconds);
+        static void stopTimer();
+
+        // Called by the VM before every instruction
+        bool shouldSample()
+        {
+            if (mInterval != 0 && --mCountdown == 0)
+            {
+                mCountdown = mInterval;
+                return true;
+            }
+            // Relaxed load first, the exchange only happens once the timer fired
+            if (sTimerTicks.load(std::memory_order_relaxed) != 0 && sTimerTicks.exchange(0, std::memory_order_relaxed) != 0)
+            {
+                return true;
+            }
+            return false;
+        }
+
+        void sample(const Chunk& chunk, std::size_t offset);
+
+        void clear();
+
+        std::uint64_t getSampleCount() const;
+
+        // One line per sampled source line : "chunk;chunk:line count", the format of flamegraph.pl and speedscope
+        void writeFolded(OutputSink& sink) const;
+
+    private:
+        struct Entry
+        {
+            char* name;
+            int nameLength;
+            int line;
+            std::uint64_t count;
+        };
+
+        static std::uint32_t hash(const char* name, int nameLength, int line);
+        void grow();
+
+        static void onTimer(int signal);
+
+    private:
+        std::uint32_t mInterval;
+        std::uint32_t mCountdown;
+        std::uint64_t mSampleCount;
+
+        // Open addressing, keyed by chunk name and line
+        std::size_t mCount;
+        std::size_t mCapacity;
+        Entry* mEntries;
+
+        // Set by the signal handler and cleared by every profiled VM, whatever its thread : lock-free so it is signal safe
+        static std::atomic<int> sTimerTicks;
+};
+
+#endif // LINEPROFILER_HPP
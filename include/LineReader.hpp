@@ -0,0 +1,45 @@
+#ifndef LINEREADER_HPP
+#define LINEREADER_HPP
+
+#include "Common.hpp"
+
+#include <cstddef>
+#include <cstdio>
+
+// Size of the blocks read from the file
+#define LINEREADER_BLOCK_SIZE (64 * 1024)
+
+// Lines of a file read in large blocks, for a stream of expressions (blissx --stream)
+// Lines are returned in place, without copy, and can be of any length : the buffer grows to hold the longest one
+// Reading blocks waits for them to be full, this is meant for pipelines and not for interactive input
+class LineReader
+{
+    public:
+        LineReader(FILE* file, std::size_t blockSize = LINEREADER_BLOCK_SIZE);
+        ~LineReader();
+
+        LineReader(const LineReader&) = delete;
+        LineReader& operator=(const LineReader&) = delete;
+
+        // Next line without its newline, terminated by '\0' and valid until the next call
+        // A last line without newline is returned too, nullptr at the end of the file
+        const char* next();
+
+        // The file couldn't be read to its end
+        bool hasError() const;
+
+    private:
+        // Moves the incomplete line to the front, grows the buffer when it is full, then reads a block after it
+        void fill();
+
+        FILE* mFile;
+        std::size_t mBlockSize;
+        char* mBuffer;
+        std::size_t mCapacity;
+        // Bytes not returned yet
+        std::size_t mBegin;
+        std::size_t mEnd;
+        bool mEndOfFile;
+};
+
+#endif // LINEREADER_HPP
@@ -0,0 +1,90 @@
+#ifndef OPCODEPROFILE_HPP
+#define OPCODEPROFILE_HPP
+
+#include "Chunk.hpp"
+#include "OutputSink.hpp"
+
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#endif
+
+// One instruction out of this many is timed, a prime avoids aliasing with the period of loops and repeated sequences
+#ifndef BLISSX_PROFILE_SAMPLE_INTERVAL
+    #define BLISSX_PROFILE_SAMPLE_INTERVAL 97
+#endif
+
+// Execution statistics of the instructions run by one VirtualMachine (built with BLISSX_PROFILE_OPCODES)
+// Counts every instruction and every pair of consecutive instructions, and samples the time spent in instructions :
+// the time from the dispatch of a sampled instruction to the dispatch of the next one, in cycles (rdtsc) on x86,
+// in nanoseconds elsewhere. The cost of recording itself is included, compare opcodes relatively to each other.
+class OpCodeProfile
+{
+    public:
+        OpCodeProfile();
+
+        void reset();
+
+        // Called by the interpreter around each run and before each instruction
+        void beginRun();
+        void endRun();
+        void record(std::uint8_t instruction)
+        {
+            if (mSampling)
+            {
+                mTicks[mSampled] += now() - mSampleStart;
+                mSamples[mSampled]++;
+                mSampling = false;
+            }
+
+            mCounts[instruction]++;
+            if (mPrevious != Chunk::Op_Count)
+            {
+                mPairs[mPrevious][instruction]++;
+            }
+            mPrevious = instruction;
+
+            if (--mCountdown == 0)
+            {
+                mCountdown = BLISSX_PROFILE_SAMPLE_INTERVAL;
+                mSampled = instruction;
+                mSampling = true;
+                mSampleStart = now();
+            }
+        }
+
+        std::uint64_t getCount(std::uint8_t instruction) const;
+        std::uint64_t getPairCount(std::uint8_t first, std::uint8_t second) const;
+        // Average time of the instruction over its samples, 0 if it was never sampled
+        double getAverageTicks(std::uint8_t instruction) const;
+        static const char* getTickUnit();
+
+        // Opcodes sorted by execution count, then the most frequent pairs
+        void report(OutputSink& sink, std::size_t maxPairs = 20) const;
+        // Same data as JSON, every opcode and every pair executed at least once
+        void reportJson(OutputSink& sink) const;
+
+    private:
+        static std::uint64_t now()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#else
+            return (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+        }
+
+    private:
+        std::uint64_t mCounts[Chunk::Op_Count];
+        std::uint64_t mPairs[Chunk::Op_Count][Chunk::Op_Count];
+        std::uint64_t mTicks[Chunk::Op_Count];
+        std::uint64_t mSamples[Chunk::Op_Count];
+
+        std::uint8_t mPrevious;
+        std::uint8_t mSampled;
+        bool mSampling;
+        std::uint32_t mCountdown;
+        std::uint64_t mSampleStart;
+};
+
+#endif // OPCODEPROFILE_HPP
@@ -0,0 +1,63 @@
+#ifndef OPCODES_HPP
+#define OPCODES_HPP
+
+// Single definition of the instruction set, used to generate Chunk::OpCode, the disassembler, the verifier and the interpreter dispatch
+// OPCODE(name, format, pops, pushes) :
+//  - the opcode is Chunk::Op_<name>
+//  - format is the operand layout (Simple : no operand, Constant : one byte indexing the constants of the chunk,
+//    Call : one byte indexing the constants of the chunk then one byte for the argument count,
+//    Input : one byte indexing the inputs given to the execution, see Environment::addInput,
+//    Local : one byte indexing the stack from its bottom, Global : one byte indexing the globals of the VM, see Environment::addGlobal)
+//  - pops and pushes are the number of values the instruction takes from and leaves on the stack,
+//    Call instructions also pop their argument count, Set instructions leave the value they stored on the stack
+// The Number and Double variants are unchecked : the compiler only emits them when the types of the operands are proven
+// (numbers, with at least one double for the Double variants), see TypeInference. The verifier proves it again
+#define BLISSX_OPCODES(OPCODE) \
+    OPCODE(Constant, Constant, 0, 1) \
+    OPCODE(Null, Simple, 0, 1) \
+    OPCODE(True, Simple, 0, 1) \
+    OPCODE(False, Simple, 0, 1) \
+    OPCODE(GetInput, Input, 0, 1) \
+    OPCODE(GetLocal, Local, 0, 1) \
+    OPCODE(SetLocal, Local, 1, 1) \
+    OPCODE(GetGlobal, Global, 0, 1) \
+    OPCODE(SetGlobal, Global, 1, 1) \
+    OPCODE(Pop, Simple, 1, 0) \
+    OPCODE(Equal, Simple, 2, 1) \
+    OPCODE(BangEqual, Simple, 2, 1) \
+    OPCODE(Greater, Simple, 2, 1) \
+    OPCODE(GreaterEqual, Simple, 2, 1) \
+    OPCODE(Less, Simple, 2, 1) \
+    OPCODE(LessEqual, Simple, 2, 1) \
+    OPCODE(Add, Simple, 2, 1) \
+    OPCODE(Substract, Simple, 2, 1) \
+    OPCODE(Multiply, Simple, 2, 1) \
+    OPCODE(Divide, Simple, 2, 1) \
+    OPCODE(Not, Simple, 1, 1) \
+    OPCODE(Negate, Simple, 1, 1) \
+    OPCODE(GreaterNumber, Simple, 2, 1) \
+    OPCODE(GreaterEqualNumber, Simple, 2, 1) \
+    OPCODE(LessNumber, Simple, 2, 1) \
+    OPCODE(LessEqualNumber, Simple, 2, 1) \
+    OPCODE(AddNumber, Simple, 2, 1) \
+    OPCODE(SubstractNumber, Simple, 2, 1) \
+    OPCODE(MultiplyNumber, Simple, 2, 1) \
+    OPCODE(DivideNumber, Simple, 2, 1) \
+    OPCODE(NegateNumber, Simple, 1, 1) \
+    OPCODE(AddDouble, Simple, 2, 1) \
+    OPCODE(SubstractDouble, Simple, 2, 1) \
+    OPCODE(MultiplyDouble, Simple, 2, 1) \
+    OPCODE(DivideDouble, Simple, 2, 1) \
+    OPCODE(NegateDouble, Simple, 1, 1) \
+    OPCODE(CallNative, Call, 0, 1) \
+    OPCODE(Return, Simple, 1, 0)
+
+// Number of operand bytes following the opcode, per format
+#define BLISSX_OPERAND_SIZE_Simple 0
+#define BLISSX_OPERAND_SIZE_Constant 1
+#define BLISSX_OPERAND_SIZE_Call 2
+#define BLISSX_OPERAND_SIZE_Input 1
+#define BLISSX_OPERAND_SIZE_Local 1
+#define BLISSX_OPERAND_SIZE_Global 1
+
+#endif // OPCODES_HPP
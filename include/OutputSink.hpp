@@ -0,0 +1,78 @@
+#ifndef OUTPUTSINK_HPP
+#define OUTPUTSINK_HPP
+
+#include "Common.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+// Default capacity of a BufferedSink
+#define OUTPUT_BUFFER_SIZE (64 * 1024)
+
+// Destination of the text produced by the VM and the debug helpers
+class OutputSink
+{
+    public:
+        virtual ~OutputSink();
+
+        virtual void write(const char* data, std::size_t size) = 0;
+        virtual void flush();
+
+        void write(const char* string);
+        void print(const char* format, ...);
+
+        // Formatted without printf : the shortest text reading back as the same double, in the style of %g
+        // (e.g. 0.1, 100000, 1e+20, 3.141592653589793), and integers in decimal
+        void printNumber(double value);
+        void printInteger(std::int64_t value);
+
+        static OutputSink& getStandardOutput();
+};
+
+class FileSink : public OutputSink
+{
+    public:
+        FileSink(FILE* file);
+
+        void write(const char* data, std::size_t size) override;
+        void flush() override;
+
+        using OutputSink::write;
+
+    private:
+        FILE* mFile;
+};
+
+// Collects the writes in a buffer and passes it to its destination once full, or when flushed
+// Writes bigger than the buffer go straight to the destination
+// The destination must outlive the sink, or the sink be flushed before it is destroyed
+class BufferedSink : public OutputSink
+{
+    public:
+        BufferedSink(OutputSink* destination, std::size_t capacity = OUTPUT_BUFFER_SIZE);
+        ~BufferedSink() override;
+
+        BufferedSink(const BufferedSink&) = delete;
+        BufferedSink& operator=(const BufferedSink&) = delete;
+
+        void write(const char* data, std::size_t size) override;
+        // Writes the buffer to the destination, then flushes the destination
+        void flush() override;
+
+        using OutputSink::write;
+
+        // The buffer is flushed to the previous destination first
+        void setDestination(OutputSink* destination);
+        OutputSink* getDestination() const;
+
+    private:
+        void drain();
+
+        OutputSink* mDestination;
+        char* mBuffer;
+        std::size_t mSize;
+        std::size_t mCapacity;
+};
+
+#endif // OUTPUTSINK_HPP
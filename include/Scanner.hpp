@@ -24,7 +24,7 @@ struct Token
         Token_Less, Token_LessEqual,
 
         // Literals.
-        Token_Identifier, Token_String, Token_Number,
+        Token_Identifier, Token_String, Token_Number, Token_Integer,
 
         // Keywords.
         Token_And, Token_Class, Token_Else, Token_False,
@@ -43,23 +43,37 @@ struct Token
     const char* start;
     int length;
     int line;
+    // Value of a literal, parsed while scanning
+    union
+    {
+        double number;          // Token_Number
+        std::int64_t integer;   // Token_Integer
+        int decodedLength;      // Token_String : length of the value, without the quotes and with escapes decoded
+    };
 };
 
 class Scanner
 {
     public:
-        static Scanner& getInstance();
+        Scanner();
+        ~Scanner();
 
-        void newSource(const char* source);
+        void newSource(const char* source, int line = 1);
 
         Token scanToken();
 
+        // Start of the lexeme of the last scanned token (also valid for error tokens)
+        const char* getTokenStart() const;
+
+        // Writes the value of a Token_String (decodedLength bytes) : the lexeme was validated while scanning
+        // Escapes : \n \t \r \" \\ and \u{X} with 1 to 6 hexadecimal digits, written as UTF-8
+        static void decodeString(const Token& token, char* destination);
+
     private:
-        Scanner();
-        ~Scanner();
 
         Token string();
         Token number();
+        double parseNumber(std::uint64_t mantissa, int digits, int exponent) const;
         Token identifier();
 
         Token makeToken(Token::Type type) const;
@@ -80,6 +94,8 @@ class Scanner
     private:
         const char* mStart;
         const char* mCurrent;
+        // The terminating '\0', blocks of the string scanning never read past it
+        const char* mEnd;
         int mLine;
 };
 
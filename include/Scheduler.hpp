@@ -0,0 +1,146 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include "VirtualMachine.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Tasks run one after the other by a worker before it looks at its deque again, bigger ranges are split in two
+// so idle workers can steal half of them
+#define SCHEDULER_GRAIN 16
+
+class TaskGroup;
+
+// One execution of a verified chunk, see VirtualMachine::execute
+// The task is owned by the caller : it is only written by the worker running it, and must live until its group is done
+struct ScriptTask
+{
+    const Chunk* chunk;
+    // Chunk::getInputCount values, they must live until the task completed
+    const Value* inputs;
+
+    // Written once the task completed
+    Value result;
+    VirtualMachine::InterpretResult status;
+};
+
+// Completion of a set of submitted tasks, the future of a submission
+// A group can be reused for several submissions, it is done once all of them completed
+class TaskGroup
+{
+    public:
+        // Called by the worker thread right after each task of the group completed, while the objects of its result
+        // are still alive (e.g. to copy a string). It must not block, the worker waits for it
+        typedef void (*Callback)(ScriptTask& task, void* userData);
+
+        TaskGroup(Callback callback = nullptr, void* userData = nullptr);
+
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        // Blocks until every submitted task of the group completed
+        void wait();
+        // Once true the group is no longer used by the workers, it can be destroyed
+        bool isDone() const;
+
+    private:
+        friend class Scheduler;
+
+        void add(std::size_t count);
+        void complete(std::size_t count);
+
+        Callback mCallback;
+        void* mUserData;
+
+        std::atomic<std::size_t> mPending;
+        mutable std::mutex mMutex;
+        std::condition_variable mDone;
+};
+
+// Runs script tasks on a pool of worker threads, each one with its own VirtualMachine (see the threading model in
+// VirtualMachine.hpp) and its own deque of task ranges :
+//  - a submission is one range pushed to one worker, whatever the number of tasks
+//  - a worker takes its newest range first, splits it down to SCHEDULER_GRAIN tasks and pushes back the other halves
+//  - an idle worker steals the oldest range of another worker, so a big submission spreads over every worker
+//  - workers with nothing to run or steal sleep until a range is pushed
+// Results referencing objects (e.g. concatenated strings) live in the heap of the worker that ran the task,
+// until resetHeaps is called
+class Scheduler
+{
+    public:
+        // 0 workers : one per hardware thread
+        Scheduler(std::size_t workerCount = 0);
+        // There must not be any pending task
+        ~Scheduler();
+
+        Scheduler(const Scheduler&) = delete;
+        Scheduler& operator=(const Scheduler&) = delete;
+
+        // Queues count tasks which will complete in group, in any order
+        // Chunks must be verified, execution errors are reported in the status of each task
+        // Can be called from any thread, including from a callback
+        void submit(ScriptTask* tasks, std::size_t count, TaskGroup& group);
+
+        // Frees the objects created by the tasks, there must not be any pending task
+        void resetHeaps();
+
+        // Applied to the VM of every worker, there must not be any pending task (see VirtualMachine::setJitEnabled)
+        void setJitEnabled(bool enabled);
+
+        std::size_t getWorkerCount() const;
+
+    private:
+        struct Range
+        {
+            ScriptTask* tasks;
+            std::size_t count;
+            TaskGroup* group;
+        };
+
+        // Aligned so the deques of two workers never share a cache line
+        struct alignas(64) Worker
+        {
+            Worker();
+            ~Worker();
+
+            VirtualMachine virtualMachine;
+            std::thread thread;
+
+            // Ranges from head to head + count, the owner works at the end and thieves at the head
+            std::mutex mutex;
+            Range* ranges;
+            std::size_t head;
+            std::size_t count;
+            std::size_t capacity;
+
+            // State of the random choice of victims
+            std::uint32_t random;
+        };
+
+        void work(std::size_t index);
+
+        void push(Worker& worker, const Range& range);
+        bool popNewest(Worker& worker, Range* range);
+        bool popOldest(Worker& worker, Range* range);
+        bool steal(std::size_t thief, Range* range);
+        // False when the scheduler is being destroyed
+        bool sleep();
+
+        void run(Worker& worker, const Range& range);
+
+        Worker* mWorkers;
+        std::size_t mWorkerCount;
+        std::atomic<std::size_t> mNextWorker;
+
+        // Ranges in every deque, and workers sleeping until it isn't 0
+        std::atomic<std::size_t> mQueued;
+        std::atomic<std::size_t> mSleeping;
+        std::mutex mSleepMutex;
+        std::condition_variable mWake;
+        bool mStopping;
+};
+
+#endif // SCHEDULER_HPP
@@ -0,0 +1,56 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include "Chunk.hpp"
+#include "Environment.hpp"
+
+// Bumped whenever the layout of the image, of the objects or the instruction set changes, older images are refused
+#define SNAPSHOT_VERSION 3
+
+// Compiled chunks and values (e.g. the results of initialization scripts, with the objects they reference) saved
+// into an image file, so a program can start from it instead of compiling and running its scripts again
+// The image holds the objects with their in-memory layout, references being offsets from the start of the image :
+// opening it maps the file once, turns the offsets back into pointers in place (copy on write pages) and binds the
+// native functions by name, so the time to open it only depends on the number of objects, not on how they were built
+// Chunks are verified again when opening, a corrupted image is reported and never executed
+// Images are only read by builds of the same version on the same kind of machine (size of pointers, endianness)
+class Snapshot
+{
+    public:
+        Snapshot();
+        ~Snapshot();
+
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+
+        // Chunks must be verified. Strings with the same characters are saved once
+        // False (reported on stderr) when the file can't be written
+        static bool write(const char* path, const Chunk* const* chunks, std::size_t chunkCount, const Value* values, std::size_t valueCount);
+
+        // False (reported on stderr) when the file isn't a valid image, calls a native function missing from the
+        // environment or taking another argument count, or reads more inputs than the environment has
+        // The environment only has to live while opening
+        bool open(const char* path, const Environment* environment);
+        void close();
+
+        bool isOpen() const;
+
+        // Verified chunks and values, in the order they were written, valid until the snapshot is closed
+        // Chunks are only read : they can be executed by several VirtualMachine at the same time
+        std::size_t getChunkCount() const;
+        const Chunk& getChunk(std::size_t index) const;
+        std::size_t getValueCount() const;
+        const Value& getValue(std::size_t index) const;
+
+    private:
+        bool error(const char* path, const char* message);
+
+        char* mImage;
+        std::size_t mSize;
+        Chunk* mChunks;
+        std::size_t mChunkCount;
+        const Value* mValues;
+        std::size_t mValueCount;
+};
+
+#endif // SNAPSHOT_HPP
@@ -0,0 +1,37 @@
+#ifndef SOURCEFILE_HPP
+#define SOURCEFILE_HPP
+
+#include "Common.hpp"
+
+#include <cstddef>
+
+// Read-only view of a script file
+// On POSIX systems the file is mapped directly from the page cache (no copy)
+// The mapping is always followed by at least one zero byte, so the Scanner can still rely on '\0' to detect the end
+class SourceFile
+{
+    public:
+        SourceFile();
+        ~SourceFile();
+
+        SourceFile(const SourceFile&) = delete;
+        SourceFile& operator=(const SourceFile&) = delete;
+
+        bool open(const char* path);
+        void close();
+
+        bool isOpen() const;
+
+        const char* getSource() const;
+        std::size_t getSize() const;
+
+        // Hint the system that the source will be read front to back (scanning)
+        void adviseSequential();
+
+    private:
+        char* mData;
+        std::size_t mSize;
+        std::size_t mMappedSize;
+};
+
+#endif // SOURCEFILE_HPP
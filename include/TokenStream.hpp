@@ -0,0 +1,76 @@
+#ifndef TOKENSTREAM_HPP
+#define TOKENSTREAM_HPP
+
+#include "Scanner.hpp"
+
+#include <cstddef>
+
+// Sources bigger than this are split at line boundaries and lexed on several threads
+#define TOKENSTREAM_PARALLEL_THRESHOLD (1024 * 1024)
+#define TOKENSTREAM_MIN_SEGMENT_SIZE (256 * 1024)
+
+// Whole source lexed up front, stored as structure of arrays
+// Offsets are relative to the source, for error tokens the length column indexes the error messages instead
+class TokenStream
+{
+    public:
+        TokenStream();
+        ~TokenStream();
+
+        TokenStream(const TokenStream&) = delete;
+        TokenStream& operator=(const TokenStream&) = delete;
+
+        void clear();
+
+        void tokenize(const char* source);
+
+        std::size_t size() const;
+
+        // Index past the end returns the last token (which is always Token_EndOfFile)
+        Token getToken(std::size_t index) const;
+
+        Token::Type getType(std::size_t index) const;
+        std::uint32_t getOffset(std::size_t index) const;
+        std::uint32_t getLength(std::size_t index) const;
+        int getLine(std::size_t index) const;
+        double getNumber(std::size_t index) const;
+        std::int64_t getInteger(std::size_t index) const;
+
+    private:
+        void tokenizeSequential(const char* source, std::size_t size);
+        void tokenizeParallel(const char* source, std::size_t size, std::size_t segmentCount);
+
+        // Lex [begin, end) of source, with lines relative to begin
+        // Returns the offset of the first token starting at or after end (where the next segment has to resume)
+        std::uint32_t tokenizeSegment(const char* source, std::uint32_t begin, std::uint32_t end, bool last);
+
+        void push(const Token& token, std::uint32_t offset);
+        void append(const TokenStream& other, std::size_t from, int lineBase);
+        void reserve(std::size_t size);
+
+        std::size_t find(std::uint32_t offset) const;
+
+    private:
+        // Value of the number literals, decoded length of the strings
+        union Literal
+        {
+            double number;
+            std::int64_t integer;
+            int decodedLength;
+        };
+
+        const char* mSource;
+        std::size_t mCount;
+        std::size_t mCapacity;
+        std::uint8_t* mTypes;
+        std::uint32_t* mOffsets;
+        std::uint32_t* mLengths;
+        int* mLines;
+        Literal* mLiterals;
+
+        std::size_t mMessageCount;
+        std::size_t mMessageCapacity;
+        const char** mMessages;
+};
+
+#endif // TOKENSTREAM_HPP
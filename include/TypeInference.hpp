@@ -0,0 +1,56 @@
+#ifndef TYPE_INFERENCE_HPP
+#define TYPE_INFERENCE_HPP
+
+#include "Chunk.hpp"
+
+// Types of values known before running a chunk : of expressions while compiling (see Compiler), of stack slots while
+// verifying (see Verifier). A type is proven for every execution which reaches the instruction using it : an
+// instruction whose operands don't have the types it requires stops the execution with a runtime error, so the
+// result of e.g. a subtraction is always a number
+// Shared by both so the verifier proves exactly what the compiler inferred
+class TypeInference
+{
+    public:
+        enum Type
+        {
+            Type_Unknown,
+            Type_Null,
+            Type_Bool,
+            Type_String,
+            Type_Integer,
+            Type_Double,
+            Type_Number     // Integer or double
+        };
+
+        TypeInference() = delete;
+
+        static Type ofValue(const Value& value);
+
+        // Left and right are the types of the operands of a binary instruction, for unary instructions right is the
+        // type of the operand and left is ignored. Instructions without operands have types which don't depend on them
+
+        // Type of the result of a checked or unchecked instruction, Type_Unknown for the results of inputs, globals and natives
+        // Constants are typed by ofValue, locals have the type of the value last stored into their slot
+        static Type getResultType(std::uint8_t instruction, Type left, Type right);
+
+        // Runtime error message of a checked instruction which fails whatever the values of these types, nullptr if it can succeed
+        static const char* getError(std::uint8_t instruction, Type left, Type right);
+
+        // Unchecked variant of a checked instruction for operands of these types, the instruction itself when there is none
+        static std::uint8_t specialize(std::uint8_t instruction, Type left, Type right);
+
+        // Checked instruction an unchecked one was specialized from, the instruction itself when it is checked
+        static std::uint8_t generalize(std::uint8_t instruction);
+
+        // False when an unchecked instruction is given operands it doesn't accept
+        static bool isAccepted(std::uint8_t instruction, Type left, Type right);
+
+    private:
+        static bool isNumber(Type type);
+        // Not a number, so a checked arithmetic fails on it
+        static bool isNotNumber(Type type);
+        // Result of an arithmetic on numbers of these types
+        static Type getArithmeticType(Type left, Type right);
+};
+
+#endif // TYPE_INFERENCE_HPP
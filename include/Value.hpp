@@ -1,18 +1,21 @@
 #ifndef VALUE_HPP
 #define VALUE_HPP
 
-#include "Memory.hpp"
+#include "Heap.hpp"
 
 struct Obj
 {
     enum Type
     {
         String,
+        Native,
     };
 
     Type type;
+    // Next object of the owning heap
+    Obj* next;
 
-    static Obj* allocateObj(std::size_t size, Obj::Type type);
+    static Obj* allocateObj(Heap& heap, std::size_t size, Obj::Type type);
 };
 
 struct ObjString
@@ -21,9 +24,26 @@ struct ObjString
     int length;
     char* chars;
 
-    static ObjString* copyString(const char* chars, int length);
-    static ObjString* takeString(char* chars, int length);
-    static ObjString* allocateString(char* chars, int length);
+    static ObjString* copyString(Heap& heap, const char* chars, int length);
+    static ObjString* takeString(Heap& heap, char* chars, int length);
+    static ObjString* allocateString(Heap& heap, char* chars, int length);
+};
+
+class Value;
+
+// Type erased host function, the thunk converts the arguments and calls the function (see Environment)
+typedef void (*NativeFunction)();
+typedef bool (*NativeThunk)(NativeFunction function, const Value* arguments, Value* result);
+
+struct ObjNative
+{
+    Obj obj;
+    NativeThunk thunk;
+    NativeFunction function;
+    int arity;
+    ObjString* name;
+
+    static ObjNative* allocateNative(Heap& heap, NativeThunk thunk, NativeFunction function, int arity, ObjString* name);
 };
 
 class Value
@@ -33,13 +53,15 @@ class Value
         {
             Null,
             Bool,
-            Number,
+            Number,     // double
+            Integer,    // 64 bits signed integer
             Object
         };
 
         Value();
         Value(bool value);
         Value(double value);
+        Value(std::int64_t value);
         Value(Obj* object);
 
         Type getType() const;
@@ -47,17 +69,26 @@ class Value
 
         bool isNull() const;
         bool isBool() const;
+        // Double or integer
         bool isNumber() const;
+        bool isDouble() const;
+        bool isInteger() const;
         bool isObject() const;
         bool isString() const;
+        bool isNative() const;
 
         bool isFalsey() const;
+        // Integers and doubles are equal when they have exactly the same value
         bool isEquals(const Value& value) const;
 
         bool asBool() const;
+        // Value of a double or an integer, as a double (integers above 2^53 are rounded)
         double asNumber() const;
+        double asDouble() const;
+        std::int64_t asInteger() const;
         Obj* asObject() const;
         ObjString* asString() const;
+        ObjNative* asNative() const;
         char* asCString() const;
 
     private:
@@ -66,10 +97,139 @@ class Value
         {
             bool boolean;
             double number;
+            std::int64_t integer;
             Obj* object;
         } mAs;
 };
 
+// Inlined, the interpreter calls these for every instruction
+
+inline Value::Value()
+    : mType(Value::Type::Null)
+{
+    mAs.integer = 0;
+}
+
+inline Value::Value(bool value)
+    : mType(Value::Type::Bool)
+{
+    mAs.integer = 0;
+    mAs.boolean = value;
+}
+
+inline Value::Value(double value)
+    : mType(Value::Type::Number)
+{
+    mAs.number = value;
+}
+
+inline Value::Value(std::int64_t value)
+    : mType(Value::Type::Integer)
+{
+    mAs.integer = value;
+}
+
+inline Value::Value(Obj* object)
+    : mType(Value::Type::Object)
+{
+    mAs.object = object;
+}
+
+inline Value::Type Value::getType() const
+{
+    return mType;
+}
+
+inline Obj::Type Value::getObjectType() const
+{
+    return mAs.object->type;
+}
+
+inline bool Value::isNull() const
+{
+    return mType == Value::Type::Null;
+}
+
+inline bool Value::isBool() const
+{
+    return mType == Value::Type::Bool;
+}
+
+inline bool Value::isNumber() const
+{
+    return mType == Value::Type::Number || mType == Value::Type::Integer;
+}
+
+inline bool Value::isDouble() const
+{
+    return mType == Value::Type::Number;
+}
+
+inline bool Value::isInteger() const
+{
+    return mType == Value::Type::Integer;
+}
+
+inline bool Value::isObject() const
+{
+    return mType == Value::Type::Object;
+}
+
+inline bool Value::isString() const
+{
+    return isObject() && asObject()->type == Obj::Type::String;
+}
+
+inline bool Value::isNative() const
+{
+    return isObject() && asObject()->type == Obj::Type::Native;
+}
+
+inline bool Value::isFalsey() const
+{
+    return isNull() || (isBool() && !asBool());
+}
+
+inline bool Value::asBool() const
+{
+    return mAs.boolean;
+}
+
+inline double Value::asNumber() const
+{
+    return mType == Value::Type::Integer ? (double)mAs.integer : mAs.number;
+}
+
+inline double Value::asDouble() const
+{
+    return mAs.number;
+}
+
+inline std::int64_t Value::asInteger() const
+{
+    return mAs.integer;
+}
+
+inline Obj* Value::asObject() const
+{
+    return mAs.object;
+}
+
+inline ObjString* Value::asString() const
+{
+    return (ObjString*)mAs.object;
+}
+
+inline ObjNative* Value::asNative() const
+{
+    return (ObjNative*)mAs.object;
+}
+
+inline char* Value::asCString() const
+{
+    return ((ObjString*)mAs.object)->chars;
+}
+
 class ValueArray
 {
     public:
@@ -77,10 +237,16 @@ class ValueArray
         ~ValueArray();
 
         void clear();
+        // Empties the array but keeps its storage for the next values
+        void reset();
 
         void push(Value value);
         void reserve(std::size_t size);
 
+        // Makes the array a view of values it doesn't own (e.g. a mapped Snapshot), they must outlive it
+        // The values are copied the first time the array grows
+        void setExternal(Value* values, std::size_t count);
+
         std::size_t size() const;
         std::size_t capacity() const;
 
@@ -0,0 +1,21 @@
+#ifndef VERIFIER_HPP
+#define VERIFIER_HPP
+
+#include "Chunk.hpp"
+
+// Checks a chunk once before it is executed, so the interpreter can run it without any check per instruction :
+// valid opcodes and operands, constant indices in range, local slots inside the stack, no stack underflow, and a final Op_Return
+// Operands of unchecked instructions must have the types they require, as proven by TypeInference
+// On success the maximum stack depth and the numbers of inputs and globals used are recorded in the chunk, the VM reserves exactly this stack
+class Verifier
+{
+    public:
+        Verifier() = delete;
+
+        static bool verify(Chunk& chunk);
+
+    private:
+        static bool error(const Chunk& chunk, std::size_t offset, const char* message);
+};
+
+#endif // VERIFIER_HPP
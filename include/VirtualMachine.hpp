@@ -3,22 +3,36 @@
 
 #include "Chunk.hpp"
 #include "Compiler.hpp"
+#include "Jit.hpp"
+#include "LineProfiler.hpp"
+#ifdef BLISSX_PROFILE_OPCODES
+    #include "OpCodeProfile.hpp"
+#endif
+#include "OutputSink.hpp"
 
+#include <chrono>
 #include <cstdarg>
 
-#ifdef DEBUG_TRACE_EXECUTION
-    #include "Debug.hpp"
-#endif
+#define STACK_INITIAL_SIZE 64
+// Instructions between two reads of the clock when running with a time budget
+#define BUDGET_CLOCK_INTERVAL 1024
 
-#define STACK_MAX 256
+class AotScript;
 
 // TODO : A Virtual Machine : Challenge 1
 // TODO : A Virtual Machine : Challenge 2
 // TODO : A Virtual Machine : Challenge 3
 
-// TODO : Stack size defined as instantiation
-// TODO : Stack error strategy defined as instantiation
+// The stack is never checked while running : chunks are verified once (see Verifier) and the stack is grown
+// beforehand to the maximum depth they need
 
+// Threading model :
+//  - a VirtualMachine owns its stack, its compiler and the heap of the objects created while running,
+//    it must only be used by one thread at a time
+//  - verified chunks are immutable and can be executed by any number of VirtualMachine concurrently,
+//    the objects referenced by their constants belong to the chunk and are never modified
+//  - there is no other shared state : several VirtualMachine can run on several threads without synchronization
+//  - the only shared resources are the output sinks, by default stdout which is locked by the C library
 class VirtualMachine
 {
     public:
@@ -26,31 +40,154 @@ class VirtualMachine
         {
             Interpret_Ok,
             Interpret_CompileError,
-            Interpret_RuntimeError
+            Interpret_VerifyError,
+            Interpret_RuntimeError,
+            // The budget is spent, the execution is suspended until resume is called
+            Interpret_Yield
         };
 
         VirtualMachine();
         ~VirtualMachine();
 
+        // Unchecked, reserveStack must have been called with enough room
         void push(Value value);
         Value pop();
         void resetStack();
+        void reserveStack(std::size_t depth);
 
         void runtimeError(const char* format, ...);
 
-        InterpretResult interpret(const char* source);
+        // Compiles and executes the source once, then prints the result into the output sink
+        InterpretResult interpret(const char* source, const char* name = "script");
+
+        // Compile once and execute many times : the chunk can be kept and executed again, by this VM or any other
+        InterpretResult compile(const char* source, Chunk* chunk, const char* name = "script");
+        // The chunk must have been verified (compiled chunks are), result receives the value returned by the chunk
+        // inputs holds one value per input slot of the environment the chunk was compiled with (see Environment::addInput),
+        // it is only read during the call
+        InterpretResult execute(const Chunk& chunk, Value* result = nullptr, const Value* inputs = nullptr);
+        // Same for a chunk translated to C++ ahead of time, the script must have been linked
+        // There is no trace nor profiling of the translated code
+        InterpretResult execute(const AotScript& script, Value* result = nullptr, const Value* inputs = nullptr);
+
+        // Budget of each call to execute or resume, 0 for none (the default) : once it is spent the execution stops before
+        // its next instruction and returns Interpret_Yield, keeping its whole state in the VM
+        // The instructions are counted down only in the budgeted instantiations of the interpreter loop, and the clock
+        // is only read every BUDGET_CLOCK_INTERVAL instructions. Budgeted executions never use the JIT
+        void setInstructionBudget(std::size_t instructions);
+        void setTimeBudget(std::chrono::nanoseconds time);
+
+        // Continues the suspended execution from the instruction where it stopped, with a new budget
+        // The chunk, the inputs and the objects of the heap must live until the execution completes,
+        // executing another chunk abandons the suspended execution
+        InterpretResult resume(Value* result = nullptr);
+        bool isSuspended() const;
+
+        // Values of the globals of the environment (see Environment::addGlobal), kept from one execution to the next
+        // Each VM has its own values, null until set. Only numbers, bools and null can be stored : false for any other value
+        bool setGlobal(std::size_t index, Value value);
+        Value getGlobal(std::size_t index) const;
+
+        // Objects created while executing (e.g. concatenated strings) live until the heap is reset,
+        // values referencing them must not be used afterwards
+        void resetHeap();
+
+        // Native functions callable by the scripts compiled by this VM, none by default
+        // Compiled chunks keep what they call, the environment doesn't need to outlive them
+        void setEnvironment(const Environment* environment);
+
+        // Destination of the results printed by interpret, stdout by default
+        // The results go through a buffer owned by the VM (see BufferedSink) : they reach the sink once it is full,
+        // when flushOutput is called, when another sink is set and when the VM is destroyed
+        void setOutputSink(OutputSink* sink);
+        OutputSink* getOutputSink() const;
+        void flushOutput();
+
+        // When a sink is set, compiled code is disassembled and every executed instruction is traced into it
+        // Without a sink, the interpreter loop runs without any trace code
+        void setTraceSink(OutputSink* sink);
+        OutputSink* getTraceSink() const;
+
+        // When a profiler is set, the lines being executed are sampled into it
+        // Without profiler, the interpreter loop runs without any sampling code
+        void setLineProfiler(LineProfiler* profiler);
+        LineProfiler* getLineProfiler() const;
+
+        // Chunks executed more than the threshold are compiled to native code (see Jit), enabled by default
+        // Tracing or sampling a VM always interprets, builds without BLISSX_JIT ignore these settings
+        void setJitEnabled(bool enabled);
+        void setJitThreshold(std::size_t executions);
+
+#ifdef BLISSX_PROFILE_OPCODES
+        // Statistics of every instruction executed by this VM since it was created or reset
+        OpCodeProfile& getOpCodeProfile();
+#endif
 
     private:
+        // The translated code concatenates strings into the heap of the VM
+        friend class AotRuntime;
+
+        template <bool Traced, bool Sampled, bool Budgeted>
+        struct Handlers;
+
+        template <bool Traced, bool Sampled, bool Budgeted>
         InterpretResult run();
 
-        void concatenate();
+        // Runs the current chunk from mInstructionPointer with the instantiation matching the VM settings,
+        // then pops the result once the chunk returned
+        InterpretResult runChunk(Value* result);
+
+        void startBudget();
+        // Called when the countdown reaches zero : true when the budget is spent, otherwise the countdown starts again
+        bool budgetSpent();
 
-        Value peek(int distance);
+        void traceInstruction();
 
-        Chunk* mChunk;
-        std::uint8_t* mInstructionPointer;
-        Value mStack[STACK_MAX];
+#ifdef BLISSX_JIT
+        // Runs the native code then lets the interpreter finish the chunk where the native code stopped
+        InterpretResult runNative(const JitCode& code);
+#endif
+
+        ObjString* concatenate(ObjString* a, ObjString* b);
+
+        // Grows the globals to count values, the new ones are null
+        void reserveGlobals(std::size_t count);
+
+        const Chunk* mChunk;
+        const std::uint8_t* mInstructionPointer;
+        const Value* mInputs;
+        // mStack[0] is never part of the stack : it absorbs the spill of the cached top when the stack is empty
+        Value* mStack;
         Value* mStackTop;
+        std::size_t mStackCapacity;
+        Value* mGlobals;
+        std::size_t mGlobalCount;
+
+        Compiler mCompiler;
+        Heap mHeap;
+
+        OutputSink* mOutputSink;
+        BufferedSink mOutputBuffer;
+        OutputSink* mTraceSink;
+        LineProfiler* mLineProfiler;
+
+        std::size_t mInstructionBudget;
+        std::chrono::nanoseconds mTimeBudget;
+        // Instructions left before budgetSpent is called, the slice it started from, and what is left of the budget
+        std::size_t mBudgetCountdown;
+        std::size_t mBudgetSlice;
+        std::size_t mBudgetRemaining;
+        std::chrono::steady_clock::time_point mBudgetDeadline;
+        bool mSuspended;
+
+        bool mJitEnabled;
+#ifdef BLISSX_JIT
+        Jit mJit;
+#endif
+
+#ifdef BLISSX_PROFILE_OPCODES
+        OpCodeProfile mOpCodeProfile;
+#endif
 };
 
 #endif // VIRTUALMACHINE_HPP
@@ -0,0 +1,152 @@
+#ifndef X64ASSEMBLER_HPP
+#define X64ASSEMBLER_HPP
+
+#include "Memory.hpp"
+
+// Encoder of the few x86-64 instructions used by the JIT (see Jit), in a growing buffer
+// Memory operands are always [base + disp32], jumps are always rel32 to a label bound before or after
+class X64Assembler
+{
+    public:
+        enum Register
+        {
+            RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+            R8, R9, R10, R11, R12, R13, R14, R15
+        };
+
+        enum Xmm
+        {
+            XMM0, XMM1
+        };
+
+        // Low nibble of the jcc / setcc opcodes
+        enum Condition
+        {
+            Overflow = 0x0,
+            Below = 0x2,
+            AboveEqual = 0x3,
+            Equal = 0x4,
+            NotEqual = 0x5,
+            Above = 0x7,
+            Parity = 0xA,
+            NotParity = 0xB,
+            Less = 0xC,
+            GreaterEqual = 0xD,
+            LessEqual = 0xE,
+            Greater = 0xF
+        };
+
+        enum SseOperation
+        {
+            Sse_Add = 0x58,
+            Sse_Multiply = 0x59,
+            Sse_Substract = 0x5C,
+            Sse_Divide = 0x5E
+        };
+
+        enum AluOperation
+        {
+            Alu_Add = 0x01,
+            Alu_Or = 0x09,
+            Alu_And = 0x21,
+            Alu_Substract = 0x29,
+            Alu_Xor = 0x31,
+            Alu_Compare = 0x39
+        };
+
+        typedef int Label;
+
+        X64Assembler();
+        ~X64Assembler();
+
+        X64Assembler(const X64Assembler&) = delete;
+        X64Assembler& operator=(const X64Assembler&) = delete;
+
+        const std::uint8_t* code() const;
+        std::size_t size() const;
+        // Forgets the code and the labels, the buffers are kept for the next function
+        void clear();
+
+        Label newLabel();
+        void bind(Label label);
+        void jump(Label label);
+        void jump(Condition condition, Label label);
+        // Patches every jump, false if one of them targets a label never bound
+        bool resolve();
+
+        void push(Register reg);
+        void pop(Register reg);
+        void ret();
+        void call(Register reg);
+
+        // 64 bits operations
+        void mov(Register destination, Register source);
+        void movImmediate(Register destination, std::uint64_t immediate);
+        void load(Register destination, Register base, std::int32_t displacement);
+        void store(Register base, std::int32_t displacement, Register source);
+        void lea(Register destination, Register base, std::int32_t displacement);
+        void alu(AluOperation operation, Register destination, Register source);
+        void compare(Register left, Register base, std::int32_t displacement);
+        void addImmediate(Register destination, std::int8_t immediate);
+        void compareImmediate(Register reg, std::int8_t immediate);
+        void imul(Register destination, Register source);
+        void neg(Register reg);
+        void cqo();
+        void idiv(Register divisor);
+        void flipSign(Register reg);
+
+        // 32 bits and 8 bits operations, used on the types and the bools
+        void load32(Register destination, Register base, std::int32_t displacement);
+        void store32(Register base, std::int32_t displacement, Register source);
+        void store32Immediate(Register base, std::int32_t displacement, std::int32_t immediate);
+        void compare32Immediate(Register base, std::int32_t displacement, std::int32_t immediate);
+        void compare32Immediate(Register reg, std::int32_t immediate);
+        void compare32(Register left, Register right);
+        void loadByte(Register destination, Register base, std::int32_t displacement);
+        void setByte(Condition condition, Register destination);
+        void zeroExtendByte(Register reg);
+        void alu8(AluOperation operation, Register destination, Register source);
+        void xor8Immediate(Register destination, std::uint8_t immediate);
+        void test8(Register reg);
+        void movByteImmediate(Register destination, std::uint8_t immediate);
+
+        // SSE2, scalar doubles
+        void loadDouble(Xmm destination, Register base, std::int32_t displacement);
+        void storeDouble(Register base, std::int32_t displacement, Xmm source);
+        void sse(SseOperation operation, Xmm destination, Xmm source);
+        void ucomisd(Xmm left, Xmm right);
+        void convertInteger(Xmm destination, Register base, std::int32_t displacement);
+        void convertInteger(Xmm destination, Register source);
+        void truncateDouble(Register destination, Xmm source);
+        // 16 bytes copies, used to move whole values
+        void loadValue(Xmm destination, Register base, std::int32_t displacement);
+        void storeValue(Register base, std::int32_t displacement, Xmm source);
+
+    private:
+        void byte(std::uint8_t value);
+        void int32(std::int32_t value);
+        void rex(bool wide, int reg, int base);
+        void memory(int reg, Register base, std::int32_t displacement);
+        void registers(int reg, int rm);
+
+        std::uint8_t* mCode;
+        std::size_t mCount;
+        std::size_t mCapacity;
+
+        // Position of each label, -1 until bound
+        std::int64_t* mLabels;
+        std::size_t mLabelCount;
+        std::size_t mLabelCapacity;
+
+        // rel32 fields to patch once their label is bound
+        struct Fixup
+        {
+            std::size_t position;
+            Label label;
+        };
+        Fixup* mFixups;
+        std::size_t mFixupCount;
+        std::size_t mFixupCapacity;
+};
+
+#endif // X64ASSEMBLER_HPP
@@ -1,83 +1,256 @@
+#include "CppTranslator.hpp"
+#include "Debug.hpp"
+#include "LineReader.hpp"
+#include "SourceFile.hpp"
 #include "VirtualMachine.hpp"
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <string>
 
 void repl(VirtualMachine& virtualMachine)
 {
-    char line[1024];
+    char block[1024];
+    std::string line;
     for(;;)
     {
         printf("> ");
-        if (!fgets(line, sizeof(line), stdin))
+        // Lines longer than the block are read in several parts
+        line.clear();
+        while (fgets(block, sizeof(block), stdin))
+        {
+            line += block;
+            if (line.back() == '\n') break;
+        }
+        if (line.empty())
         {
             printf("\n");
             break;
         }
-        virtualMachine.interpret(line);
+        virtualMachine.interpret(line.c_str());
+        virtualMachine.flushOutput();
     }
 }
 
-char* readFile(const char* path)
+// Evaluates one expression per line of stdin and prints one line per expression : its value, or an empty line when
+// it fails (the error goes to stderr), so the results stay aligned with the expressions. Returns the exit status
+// The chunk and the output buffer are reused by every expression, stdin is read in blocks
+int stream(VirtualMachine& virtualMachine)
 {
-    FILE* file = fopen(path, "rb");
-    if (file == NULL)
+    LineReader reader(stdin);
+    Chunk chunk;
+    BufferedSink output(&OutputSink::getStandardOutput());
+    int status = 0;
+    for (const char* line; (line = reader.next()) != nullptr;)
     {
-        fprintf(stderr, "Could not open file \"%s\".\n", path);
-        exit(74);
+        Value value;
+        VirtualMachine::InterpretResult result = virtualMachine.compile(line, &chunk, "stdin");
+        if (result == VirtualMachine::Interpret_Ok)
+        {
+            result = virtualMachine.execute(chunk, &value);
+        }
+        if (result == VirtualMachine::Interpret_Ok)
+        {
+            Debug::printValue(value, output);
+        }
+        else if (status == 0)
+        {
+            status = result == VirtualMachine::Interpret_RuntimeError ? 70 : 65;
+        }
+        output.write("\n", 1);
+        virtualMachine.resetHeap();
     }
+    output.flush();
 
-    fseek(file, 0L, SEEK_END);
-    std::size_t fileSize = ftell(file);
-    rewind(file);
-
-    char* buffer = (char*)malloc(fileSize + 1);
-    if (buffer == NULL)
+    if (reader.hasError())
     {
-        fprintf(stderr, "Not enought memory to read \"%s\".\n", path);
-        exit(74);
+        fprintf(stderr, "Could not read stdin.\n");
+        return 74;
     }
+    return status;
+}
 
-    std::size_t bytesRead = fread(buffer, sizeof(char), fileSize, file);
-    if (bytesRead < fileSize)
+// Returns the exit status
+int runFile(VirtualMachine& virtualMachine, const char* path)
+{
+    SourceFile file;
+    if (!file.open(path))
     {
-        fprintf(stderr, "Could not read file \"%s\".\n", path);
-        exit(74);
+        fprintf(stderr, "Could not open file \"%s\".\n", path);
+        return 74;
     }
 
-    buffer[bytesRead] = '\0';
+    file.adviseSequential();
+    VirtualMachine::InterpretResult result = virtualMachine.interpret(file.getSource(), path);
+    virtualMachine.flushOutput();
+    file.close();
 
-    fclose(file);
-    return buffer;
+    if (result == VirtualMachine::Interpret_CompileError) return 65;
+    if (result == VirtualMachine::Interpret_VerifyError) return 65;
+    if (result == VirtualMachine::Interpret_RuntimeError) return 70;
+    return 0;
 }
 
-void runFile(VirtualMachine& virtualMachine, const char* path)
+// Translates the script to C++ instead of running it (see CppTranslator), returns the exit status
+int emitCpp(VirtualMachine& virtualMachine, const char* identifier, const char* outputPath, const char* path)
 {
-    char* source = readFile(path);
-    VirtualMachine::InterpretResult result = virtualMachine.interpret(source);
-    free(source);
+    SourceFile file;
+    if (!file.open(path))
+    {
+        fprintf(stderr, "Could not open file \"%s\".\n", path);
+        return 74;
+    }
+
+    Chunk chunk;
+    VirtualMachine::InterpretResult result = virtualMachine.compile(file.getSource(), &chunk, path);
+    file.close();
+    if (result != VirtualMachine::Interpret_Ok) return 65;
 
-    if (result == VirtualMachine::Interpret_CompileError) exit(65);
-    if (result == VirtualMachine::Interpret_RuntimeError) exit(70);
+    FILE* output = fopen(outputPath, "w");
+    if (output == nullptr)
+    {
+        fprintf(stderr, "Could not open file \"%s\".\n", outputPath);
+        return 74;
+    }
+    FileSink sink(output);
+    bool translated = CppTranslator::translate(chunk, identifier, sink);
+    fclose(output);
+    return translated ? 0 : 65;
 }
 
+#ifdef BLISSX_PROFILE_OPCODES
+    #define USAGE "Usage: blissx [--trace] [--profile-lines file] [--profile | --profile-json] [--stream | path]\n" \
+                  "       blissx --emit-cpp identifier output [--input name]... [--global name]... path\n"
+#else
+    #define USAGE "Usage: blissx [--trace] [--profile-lines file] [--stream | path]\n" \
+                  "       blissx --emit-cpp identifier output [--input name]... [--global name]... path\n"
+#endif
+
+// Sampling period of --profile-lines
+#define LINE_PROFILE_PERIOD_US 1000
+// Used instead when there is no profiling timer on the platform
+#define LINE_PROFILE_INTERVAL 1000
+
 int main(int argc, char** argv)
 {
-    if (argc == 1)
+    VirtualMachine virtualMachine;
+
+    int argument = 1;
+    if (argument + 2 < argc && strcmp(argv[argument], "--emit-cpp") == 0)
+    {
+        const char* identifier = argv[argument + 1];
+        const char* output = argv[argument + 2];
+        argument += 3;
+
+        // The inputs of the translated script, in slot order
+        Environment environment;
+        while (argument + 1 < argc && strcmp(argv[argument], "--input") == 0)
+        {
+            if (environment.addInput(argv[argument + 1]) < 0)
+            {
+                fprintf(stderr, "Too many inputs.\n");
+                return 64;
+            }
+            argument += 2;
+        }
+        // And its globals, in index order
+        while (argument + 1 < argc && strcmp(argv[argument], "--global") == 0)
+        {
+            if (environment.addGlobal(argv[argument + 1]) < 0)
+            {
+                fprintf(stderr, "Too many globals.\n");
+                return 64;
+            }
+            argument += 2;
+        }
+        if (argument + 1 != argc)
+        {
+            fprintf(stderr, USAGE);
+            return 64;
+        }
+        virtualMachine.setEnvironment(&environment);
+        return emitCpp(virtualMachine, identifier, output, argv[argument]);
+    }
+
+    if (argument < argc && strcmp(argv[argument], "--trace") == 0)
+    {
+        virtualMachine.setTraceSink(&OutputSink::getStandardOutput());
+        argument++;
+    }
+
+    // Folded stacks of the sampled lines are written into the file when exiting
+    const char* lineProfilePath = nullptr;
+    if (argument + 1 < argc && strcmp(argv[argument], "--profile-lines") == 0)
+    {
+        lineProfilePath = argv[argument + 1];
+        argument += 2;
+    }
+
+    bool lineProfileTimer = lineProfilePath != nullptr && LineProfiler::startTimer(LINE_PROFILE_PERIOD_US);
+    LineProfiler lineProfiler(lineProfileTimer ? 0 : LINE_PROFILE_INTERVAL);
+    if (lineProfilePath != nullptr)
+    {
+        virtualMachine.setLineProfiler(&lineProfiler);
+    }
+
+#ifdef BLISSX_PROFILE_OPCODES
+    // The opcode statistics are reported on stderr when exiting
+    const char* profile = nullptr;
+    if (argument < argc && (strcmp(argv[argument], "--profile") == 0 || strcmp(argv[argument], "--profile-json") == 0))
+    {
+        profile = argv[argument];
+        argument++;
+    }
+#endif
+
+    int status = 0;
+    if (argument == argc)
     {
-        VirtualMachine virtualMachine;
         repl(virtualMachine);
     }
-    else if (argc == 2)
+    else if (argument + 1 == argc && strcmp(argv[argument], "--stream") == 0)
     {
-        VirtualMachine virtualMachine;
-        runFile(virtualMachine, argv[1]);
+        status = stream(virtualMachine);
+    }
+    else if (argument + 1 == argc)
+    {
+        status = runFile(virtualMachine, argv[argument]);
     }
     else
     {
-        fprintf(stderr, "Usage: lox [path]\n");
+        fprintf(stderr, USAGE);
         exit(64);
     }
-	return 0;
+
+    if (lineProfilePath != nullptr)
+    {
+        LineProfiler::stopTimer();
+        FILE* file = fopen(lineProfilePath, "w");
+        if (file == nullptr)
+        {
+            fprintf(stderr, "Could not open file \"%s\".\n", lineProfilePath);
+            return 74;
+        }
+        FileSink sink(file);
+        lineProfiler.writeFolded(sink);
+        fclose(file);
+    }
+
+#ifdef BLISSX_PROFILE_OPCODES
+    if (profile != nullptr)
+    {
+        FileSink sink(stderr);
+        if (strcmp(profile, "--profile-json") == 0)
+        {
+            virtualMachine.getOpCodeProfile().reportJson(sink);
+        }
+        else
+        {
+            virtualMachine.getOpCodeProfile().report(sink);
+        }
+    }
+#endif
+
+	return status;
 }
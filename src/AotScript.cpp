@@ -0,0 +1,205 @@
+#include "AotScript.hpp"
+
+#include <cstdarg>
+
+AotScript::AotScript()
+    : mDefinition(nullptr)
+    , mNatives(nullptr)
+{
+}
+
+AotScript::~AotScript()
+{
+    if (mDefinition != nullptr)
+    {
+        MEMORY_FREE_ARRAY(NativeBinding, mNatives, mDefinition->nativeCount);
+    }
+}
+
+bool AotScript::link(const AotDefinition& definition, const Environment* environment)
+{
+    if (mDefinition != nullptr)
+    {
+        MEMORY_FREE_ARRAY(NativeBinding, mNatives, mDefinition->nativeCount);
+        mDefinition = nullptr;
+        mNatives = nullptr;
+    }
+
+    NativeBinding* natives = MEMORY_ALLOCATE(NativeBinding, definition.nativeCount);
+    for (std::size_t i = 0; i < definition.nativeCount; i++)
+    {
+        const char* name = definition.nativeNames[i];
+        const NativeBinding* binding = environment != nullptr ? environment->find(name, (int)strlen(name)) : nullptr;
+        if (binding == nullptr)
+        {
+            fprintf(stderr, "Script '%s' calls the undefined native function '%s'.\n", definition.name, name);
+            MEMORY_FREE_ARRAY(NativeBinding, natives, definition.nativeCount);
+            return false;
+        }
+        if (binding->arity != definition.nativeArities[i])
+        {
+            fprintf(stderr, "Script '%s' calls '%s' with %d arguments, it takes %d.\n", definition.name, name,
+                    definition.nativeArities[i], binding->arity);
+            MEMORY_FREE_ARRAY(NativeBinding, natives, definition.nativeCount);
+            return false;
+        }
+        // The name is the one of the definition, it outlives the environment
+        natives[i] = *binding;
+        natives[i].name = name;
+    }
+
+    mDefinition = &definition;
+    mNatives = natives;
+    return true;
+}
+
+bool AotScript::isLinked() const
+{
+    return mDefinition != nullptr;
+}
+
+const AotDefinition& AotScript::getDefinition() const
+{
+    return *mDefinition;
+}
+
+const NativeBinding* AotScript::getNatives() const
+{
+    return mNatives;
+}
+
+bool AotRuntime::binary(VirtualMachine& virtualMachine, std::uint8_t instruction, const Value& a, const Value& b, Value* result, int line)
+{
+    switch (instruction)
+    {
+        case Chunk::Op_Equal:
+            *result = Value(a.isEquals(b));
+            return true;
+        case Chunk::Op_BangEqual:
+            *result = Value(!a.isEquals(b));
+            return true;
+        case Chunk::Op_Add:
+            if (a.isString() && b.isString())
+            {
+                *result = Value((Obj*)virtualMachine.concatenate(a.asString(), b.asString()));
+                return true;
+            }
+            if (!a.isNumber() || !b.isNumber())
+            {
+                runtimeError(line, "Operands must be two numbers or two strings.");
+                return false;
+            }
+            break;
+        default:
+            if (!a.isNumber() || !b.isNumber())
+            {
+                runtimeError(line, "Operands must be numbers.");
+                return false;
+            }
+            break;
+    }
+
+    if (a.isInteger() && b.isInteger())
+    {
+        std::int64_t x = a.asInteger();
+        std::int64_t y = b.asInteger();
+        switch (instruction)
+        {
+            case Chunk::Op_Greater: *result = Value(x > y); return true;
+            case Chunk::Op_GreaterEqual: *result = Value(x >= y); return true;
+            case Chunk::Op_Less: *result = Value(x < y); return true;
+            case Chunk::Op_LessEqual: *result = Value(x <= y); return true;
+            case Chunk::Op_Add: *result = add(x, y); return true;
+            case Chunk::Op_Substract: *result = substract(x, y); return true;
+            case Chunk::Op_Multiply: *result = multiply(x, y); return true;
+            case Chunk::Op_Divide: *result = divide(x, y); return true;
+        }
+    }
+    else if (instruction >= Chunk::Op_Greater && instruction <= Chunk::Op_LessEqual && (a.isInteger() || b.isInteger()))
+    {
+        // The integer isn't rounded to a double
+        double ordering = order(a, b);
+        switch (instruction)
+        {
+            case Chunk::Op_Greater: *result = Value(ordering > 0.0); break;
+            case Chunk::Op_GreaterEqual: *result = Value(ordering >= 0.0); break;
+            case Chunk::Op_Less: *result = Value(ordering < 0.0); break;
+            case Chunk::Op_LessEqual: *result = Value(ordering <= 0.0); break;
+        }
+        return true;
+    }
+
+    double x = a.asNumber();
+    double y = b.asNumber();
+    switch (instruction)
+    {
+        case Chunk::Op_Greater: *result = Value(x > y); break;
+        case Chunk::Op_GreaterEqual: *result = Value(x >= y); break;
+        case Chunk::Op_Less: *result = Value(x < y); break;
+        case Chunk::Op_LessEqual: *result = Value(x <= y); break;
+        case Chunk::Op_Add: *result = Value(x + y); break;
+        case Chunk::Op_Substract: *result = Value(x - y); break;
+        case Chunk::Op_Multiply: *result = Value(x * y); break;
+        case Chunk::Op_Divide: *result = Value(x / y); break;
+    }
+    return true;
+}
+
+bool AotRuntime::negate(const Value& value, Value* result, int line)
+{
+    if (value.isInteger())
+    {
+        *result = negate(value.asInteger());
+        return true;
+    }
+    if (!value.isNumber())
+    {
+        runtimeError(line, "Operand must be a number.");
+        return false;
+    }
+    *result = Value(-value.asNumber());
+    return true;
+}
+
+bool AotRuntime::callNative(const NativeBinding& native, const Value* arguments, Value* result, int line)
+{
+    if (!native.thunk(native.function, arguments, result))
+    {
+        runtimeError(line, "Invalid argument types for native function '%s'.", native.name);
+        return false;
+    }
+    return true;
+}
+
+VirtualMachine::InterpretResult AotRuntime::operandError(std::uint8_t instruction, int line)
+{
+    switch (instruction)
+    {
+        case Chunk::Op_Add: runtimeError(line, "Operands must be two numbers or two strings."); break;
+        case Chunk::Op_Negate: runtimeError(line, "Operand must be a number."); break;
+        default: runtimeError(line, "Operands must be numbers."); break;
+    }
+    return VirtualMachine::Interpret_RuntimeError;
+}
+
+bool AotRuntime::setGlobal(VirtualMachine& virtualMachine, std::size_t index, const Value& value, int line)
+{
+    if (value.isObject())
+    {
+        runtimeError(line, "Only numbers, bools and null can be stored in globals.");
+        return false;
+    }
+    virtualMachine.mGlobals[index] = value;
+    return true;
+}
+
+void AotRuntime::runtimeError(int line, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputs("\n", stderr);
+
+    fprintf(stderr, "[line %d] in script\n", line);
+}
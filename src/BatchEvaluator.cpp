@@ -0,0 +1,741 @@
+#include "BatchEvaluator.hpp"
+
+#include "Arithmetic.hpp"
+#include "TypeInference.hpp"
+
+#include <cstdio>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #define BATCH_SSE2
+    #include <emmintrin.h>
+#endif
+
+namespace
+{
+    // Kernels of the numeric instructions : scalar is the semantics for one lane, vector does two lanes at once
+    // Comparison kernels return a mask, all bits set in the lanes where the comparison is true
+    struct AddKernel
+    {
+        static double scalar(double a, double b) { return a + b; }
+#ifdef BATCH_SSE2
+        static __m128d vector(__m128d a, __m128d b) { return _mm_add_pd(a, b); }
+#endif
+    };
+
+    struct SubstractKernel
+    {
+        static double scalar(double a, double b) { return a - b; }
+#ifdef BATCH_SSE2
+        static __m128d vector(__m128d a, __m128d b) { return _mm_sub_pd(a, b); }
+#endif
+    };
+
+    struct MultiplyKernel
+    {
+        static double scalar(double a, double b) { return a * b; }
+#ifdef BATCH_SSE2
+        static __m128d vector(__m128d a, __m128d b) { return _mm_mul_pd(a, b); }
+#endif
+    };
+
+    struct DivideKernel
+    {
+        static double scalar(double a, double b) { return a / b; }
+#ifdef BATCH_SSE2
+        static __m128d vector(__m128d a, __m128d b) { return _mm_div_pd(a, b); }
+#endif
+    };
+
+    struct EqualKernel
+    {
+        static bool scalar(double a, double b) { return a == b; }
+#ifdef BATCH_SSE2
+        static __m128d vector(__m128d a, __m128d b) { return _mm_cmpeq_pd(a, b); }
+#endif
+    };
+
+    struct BangEqualKernel
+    {
+        static bool scalar(double a, double b) { return a != b; }
+#ifdef BATCH_SSE2
+        static __m128d vector(__m128d a, __m128d b) { return _mm_cmpneq_pd(a, b); }
+#endif
+    };
+
+    struct GreaterKernel
+    {
+        static bool scalar(double a, double b) { return a > b; }
+#ifdef BATCH_SSE2
+        static __m128d vector(__m128d a, __m128d b) { return _mm_cmpgt_pd(a, b); }
+#endif
+    };
+
+    struct GreaterEqualKernel
+    {
+        static bool scalar(double a, double b) { return a >= b; }
+#ifdef BATCH_SSE2
+        static __m128d vector(__m128d a, __m128d b) { return _mm_cmpge_pd(a, b); }
+#endif
+    };
+
+    struct LessKernel
+    {
+        static bool scalar(double a, double b) { return a < b; }
+#ifdef BATCH_SSE2
+        static __m128d vector(__m128d a, __m128d b) { return _mm_cmplt_pd(a, b); }
+#endif
+    };
+
+    struct LessEqualKernel
+    {
+        static bool scalar(double a, double b) { return a <= b; }
+#ifdef BATCH_SSE2
+        static __m128d vector(__m128d a, __m128d b) { return _mm_cmple_pd(a, b); }
+#endif
+    };
+
+    // A uniform operand is a single double, broadcast to every lane
+    template <typename Kernel, bool UniformA, bool UniformB>
+    void arithmeticLoop(const double* a, const double* b, double* out, std::size_t lanes)
+    {
+        std::size_t i = 0;
+#ifdef BATCH_SSE2
+        const __m128d broadcastA = _mm_set1_pd(a[0]);
+        const __m128d broadcastB = _mm_set1_pd(b[0]);
+        for (; i + 2 <= lanes; i += 2)
+        {
+            __m128d x = UniformA ? broadcastA : _mm_loadu_pd(a + i);
+            __m128d y = UniformB ? broadcastB : _mm_loadu_pd(b + i);
+            _mm_storeu_pd(out + i, Kernel::vector(x, y));
+        }
+#endif
+        for (; i < lanes; i++)
+        {
+            out[i] = Kernel::scalar(a[UniformA ? 0 : i], b[UniformB ? 0 : i]);
+        }
+    }
+
+    template <typename Kernel, bool UniformA, bool UniformB>
+    void comparisonLoop(const double* a, const double* b, std::uint8_t* out, std::size_t lanes)
+    {
+        std::size_t i = 0;
+#ifdef BATCH_SSE2
+        const __m128d broadcastA = _mm_set1_pd(a[0]);
+        const __m128d broadcastB = _mm_set1_pd(b[0]);
+        for (; i + 2 <= lanes; i += 2)
+        {
+            __m128d x = UniformA ? broadcastA : _mm_loadu_pd(a + i);
+            __m128d y = UniformB ? broadcastB : _mm_loadu_pd(b + i);
+            int mask = _mm_movemask_pd(Kernel::vector(x, y));
+            out[i] = (std::uint8_t)(mask & 1);
+            out[i + 1] = (std::uint8_t)(mask >> 1);
+        }
+#endif
+        for (; i < lanes; i++)
+        {
+            out[i] = Kernel::scalar(a[UniformA ? 0 : i], b[UniformB ? 0 : i]);
+        }
+    }
+
+    // At most one operand is uniform, uniform operands are folded before
+    template <typename Kernel>
+    void arithmetic(const double* a, bool uniformA, const double* b, bool uniformB, double* out, std::size_t lanes)
+    {
+        if (uniformA) arithmeticLoop<Kernel, true, false>(a, b, out, lanes);
+        else if (uniformB) arithmeticLoop<Kernel, false, true>(a, b, out, lanes);
+        else arithmeticLoop<Kernel, false, false>(a, b, out, lanes);
+    }
+
+    template <typename Kernel>
+    void comparison(const double* a, bool uniformA, const double* b, bool uniformB, std::uint8_t* out, std::size_t lanes)
+    {
+        if (uniformA) comparisonLoop<Kernel, true, false>(a, b, out, lanes);
+        else if (uniformB) comparisonLoop<Kernel, false, true>(a, b, out, lanes);
+        else comparisonLoop<Kernel, false, false>(a, b, out, lanes);
+    }
+
+    // Integers up to 2^53 compare exactly with doubles once converted
+    bool isExactDouble(std::int64_t integer)
+    {
+        return integer >= -(INT64_C(1) << 53) && integer <= (INT64_C(1) << 53);
+    }
+
+    void negateLoop(const double* a, double* out, std::size_t lanes)
+    {
+        std::size_t i = 0;
+#ifdef BATCH_SSE2
+        const __m128d sign = _mm_set1_pd(-0.0);
+        for (; i + 2 <= lanes; i += 2)
+        {
+            _mm_storeu_pd(out + i, _mm_xor_pd(_mm_loadu_pd(a + i), sign));
+        }
+#endif
+        for (; i < lanes; i++)
+        {
+            out[i] = -a[i];
+        }
+    }
+}
+
+BatchEvaluator::BatchEvaluator()
+    : mChunk(nullptr)
+    , mColumns(nullptr)
+    , mColumnCapacity(0)
+    , mError(nullptr)
+    , mErrorLane(0)
+{
+    for (std::size_t i = 0; i < ENVIRONMENT_MAX_INPUTS; i++)
+    {
+        mInputs[i] = nullptr;
+    }
+}
+
+BatchEvaluator::~BatchEvaluator()
+{
+    for (std::size_t i = 0; i < mColumnCapacity; i++)
+    {
+        MEMORY_FREE_ARRAY(double, mColumns[i].doubles, BATCH_LANES);
+        MEMORY_FREE_ARRAY(std::uint8_t, mColumns[i].bools, BATCH_LANES);
+        MEMORY_FREE_ARRAY(Value, mColumns[i].values, BATCH_LANES);
+    }
+    MEMORY_FREE_ARRAY(Column, mColumns, mColumnCapacity);
+}
+
+void BatchEvaluator::setInput(std::size_t slot, const double* column)
+{
+    if (slot >= ENVIRONMENT_MAX_INPUTS)
+    {
+        fprintf(stderr, "Input slot %zu out of range.\n", slot);
+        return;
+    }
+    mInputs[slot] = column;
+}
+
+bool BatchEvaluator::setGlobal(std::size_t index, Value value)
+{
+    if (index >= ENVIRONMENT_MAX_GLOBALS)
+    {
+        fprintf(stderr, "Global index %zu out of range.\n", index);
+        return false;
+    }
+    if (value.isObject())
+    {
+        fprintf(stderr, "Only numbers, bools and null can be stored in globals.\n");
+        return false;
+    }
+    mGlobals[index] = value;
+    return true;
+}
+
+VirtualMachine::InterpretResult BatchEvaluator::execute(const Chunk& chunk, std::size_t count, Value* results)
+{
+    if (!chunk.isVerified())
+    {
+        fprintf(stderr, "Chunk must be verified before being executed.\n");
+        return VirtualMachine::Interpret_VerifyError;
+    }
+    for (std::size_t slot = 0; slot < chunk.getInputCount(); slot++)
+    {
+        if (mInputs[slot] == nullptr)
+        {
+            fprintf(stderr, "Chunk reads input %zu but no column was given.\n", slot);
+            return VirtualMachine::Interpret_VerifyError;
+        }
+    }
+    for (std::size_t offset = 0; offset < chunk.size(); offset += Chunk::getInstructionLength(chunk.getCode(offset)))
+    {
+        if (chunk.getCode(offset) == Chunk::Op_SetGlobal)
+        {
+            fprintf(stderr, "Chunk assigns globals, its executions can't run side by side.\n");
+            return VirtualMachine::Interpret_VerifyError;
+        }
+    }
+
+    reserveColumns(chunk.getMaxStackDepth());
+    mChunk = &chunk;
+
+    for (std::size_t first = 0; first < count; first += BATCH_LANES)
+    {
+        std::size_t lanes = count - first < BATCH_LANES ? count - first : BATCH_LANES;
+        VirtualMachine::InterpretResult status = runBlock(first, lanes, results + first);
+        if (status != VirtualMachine::Interpret_Ok)
+        {
+            return status;
+        }
+    }
+    return VirtualMachine::Interpret_Ok;
+}
+
+void BatchEvaluator::resetHeap()
+{
+    mHeap.clear();
+}
+
+void BatchEvaluator::reserveColumns(std::size_t depth)
+{
+    if (mColumnCapacity >= depth)
+    {
+        return;
+    }
+
+    mColumns = MEMORY_GROW_ARRAY(mColumns, Column, mColumnCapacity, depth);
+    for (std::size_t i = mColumnCapacity; i < depth; i++)
+    {
+        mColumns[i].kind = Kind_Uniform;
+        mColumns[i].uniform = Value();
+        mColumns[i].numbers = nullptr;
+        mColumns[i].doubles = MEMORY_ALLOCATE(double, BATCH_LANES);
+        mColumns[i].bools = MEMORY_ALLOCATE(std::uint8_t, BATCH_LANES);
+        mColumns[i].values = MEMORY_ALLOCATE(Value, BATCH_LANES);
+    }
+    mColumnCapacity = depth;
+}
+
+Value BatchEvaluator::laneValue(const Column& column, std::size_t lane)
+{
+    switch (column.kind)
+    {
+        case Kind_Uniform: return column.uniform;
+        case Kind_Doubles: return Value(column.numbers[lane]);
+        case Kind_Bools: return Value(column.bools[lane] != 0);
+        case Kind_Values: return column.values[lane];
+    }
+    return Value(); // Unreachable
+}
+
+void BatchEvaluator::copyColumn(Column& destination, const Column& source, std::size_t lanes)
+{
+    destination.kind = source.kind;
+    switch (source.kind)
+    {
+        case Kind_Uniform:
+            destination.uniform = source.uniform;
+            break;
+        case Kind_Doubles:
+            // Input columns are never written
+            if (source.numbers != source.doubles)
+            {
+                destination.numbers = source.numbers;
+                break;
+            }
+            memcpy(destination.doubles, source.doubles, lanes * sizeof(double));
+            destination.numbers = destination.doubles;
+            break;
+        case Kind_Bools:
+            memcpy(destination.bools, source.bools, lanes);
+            break;
+        case Kind_Values:
+            for (std::size_t i = 0; i < lanes; i++)
+            {
+                destination.values[i] = source.values[i];
+            }
+            break;
+    }
+}
+
+void BatchEvaluator::normalize(Column& column, std::size_t lanes)
+{
+    if (column.kind != Kind_Values)
+    {
+        return;
+    }
+
+    bool doubles = true;
+    bool bools = true;
+    for (std::size_t i = 0; i < lanes; i++)
+    {
+        doubles = doubles && column.values[i].isDouble();
+        bools = bools && column.values[i].isBool();
+    }
+
+    if (doubles)
+    {
+        for (std::size_t i = 0; i < lanes; i++)
+        {
+            column.doubles[i] = column.values[i].asDouble();
+        }
+        column.numbers = column.doubles;
+        column.kind = Kind_Doubles;
+    }
+    else if (bools)
+    {
+        for (std::size_t i = 0; i < lanes; i++)
+        {
+            column.bools[i] = column.values[i].asBool();
+        }
+        column.kind = Kind_Bools;
+    }
+}
+
+// Same structure as VirtualMachine::run, except each instruction is done for every lane of the block
+// The chunk is verified : operands and stack depth are not checked
+VirtualMachine::InterpretResult BatchEvaluator::runBlock(std::size_t first, std::size_t lanes, Value* results)
+{
+    const std::uint8_t* code = mChunk->beginOfCode();
+    const std::uint8_t* ip = code;
+    // Next free column, like the top of the VM stack
+    Column* top = mColumns;
+
+    for (;;)
+    {
+        std::size_t offset = ip - code;
+        // Unchecked variants behave as their checked instruction on valid operands
+        std::uint8_t instruction = TypeInference::generalize(*ip++);
+        switch (instruction)
+        {
+            case Chunk::Op_Constant:
+                top->kind = Kind_Uniform;
+                top->uniform = mChunk->getConstant(*ip++);
+                top++;
+                break;
+            case Chunk::Op_Null:
+            case Chunk::Op_True:
+            case Chunk::Op_False:
+                top->kind = Kind_Uniform;
+                top->uniform = instruction == Chunk::Op_Null ? Value() : Value(instruction == Chunk::Op_True);
+                top++;
+                break;
+            case Chunk::Op_GetInput:
+                top->kind = Kind_Doubles;
+                top->numbers = mInputs[*ip++] + first;
+                top++;
+                break;
+            case Chunk::Op_GetLocal:
+                copyColumn(*top, mColumns[*ip++], lanes);
+                top++;
+                break;
+            case Chunk::Op_SetLocal:
+                copyColumn(mColumns[*ip++], top[-1], lanes);
+                break;
+            case Chunk::Op_GetGlobal:
+                top->kind = Kind_Uniform;
+                top->uniform = mGlobals[*ip++];
+                top++;
+                break;
+            case Chunk::Op_Pop:
+                top--;
+                break;
+            case Chunk::Op_Equal:
+            case Chunk::Op_BangEqual:
+            case Chunk::Op_Greater:
+            case Chunk::Op_GreaterEqual:
+            case Chunk::Op_Less:
+            case Chunk::Op_LessEqual:
+            case Chunk::Op_Add:
+            case Chunk::Op_Substract:
+            case Chunk::Op_Multiply:
+            case Chunk::Op_Divide:
+                top--;
+                if (!binary(instruction, top[-1], top[0], lanes))
+                {
+                    runtimeError(offset, first + mErrorLane);
+                    return VirtualMachine::Interpret_RuntimeError;
+                }
+                break;
+            case Chunk::Op_Not:
+            case Chunk::Op_Negate:
+                if (!unary(instruction, top[-1], lanes))
+                {
+                    runtimeError(offset, first + mErrorLane);
+                    return VirtualMachine::Interpret_RuntimeError;
+                }
+                break;
+            case Chunk::Op_CallNative:
+            {
+                const ObjNative* native = mChunk->getConstant(ip[0]).asNative();
+                std::uint8_t argumentCount = ip[1];
+                ip += 2;
+                top -= argumentCount;
+                if (!callNative(native, top, argumentCount, lanes))
+                {
+                    runtimeError(offset, first + mErrorLane);
+                    return VirtualMachine::Interpret_RuntimeError;
+                }
+                top++;
+                break;
+            }
+            case Chunk::Op_Return:
+                top--;
+                for (std::size_t i = 0; i < lanes; i++)
+                {
+                    results[i] = laneValue(*top, i);
+                }
+                return VirtualMachine::Interpret_Ok;
+            default:
+                return VirtualMachine::Interpret_RuntimeError; // Unreachable, the chunk is verified
+        }
+    }
+}
+
+bool BatchEvaluator::binary(std::uint8_t instruction, Column& a, const Column& b, std::size_t lanes)
+{
+    // Folded once for the whole block
+    if (a.kind == Kind_Uniform && b.kind == Kind_Uniform)
+    {
+        mErrorLane = 0;
+        return binaryScalar(instruction, a.uniform, b.uniform, &a.uniform);
+    }
+
+    // Numeric kernels : doubles in every lane, or a number broadcast to every lane
+    // Mixed integer and double operations are done on doubles, except comparisons which must stay exact
+    bool equality = instruction == Chunk::Op_Equal || instruction == Chunk::Op_BangEqual;
+    bool exact = equality || (instruction >= Chunk::Op_Greater && instruction <= Chunk::Op_LessEqual);
+    double uniformA = 0.0;
+    double uniformB = 0.0;
+    bool numericA = a.kind == Kind_Doubles;
+    bool numericB = b.kind == Kind_Doubles;
+    if (a.kind == Kind_Uniform && a.uniform.isNumber())
+    {
+        uniformA = a.uniform.asNumber();
+        numericA = !exact || a.uniform.isDouble() || isExactDouble(a.uniform.asInteger());
+    }
+    if (b.kind == Kind_Uniform && b.uniform.isNumber())
+    {
+        uniformB = b.uniform.asNumber();
+        numericB = !exact || b.uniform.isDouble() || isExactDouble(b.uniform.asInteger());
+    }
+
+    if (numericA && numericB)
+    {
+        bool isUniformA = a.kind == Kind_Uniform;
+        bool isUniformB = b.kind == Kind_Uniform;
+        const double* x = isUniformA ? &uniformA : a.numbers;
+        const double* y = isUniformB ? &uniformB : b.numbers;
+        switch (instruction)
+        {
+            case Chunk::Op_Add: arithmetic<AddKernel>(x, isUniformA, y, isUniformB, a.doubles, lanes); break;
+            case Chunk::Op_Substract: arithmetic<SubstractKernel>(x, isUniformA, y, isUniformB, a.doubles, lanes); break;
+            case Chunk::Op_Multiply: arithmetic<MultiplyKernel>(x, isUniformA, y, isUniformB, a.doubles, lanes); break;
+            case Chunk::Op_Divide: arithmetic<DivideKernel>(x, isUniformA, y, isUniformB, a.doubles, lanes); break;
+            case Chunk::Op_Equal: comparison<EqualKernel>(x, isUniformA, y, isUniformB, a.bools, lanes); break;
+            case Chunk::Op_BangEqual: comparison<BangEqualKernel>(x, isUniformA, y, isUniformB, a.bools, lanes); break;
+            case Chunk::Op_Greater: comparison<GreaterKernel>(x, isUniformA, y, isUniformB, a.bools, lanes); break;
+            case Chunk::Op_GreaterEqual: comparison<GreaterEqualKernel>(x, isUniformA, y, isUniformB, a.bools, lanes); break;
+            case Chunk::Op_Less: comparison<LessKernel>(x, isUniformA, y, isUniformB, a.bools, lanes); break;
+            case Chunk::Op_LessEqual: comparison<LessEqualKernel>(x, isUniformA, y, isUniformB, a.bools, lanes); break;
+        }
+
+        if (exact)
+        {
+            a.kind = Kind_Bools;
+        }
+        else
+        {
+            a.kind = Kind_Doubles;
+            a.numbers = a.doubles;
+        }
+        return true;
+    }
+
+    if (equality && a.kind == Kind_Bools && b.kind == Kind_Bools)
+    {
+        std::uint8_t different = instruction == Chunk::Op_BangEqual;
+        for (std::size_t i = 0; i < lanes; i++)
+        {
+            a.bools[i] = (a.bools[i] != b.bools[i]) == different;
+        }
+        return true;
+    }
+
+    // Divergent types : lane by lane
+    for (std::size_t i = 0; i < lanes; i++)
+    {
+        Value result;
+        if (!binaryScalar(instruction, laneValue(a, i), laneValue(b, i), &result))
+        {
+            mErrorLane = i;
+            return false;
+        }
+        a.values[i] = result;
+    }
+    a.kind = Kind_Values;
+    normalize(a, lanes);
+    return true;
+}
+
+bool BatchEvaluator::unary(std::uint8_t instruction, Column& column, std::size_t lanes)
+{
+    switch (column.kind)
+    {
+        case Kind_Uniform:
+            mErrorLane = 0;
+            return unaryScalar(instruction, column.uniform, &column.uniform);
+        case Kind_Doubles:
+            if (instruction == Chunk::Op_Not)
+            {
+                // Numbers are never falsey
+                column.kind = Kind_Uniform;
+                column.uniform = Value(false);
+            }
+            else
+            {
+                negateLoop(column.numbers, column.doubles, lanes);
+                column.numbers = column.doubles;
+            }
+            return true;
+        case Kind_Bools:
+            if (instruction == Chunk::Op_Not)
+            {
+                for (std::size_t i = 0; i < lanes; i++)
+                {
+                    column.bools[i] = !column.bools[i];
+                }
+                return true;
+            }
+            break;
+        case Kind_Values:
+            break;
+    }
+
+    for (std::size_t i = 0; i < lanes; i++)
+    {
+        Value result;
+        if (!unaryScalar(instruction, laneValue(column, i), &result))
+        {
+            mErrorLane = i;
+            return false;
+        }
+        column.values[i] = result;
+    }
+    column.kind = Kind_Values;
+    normalize(column, lanes);
+    return true;
+}
+
+// Natives may have side effects : they are called once per lane, even with uniform arguments
+bool BatchEvaluator::callNative(const ObjNative* native, Column* arguments, std::size_t argumentCount, std::size_t lanes)
+{
+    // The result replaces the first argument
+    Column& result = arguments[0];
+    Value values[UINT8_MAX];
+    for (std::size_t i = 0; i < lanes; i++)
+    {
+        for (std::size_t argument = 0; argument < argumentCount; argument++)
+        {
+            values[argument] = laneValue(arguments[argument], i);
+        }
+        if (!native->thunk(native->function, values, &result.values[i]))
+        {
+            snprintf(mErrorBuffer, sizeof(mErrorBuffer), "Invalid argument types for native function '%s'.", native->name->chars);
+            mError = mErrorBuffer;
+            mErrorLane = i;
+            return false;
+        }
+    }
+    result.kind = Kind_Values;
+    normalize(result, lanes);
+    return true;
+}
+
+bool BatchEvaluator::binaryScalar(std::uint8_t instruction, const Value& a, const Value& b, Value* result)
+{
+    switch (instruction)
+    {
+        case Chunk::Op_Equal:
+            *result = Value(a.isEquals(b));
+            return true;
+        case Chunk::Op_BangEqual:
+            *result = Value(!a.isEquals(b));
+            return true;
+        case Chunk::Op_Add:
+            if (a.isString() && b.isString())
+            {
+                ObjString* left = a.asString();
+                ObjString* right = b.asString();
+                int length = left->length + right->length;
+                char* chars = MEMORY_ALLOCATE(char, length + 1);
+                memcpy(chars, left->chars, left->length);
+                memcpy(chars + left->length, right->chars, right->length);
+                chars[length] = '\0';
+                *result = Value((Obj*)ObjString::takeString(mHeap, chars, length));
+                return true;
+            }
+            if (!a.isNumber() || !b.isNumber())
+            {
+                mError = "Operands must be two numbers or two strings.";
+                return false;
+            }
+            break;
+        default:
+            if (!a.isNumber() || !b.isNumber())
+            {
+                mError = "Operands must be numbers.";
+                return false;
+            }
+            break;
+    }
+
+    if (a.isInteger() && b.isInteger())
+    {
+        std::int64_t x = a.asInteger();
+        std::int64_t y = b.asInteger();
+        std::int64_t integer;
+        switch (instruction)
+        {
+            case Chunk::Op_Greater: *result = Value(x > y); return true;
+            case Chunk::Op_GreaterEqual: *result = Value(x >= y); return true;
+            case Chunk::Op_Less: *result = Value(x < y); return true;
+            case Chunk::Op_LessEqual: *result = Value(x <= y); return true;
+            case Chunk::Op_Add: if (!Arithmetic::checkedAdd(x, y, &integer)) { *result = Value(integer); return true; } break;
+            case Chunk::Op_Substract: if (!Arithmetic::checkedSubstract(x, y, &integer)) { *result = Value(integer); return true; } break;
+            case Chunk::Op_Multiply: if (!Arithmetic::checkedMultiply(x, y, &integer)) { *result = Value(integer); return true; } break;
+            case Chunk::Op_Divide: if (!Arithmetic::checkedDivide(x, y, &integer)) { *result = Value(integer); return true; } break;
+        }
+    }
+    else if (instruction >= Chunk::Op_Greater && instruction <= Chunk::Op_LessEqual && (a.isInteger() || b.isInteger()))
+    {
+        // The integer isn't converted, 'order op 0.0' is 'a op b'
+        double order = a.isInteger() ? Arithmetic::compareMixed(a.asInteger(), b.asDouble()) : -Arithmetic::compareMixed(b.asInteger(), a.asDouble());
+        switch (instruction)
+        {
+            case Chunk::Op_Greater: *result = Value(order > 0.0); break;
+            case Chunk::Op_GreaterEqual: *result = Value(order >= 0.0); break;
+            case Chunk::Op_Less: *result = Value(order < 0.0); break;
+            case Chunk::Op_LessEqual: *result = Value(order <= 0.0); break;
+        }
+        return true;
+    }
+
+    double x = a.asNumber();
+    double y = b.asNumber();
+    switch (instruction)
+    {
+        case Chunk::Op_Greater: *result = Value(x > y); break;
+        case Chunk::Op_GreaterEqual: *result = Value(x >= y); break;
+        case Chunk::Op_Less: *result = Value(x < y); break;
+        case Chunk::Op_LessEqual: *result = Value(x <= y); break;
+        case Chunk::Op_Add: *result = Value(x + y); break;
+        case Chunk::Op_Substract: *result = Value(x - y); break;
+        case Chunk::Op_Multiply: *result = Value(x * y); break;
+        case Chunk::Op_Divide: *result = Value(x / y); break;
+    }
+    return true;
+}
+
+bool BatchEvaluator::unaryScalar(std::uint8_t instruction, const Value& value, Value* result)
+{
+    if (instruction == Chunk::Op_Not)
+    {
+        *result = Value(value.isFalsey());
+        return true;
+    }
+
+    if (value.isInteger() && value.asInteger() != INT64_MIN)
+    {
+        *result = Value(-value.asInteger());
+        return true;
+    }
+    if (!value.isNumber())
+    {
+        mError = "Operand must be a number.";
+        return false;
+    }
+    *result = Value(-value.asNumber());
+    return true;
+}
+
+void BatchEvaluator::runtimeError(std::size_t offset, std::size_t lane)
+{
+    fprintf(stderr, "%s\n", mError);
+    fprintf(stderr, "[line %d] in script, lane %zu\n", mChunk->getLine(offset), lane);
+}
@@ -1,26 +1,100 @@
 #include "Chunk.hpp"
 
+#include <atomic>
+
+// Chunks are verified by compilers running on any thread
+static std::atomic<std::uint64_t> nextVerifiedId(1);
+
 Chunk::Chunk()
     : mCount(0)
     , mCapacity(0)
     , mCode(nullptr)
     , mLines(nullptr)
+    , mName(nullptr)
+    , mMaxStackDepth(0)
+    , mInputCount(0)
+    , mGlobalCount(0)
+    , mVerifiedId(0)
+    , mVerified(false)
 {
 }
 
 Chunk::~Chunk()
 {
     clear();
+    setName(nullptr);
+}
+
+std::size_t Chunk::getInstructionLength(std::uint8_t instruction)
+{
+    static const std::uint8_t lengths[] = {
+        #define BLISSX_OPCODE_LENGTH(name, format, pops, pushes) 1 + BLISSX_OPERAND_SIZE_##format,
+        BLISSX_OPCODES(BLISSX_OPCODE_LENGTH)
+        #undef BLISSX_OPCODE_LENGTH
+    };
+    return lengths[instruction];
 }
 
 void Chunk::clear()
 {
-    MEMORY_FREE_ARRAY(uint8_t, mCode, mCapacity);
-    MEMORY_FREE_ARRAY(int, mLines, mCapacity);
+    // External code has no capacity, it isn't owned
+    if (mCapacity > 0)
+    {
+        MEMORY_FREE_ARRAY(uint8_t, mCode, mCapacity);
+        MEMORY_FREE_ARRAY(int, mLines, mCapacity);
+    }
     mCount = 0;
     mCapacity = 0;
     mCode = nullptr;
     mLines = nullptr;
+    mConstants.clear();
+    mHeap.clear();
+    mMaxStackDepth = 0;
+    mInputCount = 0;
+    mGlobalCount = 0;
+    mVerified = false;
+}
+
+void Chunk::reset()
+{
+    // External code isn't owned, there is nothing to keep
+    if (mCapacity == 0)
+    {
+        clear();
+        return;
+    }
+    mCount = 0;
+    mConstants.reset();
+    mHeap.clear();
+    mMaxStackDepth = 0;
+    mInputCount = 0;
+    mGlobalCount = 0;
+    mVerified = false;
+}
+
+void Chunk::setName(const char* name)
+{
+    // Compiling again under the same name allocates nothing
+    if (mName != nullptr && name != nullptr && strcmp(mName, name) == 0)
+    {
+        return;
+    }
+    if (mName != nullptr)
+    {
+        MEMORY_FREE_ARRAY(char, mName, strlen(mName) + 1);
+        mName = nullptr;
+    }
+    if (name != nullptr)
+    {
+        std::size_t length = strlen(name);
+        mName = MEMORY_ALLOCATE(char, length + 1);
+        memcpy(mName, name, length + 1);
+    }
+}
+
+const char* Chunk::getName() const
+{
+    return mName != nullptr ? mName : "script";
 }
 
 void Chunk::push(std::uint8_t byte, int line)
@@ -33,14 +107,27 @@ void Chunk::push(std::uint8_t byte, int line)
     mCode[mCount] = byte;
     mLines[mCount] = line;
     mCount++;
+    mVerified = false;
 }
 
 void Chunk::reserve(std::size_t size)
 {
     if (mCapacity < size)
     {
-        mCode = MEMORY_GROW_ARRAY(mCode, std::uint8_t, mCapacity, size);
-        mLines = MEMORY_GROW_ARRAY(mLines, int, mCapacity, size);
+        if (mCapacity == 0 && mCode != nullptr)
+        {
+            std::uint8_t* code = MEMORY_ALLOCATE(std::uint8_t, size);
+            int* lines = MEMORY_ALLOCATE(int, size);
+            memcpy(code, mCode, mCount);
+            memcpy(lines, mLines, mCount * sizeof(int));
+            mCode = code;
+            mLines = lines;
+        }
+        else
+        {
+            mCode = MEMORY_GROW_ARRAY(mCode, std::uint8_t, mCapacity, size);
+            mLines = MEMORY_GROW_ARRAY(mLines, int, mCapacity, size);
+        }
         mCapacity = size;
     }
 }
@@ -48,9 +135,19 @@ void Chunk::reserve(std::size_t size)
 std::size_t Chunk::addConstant(Value value)
 {
     mConstants.push(value);
+    mVerified = false;
     return mConstants.size() - 1;
 }
 
+void Chunk::setExternal(const std::uint8_t* code, const int* lines, std::size_t count, Value* constants, std::size_t constantCount)
+{
+    clear();
+    mCode = (std::uint8_t*)code;
+    mLines = (int*)lines;
+    mCount = count;
+    mConstants.setExternal(constants, constantCount);
+}
+
 std::size_t Chunk::size() const
 {
     return mCount;
@@ -61,6 +158,11 @@ std::size_t Chunk::capacity() const
     return mCapacity;
 }
 
+std::size_t Chunk::constantCount() const
+{
+    return mConstants.size();
+}
+
 const int& Chunk::getLine(std::size_t index) const
 {
     // TODO : Throw exception ?
@@ -78,8 +180,46 @@ const Value& Chunk::getConstant(std::size_t constantIndex) const
     return mConstants[constantIndex];
 }
 
-std::uint8_t* Chunk::beginOfCode()
+const std::uint8_t* Chunk::beginOfCode() const
 {
     return mCode;
 }
 
+Heap& Chunk::getHeap()
+{
+    return mHeap;
+}
+
+void Chunk::setVerified(std::size_t maxStackDepth, std::size_t inputCount, std::size_t globalCount)
+{
+    mMaxStackDepth = maxStackDepth;
+    mInputCount = inputCount;
+    mGlobalCount = globalCount;
+    mVerifiedId = nextVerifiedId.fetch_add(1, std::memory_order_relaxed);
+    mVerified = true;
+}
+
+bool Chunk::isVerified() const
+{
+    return mVerified;
+}
+
+std::size_t Chunk::getMaxStackDepth() const
+{
+    return mMaxStackDepth;
+}
+
+std::size_t Chunk::getInputCount() const
+{
+    return mInputCount;
+}
+
+std::size_t Chunk::getGlobalCount() const
+{
+    return mGlobalCount;
+}
+
+std::uint64_t Chunk::getVerifiedId() const
+{
+    return mVerifiedId;
+}
@@ -1,28 +1,58 @@
 #include "Compiler.hpp"
 
+#include "Verifier.hpp"
+
 #include <cstdio>
 
-#ifdef DEBUG_PRINT_CODE
-    #include "Debug.hpp"
-#endif
+Compiler::Compiler()
+    : mChunk(nullptr)
+    , mEnvironment(nullptr)
+    , mTokenIndex(0)
+    , mType(TypeInference::Type_Unknown)
+    , mLocalCount(0)
+{
+    mParser.hadError = false;
+    mParser.panicMode = false;
+}
 
 bool Compiler::compile(const char* source, Chunk* chunk)
 {
-    Scanner::getInstance().newSource(source);
+    mTokens.tokenize(source);
+    mTokenIndex = 0;
 
     mChunk = chunk;
     mParser.hadError = false;
     mParser.panicMode = false;
+    mLocalCount = 0;
 
     advance();
 
-    expression();
-
-    consume(Token::Type::Token_EndOfFile, "Expect end of expression.");
+    // The value of an expression statement is only popped once another statement follows it
+    bool hasResult = false;
+    while (!match(Token::Type::Token_EndOfFile))
+    {
+        if (hasResult)
+        {
+            emitByte(Chunk::OpCode::Op_Pop);
+        }
+        hasResult = declaration();
+    }
+    if (!hasResult)
+    {
+        emitByte(Chunk::OpCode::Op_Null);
+    }
 
     endCompiler();
 
-    return !mParser.hadError;
+    mTokens.clear();
+    mChunk = nullptr;
+
+    return !mParser.hadError && Verifier::verify(*chunk);
+}
+
+void Compiler::setEnvironment(const Environment* environment)
+{
+    mEnvironment = environment;
 }
 
 void Compiler::advance()
@@ -30,12 +60,17 @@ void Compiler::advance()
     mParser.previous = mParser.current;
     for (;;)
     {
-        mParser.current = Scanner::getInstance().scanToken();
+        mParser.current = mTokens.getToken(mTokenIndex++);
         if (mParser.current.type != Token::Type::Token_Error) break;
         errorAtCurrent(mParser.current.start);
     }
 }
 
+Token Compiler::peekToken(std::size_t distance)
+{
+    return mTokens.getToken(mTokenIndex + distance - 1);
+}
+
 void Compiler::errorAtCurrent(const char* message)
 {
     errorAt(&mParser.current, message);
@@ -76,6 +111,33 @@ void Compiler::consume(Token::Type type, const char* message)
     errorAtCurrent(message);
 }
 
+bool Compiler::match(Token::Type type)
+{
+    if (mParser.current.type != type) return false;
+    advance();
+    return true;
+}
+
+void Compiler::endStatement(const char* message)
+{
+    if (!match(Token::Type::Token_Semicolon) && mParser.current.type != Token::Type::Token_EndOfFile)
+    {
+        errorAtCurrent(message);
+    }
+}
+
+void Compiler::synchronize()
+{
+    mParser.panicMode = false;
+
+    while (mParser.current.type != Token::Type::Token_EndOfFile)
+    {
+        if (mParser.previous.type == Token::Type::Token_Semicolon) return;
+        if (mParser.current.type == Token::Type::Token_Var) return;
+        advance();
+    }
+}
+
 void Compiler::emitByte(std::uint8_t byte)
 {
     mChunk->push(byte, mParser.previous.line);
@@ -95,21 +157,27 @@ void Compiler::emitReturn()
 void Compiler::emitConstant(Value value)
 {
     emitBytes(Chunk::OpCode::Op_Constant, makeConstant(value));
+    mType = TypeInference::ofValue(value);
 }
 
-void Compiler::endCompiler()
+void Compiler::emitTyped(Chunk::OpCode instruction, Token* op, TypeInference::Type left, TypeInference::Type right)
 {
-    emitReturn();
-
-    #ifdef DEBUG_PRINT_CODE
-    if (!mParser.hadError)
+    const char* error = TypeInference::getError(instruction, left, right);
+    if (error != nullptr)
     {
-        Debug::disassembleChunk(*mChunk, "code");
+        errorAt(op, error);
     }
-    #endif // DEBUG_PRINT_CODE
+
+    emitByte(TypeInference::specialize(instruction, left, right));
+    mType = TypeInference::getResultType(instruction, left, right);
 }
 
-void Compiler::literal()
+void Compiler::endCompiler()
+{
+    emitReturn();
+}
+
+void Compiler::literal(bool)
 {
     switch (mParser.previous.type)
     {
@@ -119,74 +187,223 @@ void Compiler::literal()
         default:
             return; // Unreachable
     }
+    mType = mParser.previous.type == Token::Type::Token_Null ? TypeInference::Type_Null : TypeInference::Type_Bool;
 }
 
-void Compiler::binary()
+void Compiler::binary(bool)
 {
-    // Remember the operator
-    Token::Type operatorType = mParser.previous.type;
+    // Remember the operator and the type of the left operand
+    Token op = mParser.previous;
+    TypeInference::Type left = mType;
 
     // Compile the right operand
-    const ParseRule* rule = getRule(operatorType);
+    const ParseRule* rule = getRule(op.type);
     parsePrecedence((Precedence)(rule->precedence + 1));
+    TypeInference::Type right = mType;
 
     // Emit the operator instruction
-    switch (operatorType)
+    switch (op.type)
     {
-        case Token::Type::Token_EqualEqual: emitByte(Chunk::OpCode::Op_Equal); break;
-        case Token::Type::Token_BangEqual: emitByte(Chunk::OpCode::Op_BangEqual); break;
-        case Token::Type::Token_Greater: emitByte(Chunk::OpCode::Op_Greater); break;
-        case Token::Type::Token_GreaterEqual: emitByte(Chunk::OpCode::Op_GreaterEqual); break;
-        case Token::Type::Token_Less: emitByte(Chunk::OpCode::Op_Less); break;
-        case Token::Type::Token_LessEqual: emitByte(Chunk::OpCode::Op_LessEqual); break;
-        case Token::Type::Token_Plus: emitByte(Chunk::OpCode::Op_Add); break;
-        case Token::Type::Token_Minus: emitByte(Chunk::OpCode::Op_Substract); break;
-        case Token::Type::Token_Star: emitByte(Chunk::OpCode::Op_Multiply); break;
-        case Token::Type::Token_Slash: emitByte(Chunk::OpCode::Op_Divide); break;
+        case Token::Type::Token_EqualEqual: emitTyped(Chunk::OpCode::Op_Equal, &op, left, right); break;
+        case Token::Type::Token_BangEqual: emitTyped(Chunk::OpCode::Op_BangEqual, &op, left, right); break;
+        case Token::Type::Token_Greater: emitTyped(Chunk::OpCode::Op_Greater, &op, left, right); break;
+        case Token::Type::Token_GreaterEqual: emitTyped(Chunk::OpCode::Op_GreaterEqual, &op, left, right); break;
+        case Token::Type::Token_Less: emitTyped(Chunk::OpCode::Op_Less, &op, left, right); break;
+        case Token::Type::Token_LessEqual: emitTyped(Chunk::OpCode::Op_LessEqual, &op, left, right); break;
+        case Token::Type::Token_Plus: emitTyped(Chunk::OpCode::Op_Add, &op, left, right); break;
+        case Token::Type::Token_Minus: emitTyped(Chunk::OpCode::Op_Substract, &op, left, right); break;
+        case Token::Type::Token_Star: emitTyped(Chunk::OpCode::Op_Multiply, &op, left, right); break;
+        case Token::Type::Token_Slash: emitTyped(Chunk::OpCode::Op_Divide, &op, left, right); break;
         default:
             return; // Unreachable
     }
 }
 
-void Compiler::grouping()
+void Compiler::grouping(bool)
 {
     expression();
     consume(Token::Type::Token_RightParen, "Expect ')' after expression.");
 }
 
-void Compiler::number()
+void Compiler::number(bool)
+{
+    emitConstant(Value(mParser.previous.number));
+}
+
+void Compiler::integer(bool)
 {
-    double value = strtod(mParser.previous.start, nullptr);
-    emitConstant(Value(value));
+    emitConstant(Value(mParser.previous.integer));
 }
 
-void Compiler::string()
+void Compiler::string(bool)
 {
-    emitConstant(Value((Obj*)ObjString::copyString(mParser.previous.start + 1, mParser.previous.length - 2)));
+    // Decoded straight into the storage of the string
+    int length = mParser.previous.decodedLength;
+    char* chars = MEMORY_ALLOCATE(char, length + 1);
+    Scanner::decodeString(mParser.previous, chars);
+    chars[length] = '\0';
+    emitConstant(Value((Obj*)ObjString::takeString(mChunk->getHeap(), chars, length)));
 }
 
-void Compiler::unary()
+void Compiler::unary(bool)
 {
-    Token::Type operatorType = mParser.previous.type;
+    Token op = mParser.previous;
 
     // Compile the operand
     parsePrecedence(Compiler::Precedence::Prec_Unary);
 
     // Emit the operator instruction
-    switch (operatorType)
+    switch (op.type)
     {
-        case Token::Type::Token_Bang: emitByte(Chunk::OpCode::Op_Not); break;
-        case Token::Type::Token_Minus: emitByte(Chunk::OpCode::Op_Negate); break;
+        case Token::Type::Token_Bang: emitTyped(Chunk::OpCode::Op_Not, &op, TypeInference::Type_Unknown, mType); break;
+        case Token::Type::Token_Minus: emitTyped(Chunk::OpCode::Op_Negate, &op, TypeInference::Type_Unknown, mType); break;
         default:
             return; // Unreachable
     }
 }
 
+void Compiler::identifier(bool canAssign)
+{
+    Token name = mParser.previous;
+
+    int local = resolveLocal(name);
+    if (local >= 0)
+    {
+        if (canAssign && match(Token::Type::Token_Equal))
+        {
+            Token op = mParser.previous;
+            expression();
+            emitTyped(Chunk::OpCode::Op_SetLocal, &op, TypeInference::Type_Unknown, mType);
+            emitByte((std::uint8_t)local);
+            mLocals[local].type = mType;
+        }
+        else
+        {
+            emitBytes(Chunk::OpCode::Op_GetLocal, (std::uint8_t)local);
+            mType = mLocals[local].type;
+        }
+        return;
+    }
+
+    int input = mEnvironment != nullptr ? mEnvironment->findInput(name.start, name.length) : -1;
+    if (input >= 0)
+    {
+        if (canAssign && match(Token::Type::Token_Equal))
+        {
+            errorAt(&name, "Can't assign to an input.");
+        }
+        emitBytes(Chunk::OpCode::Op_GetInput, (std::uint8_t)input);
+        mType = TypeInference::Type_Unknown;
+        return;
+    }
+
+    int global = mEnvironment != nullptr ? mEnvironment->findGlobal(name.start, name.length) : -1;
+    if (global >= 0)
+    {
+        if (canAssign && match(Token::Type::Token_Equal))
+        {
+            Token op = mParser.previous;
+            expression();
+            emitTyped(Chunk::OpCode::Op_SetGlobal, &op, TypeInference::Type_Unknown, mType);
+            emitByte((std::uint8_t)global);
+        }
+        else
+        {
+            emitBytes(Chunk::OpCode::Op_GetGlobal, (std::uint8_t)global);
+            mType = TypeInference::Type_Unknown;
+        }
+        return;
+    }
+
+    native();
+}
+
+void Compiler::native()
+{
+    Token name = mParser.previous;
+    const NativeBinding* binding = mEnvironment != nullptr ? mEnvironment->find(name.start, name.length) : nullptr;
+    if (binding == nullptr)
+    {
+        errorAt(&name, mParser.current.type == Token::Type::Token_LeftParen ? "Undefined native function." : "Undefined variable.");
+        return;
+    }
+
+    consume(Token::Type::Token_LeftParen, "Expect '(' after native function name.");
+    int argumentCount = 0;
+    if (mParser.current.type != Token::Type::Token_RightParen)
+    {
+        do
+        {
+            expression();
+            if (argumentCount == UINT8_MAX)
+            {
+                errorAtCurrent("Can't have more than 255 arguments.");
+            }
+            argumentCount++;
+        } while (match(Token::Type::Token_Comma));
+    }
+    consume(Token::Type::Token_RightParen, "Expect ')' after arguments.");
+
+    if (argumentCount != binding->arity)
+    {
+        char message[64];
+        snprintf(message, sizeof(message), "Expected %d arguments but got %d.", binding->arity, argumentCount);
+        errorAt(&name, message);
+        return;
+    }
+
+    emitBytes(Chunk::OpCode::Op_CallNative, makeNative(*binding));
+    emitByte((std::uint8_t)argumentCount);
+    mType = TypeInference::Type_Unknown;
+}
+
 void Compiler::expression()
 {
     parsePrecedence(Compiler::Precedence::Prec_Assignment);
 }
 
+bool Compiler::declaration()
+{
+    bool expressionStatement = false;
+    if (match(Token::Type::Token_Var))
+    {
+        varDeclaration();
+    }
+    else
+    {
+        expression();
+        endStatement("Expect ';' after expression.");
+        expressionStatement = true;
+    }
+
+    if (mParser.panicMode) synchronize();
+    return expressionStatement;
+}
+
+void Compiler::varDeclaration()
+{
+    consume(Token::Type::Token_Identifier, "Expect variable name.");
+    Token name = mParser.previous;
+    if (resolveLocal(name) >= 0)
+    {
+        errorAt(&name, "Already a variable with this name.");
+    }
+
+    if (match(Token::Type::Token_Equal))
+    {
+        expression();
+    }
+    else
+    {
+        emitByte(Chunk::OpCode::Op_Null);
+        mType = TypeInference::Type_Null;
+    }
+    endStatement("Expect ';' after variable declaration.");
+
+    // Declared once initialized : the initializer can't read the local itself
+    addLocal(name);
+}
+
 void Compiler::parsePrecedence(Precedence precedence)
 {
     advance();
@@ -198,7 +415,9 @@ void Compiler::parsePrecedence(Precedence precedence)
         return;
     }
 
-    prefixRule();
+    // Only an operand parsed at the lowest precedence can be assigned : a + b = c is not an assignment of b
+    bool canAssign = precedence <= Compiler::Precedence::Prec_Assignment;
+    (this->*prefixRule)(canAssign);
 
     while (precedence <= getRule(mParser.current.type)->precedence)
     {
@@ -206,9 +425,40 @@ void Compiler::parsePrecedence(Precedence precedence)
         ParseFn infixRule = getRule(mParser.previous.type)->infix;
         if (infixRule != nullptr)
         {
-            infixRule();
+            (this->*infixRule)(canAssign);
         }
     }
+
+    if (canAssign && match(Token::Type::Token_Equal))
+    {
+        errorAt(&mParser.previous, "Invalid assignment target.");
+    }
+}
+
+void Compiler::addLocal(Token name)
+{
+    if (mLocalCount == COMPILER_MAX_LOCALS)
+    {
+        errorAt(&name, "Too many local variables.");
+        return;
+    }
+
+    mLocals[mLocalCount].name = name;
+    mLocals[mLocalCount].type = mType;
+    mLocalCount++;
+}
+
+int Compiler::resolveLocal(const Token& name) const
+{
+    for (int i = mLocalCount - 1; i >= 0; i--)
+    {
+        const Token& local = mLocals[i].name;
+        if (local.length == name.length && memcmp(local.start, name.start, name.length) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
 }
 
 const Compiler::ParseRule* Compiler::getRule(Token::Type type)
@@ -227,47 +477,61 @@ std::uint8_t Compiler::makeConstant(Value value)
     return (uint8_t)constant;
 }
 
-Chunk* Compiler::mChunk = nullptr;
+std::uint8_t Compiler::makeNative(const NativeBinding& binding)
+{
+    // One constant per native function, whatever the number of calls
+    for (std::size_t i = 0; i < mChunk->constantCount(); i++)
+    {
+        const Value& constant = mChunk->getConstant(i);
+        if (constant.isNative() && constant.asNative()->thunk == binding.thunk && constant.asNative()->function == binding.function)
+        {
+            return (std::uint8_t)i;
+        }
+    }
 
-Compiler::Parser Compiler::mParser;
+    Heap& heap = mChunk->getHeap();
+    ObjString* name = ObjString::copyString(heap, binding.name, binding.length);
+    return makeConstant(Value((Obj*)ObjNative::allocateNative(heap, binding.thunk, binding.function, binding.arity, name)));
+}
 
 const Compiler::ParseRule Compiler::mRules[] = {
-    { Compiler::grouping,   nullptr,            Prec_Call },        // Token_LeftParen
+    { &Compiler::grouping,  nullptr,            Prec_Call },        // Token_LeftParen
     { nullptr,              nullptr,            Prec_None },        // Token_RightParen
     { nullptr,              nullptr,            Prec_None },        // Token_LeftBrace
     { nullptr,              nullptr,            Prec_None },        // Token_RightBrace
     { nullptr,              nullptr,            Prec_None },        // Token_Comma
     { nullptr,              nullptr,            Prec_Call },        // Token_Dot
-    { Compiler::unary,      Compiler::binary,   Prec_Term },        // Token_Minus
-    { nullptr,              Compiler::binary,   Prec_Term },        // Token_Plus
+    { &Compiler::unary,     &Compiler::binary,  Prec_Term },        // Token_Minus
+    { nullptr,              &Compiler::binary,  Prec_Term },        // Token_Plus
     { nullptr,              nullptr,            Prec_None },        // Token_Semicolon
-    { nullptr,              Compiler::binary,   Prec_Factor },      // Token_Slash
-    { nullptr,              Compiler::binary,   Prec_Factor },      // Token_Star
-    { Compiler::unary,      nullptr,            Prec_None },        // Token_Bang
-    { nullptr,              Compiler::binary,   Prec_Equality },    // Token_BangEqual
+    { nullptr,              &Compiler::binary,  Prec_Factor },      // Token_Slash
+    { nullptr,              &Compiler::binary,  Prec_Factor },      // Token_Star
+    { &Compiler::unary,     nullptr,            Prec_None },        // Token_Bang
+    { nullptr,              &Compiler::binary,  Prec_Equality },    // Token_BangEqual
     { nullptr,              nullptr,            Prec_None },        // Token_Equal
-    { nullptr,              Compiler::binary,   Prec_Equality },    // Token_EqualEqual
-    { nullptr,              Compiler::binary,   Prec_Comparison },  // Token_Greater
-    { nullptr,              Compiler::binary,   Prec_Comparison },  // Token_GreaterEqual
-    { nullptr,              Compiler::binary,   Prec_Comparison },  // Token_Less
-    { nullptr,              Compiler::binary,   Prec_Comparison },  // Token_LessEqual
-    { nullptr,              nullptr,            Prec_None },        // Token_Identifier
-    { Compiler::string,     nullptr,            Prec_None },        // Token_String
-    { Compiler::number,     nullptr,            Prec_None },        // Token_Number
+    { nullptr,              &Compiler::binary,  Prec_Equality },    // Token_EqualEqual
+    { nullptr,              &Compiler::binary,  Prec_Comparison },  // Token_Greater
+    { nullptr,              &Compiler::binary,  Prec_Comparison },  // Token_GreaterEqual
+    { nullptr,              &Compiler::binary,  Prec_Comparison },  // Token_Less
+    { nullptr,              &Compiler::binary,  Prec_Comparison },  // Token_LessEqual
+    { &Compiler::identifier, nullptr,           Prec_None },        // Token_Identifier
+    { &Compiler::string,    nullptr,            Prec_None },        // Token_String
+    { &Compiler::number,    nullptr,            Prec_None },        // Token_Number
+    { &Compiler::integer,   nullptr,            Prec_None },        // Token_Integer
     { nullptr,              nullptr,            Prec_And },         // Token_And
     { nullptr,              nullptr,            Prec_None },        // Token_Class
     { nullptr,              nullptr,            Prec_None },        // Token_Else
-    { Compiler::literal,    nullptr,            Prec_None },        // Token_False
+    { &Compiler::literal,   nullptr,            Prec_None },        // Token_False
     { nullptr,              nullptr,            Prec_None },        // Token_Func
     { nullptr,              nullptr,            Prec_None },        // Token_For
     { nullptr,              nullptr,            Prec_None },        // Token_If
-    { Compiler::literal,    nullptr,            Prec_None },        // Token_Null
+    { &Compiler::literal,   nullptr,            Prec_None },        // Token_Null
     { nullptr,              nullptr,            Prec_Or },          // Token_Or
     { nullptr,              nullptr,            Prec_None },        // Token_Print
     { nullptr,              nullptr,            Prec_None },        // Token_Return
     { nullptr,              nullptr,            Prec_None },        // Token_Super
     { nullptr,              nullptr,            Prec_None },        // Token_This
-    { Compiler::literal,    nullptr,            Prec_None },        // Token_True
+    { &Compiler::literal,   nullptr,            Prec_None },        // Token_True
     { nullptr,              nullptr,            Prec_None },        // Token_Var
     { nullptr,              nullptr,            Prec_None },        // Token_While
     { nullptr,              nullptr,            Prec_None },        // Token_Error
@@ -0,0 +1,732 @@
+#include "CppTranslator.hpp"
+
+#include "TypeInference.hpp"
+
+#include <cctype>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    // Type of a stack slot while translating, and the C++ type of its local
+    enum StaticType
+    {
+        Type_Null,      // no local
+        Type_Bool,      // bool
+        Type_Double,    // double
+        Type_Integer,   // std::int64_t
+        Type_Number,    // Value, a double or an integer
+        Type_String,    // Value
+        Type_Unknown    // Value
+    };
+
+    struct Slot
+    {
+        StaticType type;
+        int local;
+    };
+
+    // Expressions of a slot, written in a small buffer owned by the caller
+    struct Expression
+    {
+        char text[48];
+    };
+
+    bool isNumeric(StaticType type)
+    {
+        return type == Type_Double || type == Type_Integer || type == Type_Number;
+    }
+
+    // Exactly one C++ type
+    bool isScalar(StaticType type)
+    {
+        return type == Type_Double || type == Type_Integer;
+    }
+
+    Expression valueOf(const Slot& slot)
+    {
+        Expression expression;
+        switch (slot.type)
+        {
+            case Type_Null: snprintf(expression.text, sizeof(expression.text), "Value()"); break;
+            case Type_Bool:
+            case Type_Double:
+            case Type_Integer:
+                snprintf(expression.text, sizeof(expression.text), "Value(t%d)", slot.local);
+                break;
+            default: snprintf(expression.text, sizeof(expression.text), "t%d", slot.local); break;
+        }
+        return expression;
+    }
+
+    Expression numberOf(const Slot& slot)
+    {
+        Expression expression;
+        switch (slot.type)
+        {
+            case Type_Double: snprintf(expression.text, sizeof(expression.text), "t%d", slot.local); break;
+            case Type_Integer: snprintf(expression.text, sizeof(expression.text), "(double)t%d", slot.local); break;
+            default: snprintf(expression.text, sizeof(expression.text), "t%d.asNumber()", slot.local); break;
+        }
+        return expression;
+    }
+
+    Expression integerOf(const Slot& slot)
+    {
+        Expression expression;
+        if (slot.type == Type_Integer)
+        {
+            snprintf(expression.text, sizeof(expression.text), "t%d", slot.local);
+        }
+        else
+        {
+            snprintf(expression.text, sizeof(expression.text), "t%d.asInteger()", slot.local);
+        }
+        return expression;
+    }
+
+    // Runtime check that both numbers are integers, the static part is left out
+    Expression bothIntegers(const Slot& a, const Slot& b)
+    {
+        Expression expression;
+        if (a.type == Type_Integer)
+        {
+            snprintf(expression.text, sizeof(expression.text), "t%d.isInteger()", b.local);
+        }
+        else if (b.type == Type_Integer)
+        {
+            snprintf(expression.text, sizeof(expression.text), "t%d.isInteger()", a.local);
+        }
+        else
+        {
+            snprintf(expression.text, sizeof(expression.text), "t%d.isInteger() && t%d.isInteger()", a.local, b.local);
+        }
+        return expression;
+    }
+
+    void printDouble(double value, OutputSink& sink)
+    {
+        if (std::isnan(value))
+        {
+            sink.write("NAN");
+        }
+        else if (std::isinf(value))
+        {
+            sink.write(value > 0 ? "HUGE_VAL" : "-HUGE_VAL");
+        }
+        else
+        {
+            // Round trips, and always a floating literal
+            char buffer[32];
+            snprintf(buffer, sizeof(buffer), "%.17g", value);
+            sink.write(buffer);
+            if (strpbrk(buffer, ".e") == nullptr)
+            {
+                sink.write(".0");
+            }
+        }
+    }
+
+    void printInteger(std::int64_t value, OutputSink& sink)
+    {
+        if (value == INT64_MIN)
+        {
+            sink.write("INT64_MIN");
+        }
+        else
+        {
+            sink.print("INT64_C(%lld)", (long long)value);
+        }
+    }
+
+    void printString(const char* chars, std::size_t length, OutputSink& sink)
+    {
+        sink.write("\"");
+        for (std::size_t i = 0; i < length; i++)
+        {
+            unsigned char c = (unsigned char)chars[i];
+            if (c == '"' || c == '\\')
+            {
+                sink.print("\\%c", c);
+            }
+            else if (c < 0x20 || c >= 0x7F)
+            {
+                // Octal escapes stop after three digits, unlike hexadecimal ones
+                sink.print("\\%03o", c);
+            }
+            else
+            {
+                sink.write((const char*)&c, 1);
+            }
+        }
+        sink.write("\"");
+    }
+
+    bool isIdentifier(const char* identifier)
+    {
+        if (identifier == nullptr || !(isalpha((unsigned char)identifier[0]) || identifier[0] == '_'))
+        {
+            return false;
+        }
+        for (const char* c = identifier; *c != '\0'; c++)
+        {
+            if (!isalnum((unsigned char)*c) && *c != '_')
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const char* const opCodeNames[] = {
+        #define BLISSX_OPCODE_NAME(name, format, pops, pushes) "Chunk::Op_" #name,
+        BLISSX_OPCODES(BLISSX_OPCODE_NAME)
+        #undef BLISSX_OPCODE_NAME
+    };
+
+    const char* const operators[] = { "==", "!=", ">", ">=", "<", "<=", "+", "-", "*", "/" };
+    const char* const integerHelpers[] = { "add", "substract", "multiply", "divide" };
+
+    // Writes the body of the generated function, the stack depth of every instruction is known since there are no jumps
+    class Translator
+    {
+        public:
+            Translator(const Chunk& chunk, OutputSink& sink, const int* natives)
+                : mChunk(chunk)
+                , mSink(sink)
+                , mNatives(natives)
+                , mSlots(MEMORY_ALLOCATE(Slot, chunk.getMaxStackDepth() + 1))
+                , mDepth(0)
+                , mLocals(0)
+                , mLine(0)
+            {
+            }
+
+            ~Translator()
+            {
+                MEMORY_FREE_ARRAY(Slot, mSlots, mChunk.getMaxStackDepth() + 1);
+            }
+
+            void translate();
+
+        private:
+            // Pushes a slot with a new local, null has none
+            Slot& push(StaticType type);
+            void declare(const Slot& slot);
+            void runtimeCheck(const char* call);
+            // The result doesn't depend on the value of the slot
+            void discard(const Slot& slot);
+            // Checks an unknown operand once, it is then a number
+            void requireNumber(std::uint8_t instruction, Slot& slot);
+
+            void constant(std::size_t index);
+            void getLocal(std::uint8_t slot);
+            void setGlobal(std::uint8_t index);
+            void equality(bool negated);
+            void comparison(std::uint8_t instruction);
+            void arithmetic(std::uint8_t instruction);
+            void logicalNot();
+            void negate();
+            void callNative(const ObjNative* native, std::uint8_t argumentCount);
+
+            const Chunk& mChunk;
+            OutputSink& mSink;
+            // Index of the native of each constant in the generated arrays, -1 for other constants
+            const int* mNatives;
+            Slot* mSlots;
+            std::size_t mDepth;
+            int mLocals;
+            int mLine;
+    };
+
+    Slot& Translator::push(StaticType type)
+    {
+        Slot& slot = mSlots[mDepth++];
+        slot.type = type;
+        slot.local = type == Type_Null ? -1 : mLocals++;
+        return slot;
+    }
+
+    void Translator::declare(const Slot& slot)
+    {
+        static const char* const types[] = { "", "bool", "double", "std::int64_t", "Value", "Value", "Value" };
+        mSink.print("        %s t%d", types[slot.type], slot.local);
+    }
+
+    void Translator::runtimeCheck(const char* call)
+    {
+        mSink.print("        if (!%s) return VirtualMachine::Interpret_RuntimeError;\n", call);
+    }
+
+    void Translator::discard(const Slot& slot)
+    {
+        if (slot.local >= 0)
+        {
+            mSink.print("        (void)t%d;\n", slot.local);
+        }
+    }
+
+    void Translator::requireNumber(std::uint8_t instruction, Slot& slot)
+    {
+        if (slot.type == Type_Unknown)
+        {
+            mSink.print("        if (!t%d.isNumber()) return AotRuntime::operandError(%s, %d);\n", slot.local, opCodeNames[instruction], mLine);
+            slot.type = Type_Number;
+        }
+    }
+
+    void Translator::translate()
+    {
+        for (std::size_t offset = 0; offset < mChunk.size(); offset += Chunk::getInstructionLength(mChunk.getCode(offset)))
+        {
+            if (mChunk.getLine(offset) != mLine)
+            {
+                mLine = mChunk.getLine(offset);
+                mSink.print("        // line %d\n", mLine);
+            }
+
+            const std::uint8_t* operands = &mChunk.getCode(offset) + 1;
+            // Unchecked variants are translated as their checked instruction, the static types remove the same checks
+            std::uint8_t instruction = TypeInference::generalize(mChunk.getCode(offset));
+            switch (instruction)
+            {
+                case Chunk::Op_Constant: constant(operands[0]); break;
+                case Chunk::Op_Null: push(Type_Null); break;
+                case Chunk::Op_True:
+                case Chunk::Op_False:
+                    declare(push(Type_Bool));
+                    mSink.print(" = %s;\n", instruction == Chunk::Op_True ? "true" : "false");
+                    break;
+                case Chunk::Op_GetInput:
+                    declare(push(Type_Unknown));
+                    mSink.print(" = inputs[%d];\n", operands[0]);
+                    break;
+                case Chunk::Op_GetLocal: getLocal(operands[0]); break;
+                // A local of the generated code is never assigned again : the slot shares the local of the value
+                case Chunk::Op_SetLocal:
+                    discard(mSlots[operands[0]]);
+                    mSlots[operands[0]] = mSlots[mDepth - 1];
+                    break;
+                case Chunk::Op_GetGlobal:
+                    declare(push(Type_Unknown));
+                    mSink.print(" = AotRuntime::getGlobal(virtualMachine, %d);\n", operands[0]);
+                    break;
+                case Chunk::Op_SetGlobal: setGlobal(operands[0]); break;
+                case Chunk::Op_Pop: discard(mSlots[--mDepth]); break;
+                case Chunk::Op_Equal: equality(false); break;
+                case Chunk::Op_BangEqual: equality(true); break;
+                case Chunk::Op_Greater:
+                case Chunk::Op_GreaterEqual:
+                case Chunk::Op_Less:
+                case Chunk::Op_LessEqual:
+                    comparison(instruction);
+                    break;
+                case Chunk::Op_Add:
+                case Chunk::Op_Substract:
+                case Chunk::Op_Multiply:
+                case Chunk::Op_Divide:
+                    arithmetic(instruction);
+                    break;
+                case Chunk::Op_Not: logicalNot(); break;
+                case Chunk::Op_Negate: negate(); break;
+                case Chunk::Op_CallNative: callNative(mChunk.getConstant(operands[0]).asNative(), operands[1]); break;
+                case Chunk::Op_Return:
+                    // Locals below the result may never have been read
+                    for (std::size_t i = 0; i + 1 < mDepth; i++)
+                    {
+                        discard(mSlots[i]);
+                    }
+                    mSink.print("        *result = %s;\n", valueOf(mSlots[mDepth - 1]).text);
+                    mSink.write("        return VirtualMachine::Interpret_Ok;\n");
+                    break;
+            }
+        }
+    }
+
+    void Translator::constant(std::size_t index)
+    {
+        const Value& value = mChunk.getConstant(index);
+        switch (value.getType())
+        {
+            case Value::Null:
+                push(Type_Null);
+                break;
+            case Value::Bool:
+                declare(push(Type_Bool));
+                mSink.print(" = %s;\n", value.asBool() ? "true" : "false");
+                break;
+            case Value::Number:
+                declare(push(Type_Double));
+                mSink.write(" = ");
+                printDouble(value.asDouble(), mSink);
+                mSink.write(";\n");
+                break;
+            case Value::Integer:
+                declare(push(Type_Integer));
+                mSink.write(" = ");
+                printInteger(value.asInteger(), mSink);
+                mSink.write(";\n");
+                break;
+            case Value::Object:
+                // Only strings, natives are only referenced by Op_CallNative
+                declare(push(Type_String));
+                mSink.print(" = Value(&string%zu.obj);\n", index);
+                break;
+        }
+    }
+
+    // A copy, an instruction never gets the same local for both operands
+    void Translator::getLocal(std::uint8_t slot)
+    {
+        Slot local = mSlots[slot];
+        Slot& copy = push(local.type);
+        if (local.type != Type_Null)
+        {
+            declare(copy);
+            mSink.print(" = t%d;\n", local.local);
+        }
+    }
+
+    // Only an unknown value may be an object, the others are stored without a check
+    void Translator::setGlobal(std::uint8_t index)
+    {
+        const Slot& value = mSlots[mDepth - 1];
+        if (value.type == Type_Unknown || value.type == Type_String)
+        {
+            char call[160];
+            snprintf(call, sizeof(call), "AotRuntime::setGlobal(virtualMachine, %d, %s, %d)", index, valueOf(value).text, mLine);
+            runtimeCheck(call);
+        }
+        else
+        {
+            mSink.print("        AotRuntime::storeGlobal(virtualMachine, %d, %s);\n", index, valueOf(value).text);
+        }
+    }
+
+    // Value::isEquals
+    void Translator::equality(bool negated)
+    {
+        Slot a = mSlots[mDepth - 2];
+        Slot b = mSlots[mDepth - 1];
+        mDepth -= 2;
+        declare(push(Type_Bool));
+
+        bool sameScalar = a.type == b.type && (a.type == Type_Double || a.type == Type_Integer || a.type == Type_Bool);
+        bool numericA = isNumeric(a.type);
+        bool numericB = isNumeric(b.type);
+        if (sameScalar)
+        {
+            mSink.print(" = t%d %s t%d;\n", a.local, negated ? "!=" : "==", b.local);
+        }
+        else if (a.type == Type_Null && b.type == Type_Null)
+        {
+            mSink.print(" = %s;\n", negated ? "false" : "true");
+        }
+        else if (a.type != Type_Unknown && b.type != Type_Unknown && (numericA != numericB || (!numericA && a.type != b.type)))
+        {
+            // Different types are never equal, except integers and doubles
+            mSink.print(" = %s;\n", negated ? "true" : "false");
+            discard(a);
+            discard(b);
+        }
+        else
+        {
+            mSink.print(" = %s%s.isEquals(%s);\n", negated ? "!" : "", valueOf(a).text, valueOf(b).text);
+        }
+    }
+
+    // COMPARISON_OP : integers are compared as integers, mixed numbers exactly (see Arithmetic::compareMixed)
+    void Translator::comparison(std::uint8_t instruction)
+    {
+        Slot a = mSlots[mDepth - 2];
+        Slot b = mSlots[mDepth - 1];
+        mDepth -= 2;
+        const char* op = operators[instruction - Chunk::Op_Equal];
+        if ((isNumeric(a.type) || a.type == Type_Unknown) && (isNumeric(b.type) || b.type == Type_Unknown))
+        {
+            requireNumber(instruction, a);
+            requireNumber(instruction, b);
+        }
+
+        if (isScalar(a.type) && isScalar(b.type))
+        {
+            declare(push(Type_Bool));
+            if (a.type == b.type)
+            {
+                mSink.print(" = t%d %s t%d;\n", a.local, op, b.local);
+            }
+            else if (a.type == Type_Integer)
+            {
+                mSink.print(" = Arithmetic::compareMixed(t%d, t%d) %s 0.0;\n", a.local, b.local, op);
+            }
+            else
+            {
+                mSink.print(" = 0.0 %s Arithmetic::compareMixed(t%d, t%d);\n", op, b.local, a.local);
+            }
+        }
+        else if (isNumeric(a.type) && isNumeric(b.type))
+        {
+            declare(push(Type_Bool));
+            if (a.type == Type_Double || b.type == Type_Double)
+            {
+                mSink.print(" = AotRuntime::order(%s, %s) %s 0.0;\n", valueOf(a).text, valueOf(b).text, op);
+            }
+            else
+            {
+                mSink.print(" = %s ? %s %s %s : AotRuntime::order(%s, %s) %s 0.0;\n", bothIntegers(a, b).text, integerOf(a).text, op,
+                            integerOf(b).text, valueOf(a).text, valueOf(b).text, op);
+            }
+        }
+        else
+        {
+            int compared = mLocals++;
+            mSink.print("        Value t%d;\n", compared);
+            char call[160];
+            snprintf(call, sizeof(call), "AotRuntime::binary(virtualMachine, %s, %s, %s, &t%d, %d)", opCodeNames[instruction],
+                     valueOf(a).text, valueOf(b).text, compared, mLine);
+            runtimeCheck(call);
+            declare(push(Type_Bool));
+            mSink.print(" = t%d.asBool();\n", compared);
+        }
+    }
+
+    // ARITHMETIC_OP : integers stay integers unless the result doesn't fit, anything with a double is a double
+    void Translator::arithmetic(std::uint8_t instruction)
+    {
+        Slot a = mSlots[mDepth - 2];
+        Slot b = mSlots[mDepth - 1];
+        mDepth -= 2;
+        const char* op = operators[instruction - Chunk::Op_Equal];
+        const char* helper = integerHelpers[instruction - Chunk::Op_Add];
+        // Two unknown operands may be two strings to concatenate
+        bool numbers = instruction != Chunk::Op_Add || isNumeric(a.type) || isNumeric(b.type);
+        if (numbers && (isNumeric(a.type) || a.type == Type_Unknown) && (isNumeric(b.type) || b.type == Type_Unknown))
+        {
+            requireNumber(instruction, a);
+            requireNumber(instruction, b);
+        }
+
+        if (isNumeric(a.type) && isNumeric(b.type) && (a.type == Type_Double || b.type == Type_Double))
+        {
+            declare(push(Type_Double));
+            mSink.print(" = %s %s %s;\n", numberOf(a).text, op, numberOf(b).text);
+        }
+        else if (a.type == Type_Integer && b.type == Type_Integer)
+        {
+            declare(push(Type_Number));
+            mSink.print(" = AotRuntime::%s(t%d, t%d);\n", helper, a.local, b.local);
+        }
+        else if (isNumeric(a.type) && isNumeric(b.type))
+        {
+            declare(push(Type_Number));
+            mSink.print(" = %s ? AotRuntime::%s(%s, %s) : Value(%s %s %s);\n", bothIntegers(a, b).text, helper,
+                        integerOf(a).text, integerOf(b).text, numberOf(a).text, op, numberOf(b).text);
+        }
+        else
+        {
+            Slot& result = push(instruction == Chunk::Op_Add && a.type == Type_String && b.type == Type_String ? Type_String : Type_Unknown);
+            declare(result);
+            mSink.write(";\n");
+            char call[160];
+            snprintf(call, sizeof(call), "AotRuntime::binary(virtualMachine, %s, %s, %s, &t%d, %d)", opCodeNames[instruction],
+                     valueOf(a).text, valueOf(b).text, result.local, mLine);
+            runtimeCheck(call);
+        }
+    }
+
+    // Value::isFalsey : only null and false
+    void Translator::logicalNot()
+    {
+        Slot value = mSlots[--mDepth];
+        declare(push(Type_Bool));
+        switch (value.type)
+        {
+            case Type_Null: mSink.write(" = true;\n"); break;
+            case Type_Bool: mSink.print(" = !t%d;\n", value.local); break;
+            case Type_Unknown: mSink.print(" = t%d.isFalsey();\n", value.local); break;
+            default:
+                mSink.write(" = false;\n");
+                discard(value);
+                break;
+        }
+    }
+
+    void Translator::negate()
+    {
+        Slot value = mSlots[--mDepth];
+        requireNumber(Chunk::Op_Negate, value);
+        switch (value.type)
+        {
+            case Type_Double:
+                declare(push(Type_Double));
+                mSink.print(" = -t%d;\n", value.local);
+                break;
+            case Type_Integer:
+                declare(push(Type_Number));
+                mSink.print(" = AotRuntime::negate(t%d);\n", value.local);
+                break;
+            case Type_Number:
+                declare(push(Type_Number));
+                mSink.print(" = t%d.isInteger() ? AotRuntime::negate(t%d.asInteger()) : Value(-t%d.asDouble());\n",
+                            value.local, value.local, value.local);
+                break;
+            default:
+            {
+                Slot& result = push(Type_Unknown);
+                declare(result);
+                mSink.write(";\n");
+                char call[160];
+                snprintf(call, sizeof(call), "AotRuntime::negate(%s, &t%d, %d)", valueOf(value).text, result.local, mLine);
+                runtimeCheck(call);
+                break;
+            }
+        }
+    }
+
+    void Translator::callNative(const ObjNative* native, std::uint8_t argumentCount)
+    {
+        int index = -1;
+        for (std::size_t i = 0; i < mChunk.constantCount(); i++)
+        {
+            if (mChunk.getConstant(i).isObject() && mChunk.getConstant(i).asObject() == &native->obj)
+            {
+                index = mNatives[i];
+                break;
+            }
+        }
+
+        Slot* arguments = &mSlots[mDepth - argumentCount];
+        int argumentsLocal = mLocals++;
+        if (argumentCount > 0)
+        {
+            mSink.print("        const Value t%d[] = { ", argumentsLocal);
+            for (std::uint8_t i = 0; i < argumentCount; i++)
+            {
+                mSink.print("%s%s", i > 0 ? ", " : "", valueOf(arguments[i]).text);
+            }
+            mSink.write(" };\n");
+        }
+        mDepth -= argumentCount;
+
+        Slot& result = push(Type_Unknown);
+        declare(result);
+        mSink.write(";\n");
+        char call[160];
+        if (argumentCount > 0)
+        {
+            snprintf(call, sizeof(call), "AotRuntime::callNative(natives[%d], t%d, &t%d, %d)", index, argumentsLocal, result.local, mLine);
+        }
+        else
+        {
+            snprintf(call, sizeof(call), "AotRuntime::callNative(natives[%d], nullptr, &t%d, %d)", index, result.local, mLine);
+        }
+        runtimeCheck(call);
+    }
+}
+
+bool CppTranslator::translate(const Chunk& chunk, const char* identifier, OutputSink& sink)
+{
+    if (!chunk.isVerified())
+    {
+        fprintf(stderr, "Chunk must be verified before being translated.\n");
+        return false;
+    }
+    if (!isIdentifier(identifier))
+    {
+        fprintf(stderr, "'%s' is not a valid C++ identifier.\n", identifier != nullptr ? identifier : "");
+        return false;
+    }
+
+    sink.write("// Generated by CppTranslator from ");
+    printString(chunk.getName(), strlen(chunk.getName()), sink);
+    sink.write(", do not edit\n");
+    sink.write("#include \"AotScript.hpp\"\n\n#include <cmath>\n\nnamespace\n{\n");
+
+    // Static strings, never freed nor modified
+    for (std::size_t i = 0; i < chunk.constantCount(); i++)
+    {
+        const Value& constant = chunk.getConstant(i);
+        if (constant.isString())
+        {
+            const ObjString* string = constant.asString();
+            sink.print("    char string%zuChars[] = ", i);
+            printString(string->chars, string->length, sink);
+            sink.print(";\n    ObjString string%zu = { { Obj::String, nullptr }, %d, string%zuChars };\n\n", i, string->length, i);
+        }
+    }
+
+    // One entry per native function, whatever the number of calls
+    int* natives = MEMORY_ALLOCATE(int, chunk.constantCount() + 1);
+    int nativeCount = 0;
+    for (std::size_t i = 0; i < chunk.constantCount(); i++)
+    {
+        natives[i] = -1;
+        const Value& constant = chunk.getConstant(i);
+        if (constant.isNative())
+        {
+            for (std::size_t j = 0; j < i; j++)
+            {
+                if (natives[j] >= 0 && strcmp(chunk.getConstant(j).asNative()->name->chars, constant.asNative()->name->chars) == 0)
+                {
+                    natives[i] = natives[j];
+                }
+            }
+            if (natives[i] < 0)
+            {
+                natives[i] = nativeCount++;
+            }
+        }
+    }
+    if (nativeCount > 0)
+    {
+        sink.write("    const char* const nativeNames[] = {");
+        for (int native = 0; native < nativeCount; native++)
+        {
+            for (std::size_t i = 0; i < chunk.constantCount(); i++)
+            {
+                if (natives[i] == native)
+                {
+                    const ObjString* name = chunk.getConstant(i).asNative()->name;
+                    sink.write(native > 0 ? ", " : " ");
+                    printString(name->chars, name->length, sink);
+                    break;
+                }
+            }
+        }
+        sink.write(" };\n    const int nativeArities[] = {");
+        for (int native = 0; native < nativeCount; native++)
+        {
+            for (std::size_t i = 0; i < chunk.constantCount(); i++)
+            {
+                if (natives[i] == native)
+                {
+                    sink.print("%s%d", native > 0 ? ", " : " ", chunk.getConstant(i).asNative()->arity);
+                    break;
+                }
+            }
+        }
+        sink.write(" };\n\n");
+    }
+
+    sink.write("    VirtualMachine::InterpretResult run(VirtualMachine& virtualMachine, const NativeBinding* natives, const Value* inputs, Value* result)\n");
+    sink.write("    {\n        (void)virtualMachine;\n        (void)natives;\n        (void)inputs;\n");
+    {
+        Translator translator(chunk, sink, natives);
+        translator.translate();
+    }
+    sink.write("    }\n}\n\n");
+    MEMORY_FREE_ARRAY(int, natives, chunk.constantCount() + 1);
+
+    sink.print("extern const AotDefinition %s;\n", identifier);
+    sink.print("const AotDefinition %s = { ", identifier);
+    printString(chunk.getName(), strlen(chunk.getName()), sink);
+    if (nativeCount > 0)
+    {
+        sink.print(", &run, nativeNames, nativeArities, %d, %zu, %zu };\n", nativeCount, chunk.getInputCount(), chunk.getGlobalCount());
+    }
+    else
+    {
+        sink.print(", &run, nullptr, nullptr, 0, %zu, %zu };\n", chunk.getInputCount(), chunk.getGlobalCount());
+    }
+    return true;
+}
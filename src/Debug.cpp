@@ -1,82 +1,111 @@
 #include "Debug.hpp"
 
-void Debug::disassembleChunk(const Chunk& chunk, const char* name)
+void Debug::disassembleChunk(const Chunk& chunk, const char* name, OutputSink& sink)
 {
-	printf("== %s ==\n", name);
+	sink.print("== %s ==\n", name);
 	for (std::size_t i = 0; i < chunk.size();)
 	{
-		i = disassembleInstruction(chunk, i);
+		i = disassembleInstruction(chunk, i, sink);
 	}
 }
 
-std::size_t Debug::disassembleInstruction(const Chunk& chunk, std::size_t offset)
+std::size_t Debug::disassembleInstruction(const Chunk& chunk, std::size_t offset, OutputSink& sink)
 {
-    printf("%04d ", offset);
+    sink.print("%04zu ", offset);
 
     int line = chunk.getLine(offset);
 	if (offset > 0 && line == chunk.getLine(offset - 1))
 	{
-		printf("   | ");
+		sink.write("   | ");
 	}
 	else
 	{
-		printf("%4d ", line);
+		sink.print("%4d ", line);
 	}
 
 	uint8_t instruction = chunk.getCode(offset);
 	switch (instruction)
 	{
-		case Chunk::Op_Constant: return constantInstruction("Op_Constant", chunk, offset);
-		case Chunk::Op_Null: return simpleInstruction("Op_Null", offset);
-		case Chunk::Op_True: return simpleInstruction("Op_True", offset);
-		case Chunk::Op_False: return simpleInstruction("Op_False", offset);
-		case Chunk::Op_Equal: return simpleInstruction("Op_Equal", offset);
-		case Chunk::Op_BangEqual: return simpleInstruction("Op_BangEqual", offset);
-		case Chunk::Op_Greater: return simpleInstruction("Op_Greater", offset);
-		case Chunk::Op_GreaterEqual: return simpleInstruction("Op_GreaterEqual", offset);
-		case Chunk::Op_Less: return simpleInstruction("Op_Less", offset);
-		case Chunk::Op_LessEqual: return simpleInstruction("Op_LessEqual", offset);
-		case Chunk::Op_Add: return simpleInstruction("Op_Add", offset);
-		case Chunk::Op_Substract: return simpleInstruction("Op_Substract", offset);
-		case Chunk::Op_Multiply: return simpleInstruction("Op_Multiply", offset);
-		case Chunk::Op_Divide: return simpleInstruction("Op_Divide", offset);
-		case Chunk::Op_Not: return simpleInstruction("Op_Not", offset);
-		case Chunk::Op_Negate: return simpleInstruction("Op_Negate", offset);
-		case Chunk::Op_Return: return simpleInstruction("Op_Return", offset);
-		default: printf("Unknown opcode %d\n", instruction); return offset + 1;
+		#define BLISSX_DISASSEMBLE_Simple simpleInstruction
+		#define BLISSX_DISASSEMBLE_Constant constantInstruction
+		#define BLISSX_DISASSEMBLE_Call callInstruction
+		#define BLISSX_DISASSEMBLE_Input byteInstruction
+		#define BLISSX_DISASSEMBLE_Local byteInstruction
+		#define BLISSX_DISASSEMBLE_Global byteInstruction
+		#define BLISSX_OPCODE_DISASSEMBLE(name, format, pops, pushes) \
+			case Chunk::Op_##name: return BLISSX_DISASSEMBLE_##format("Op_" #name, chunk, offset, sink);
+		BLISSX_OPCODES(BLISSX_OPCODE_DISASSEMBLE)
+		#undef BLISSX_OPCODE_DISASSEMBLE
+		#undef BLISSX_DISASSEMBLE_Global
+		#undef BLISSX_DISASSEMBLE_Local
+		#undef BLISSX_DISASSEMBLE_Input
+		#undef BLISSX_DISASSEMBLE_Call
+		#undef BLISSX_DISASSEMBLE_Constant
+		#undef BLISSX_DISASSEMBLE_Simple
+		default: sink.print("Unknown opcode %d\n", instruction); return offset + 1;
 	}
 }
 
-void Debug::printValue(Value value)
+const char* Debug::getOpCodeName(std::uint8_t instruction)
+{
+    static const char* const names[] = {
+        #define BLISSX_OPCODE_NAME(name, format, pops, pushes) "Op_" #name,
+        BLISSX_OPCODES(BLISSX_OPCODE_NAME)
+        #undef BLISSX_OPCODE_NAME
+    };
+
+    if (instruction >= Chunk::Op_Count) return "Unknown";
+    return names[instruction];
+}
+
+void Debug::printValue(Value value, OutputSink& sink)
 {
     switch (value.getType())
     {
-        case Value::Type::Bool: printf(value.asBool() ? "true" : "false"); break;
-        case Value::Type::Null: printf("null"); break;
-        case Value::Type::Number: printf("%g", value.asNumber()); break;
-        case Value::Type::Object: printObject(value); break;
+        case Value::Type::Bool: sink.write(value.asBool() ? "true" : "false"); break;
+        case Value::Type::Null: sink.write("null"); break;
+        case Value::Type::Number: sink.printNumber(value.asDouble()); break;
+        case Value::Type::Integer: sink.printInteger(value.asInteger()); break;
+        case Value::Type::Object: printObject(value, sink); break;
     }
 }
 
-void Debug::printObject(Value value)
+void Debug::printObject(Value value, OutputSink& sink)
 {
     switch (value.getObjectType())
     {
-        case Obj::Type::String: printf("%s", value.asCString()); break;
+        case Obj::Type::String: sink.write(value.asString()->chars, value.asString()->length); break;
+        case Obj::Type::Native: sink.print("<native %s>", value.asNative()->name->chars); break;
     }
 }
 
-std::size_t Debug::constantInstruction(const char* name, const Chunk& chunk, std::size_t offset)
+std::size_t Debug::constantInstruction(const char* name, const Chunk& chunk, std::size_t offset, OutputSink& sink)
 {
     std::uint8_t constant = chunk.getCode(offset + 1);
-	printf("%-16s %4d '", name, constant);
-	printValue(chunk.getConstant(constant));
-	printf("'\n");
+	sink.print("%-16s %4d '", name, constant);
+	printValue(chunk.getConstant(constant), sink);
+	sink.write("'\n");
 	return offset + 2;
 }
 
-std::size_t Debug::simpleInstruction(const char* name, std::size_t offset)
+std::size_t Debug::callInstruction(const char* name, const Chunk& chunk, std::size_t offset, OutputSink& sink)
+{
+    std::uint8_t constant = chunk.getCode(offset + 1);
+    std::uint8_t argumentCount = chunk.getCode(offset + 2);
+    sink.print("%-16s %4d '", name, constant);
+    printValue(chunk.getConstant(constant), sink);
+    sink.print("' (%d args)\n", argumentCount);
+    return offset + 3;
+}
+
+std::size_t Debug::byteInstruction(const char* name, const Chunk& chunk, std::size_t offset, OutputSink& sink)
+{
+    sink.print("%-16s %4d\n", name, chunk.getCode(offset + 1));
+    return offset + 2;
+}
+
+std::size_t Debug::simpleInstruction(const char* name, const Chunk& /* chunk */, std::size_t offset, OutputSink& sink)
 {
-    printf("%s\n", name);
+    sink.print("%s\n", name);
     return offset + 1;
 }
@@ -0,0 +1,159 @@
+#include "Environment.hpp"
+
+#include <cstdio>
+
+Environment::Environment()
+    : mCount(0)
+    , mCapacity(0)
+    , mBindings(nullptr)
+    , mInputs{ 0, 0, nullptr }
+    , mGlobals{ 0, 0, nullptr }
+{
+}
+
+Environment::~Environment()
+{
+    for (std::size_t i = 0; i < mCount; i++)
+    {
+        MEMORY_FREE_ARRAY(char, (char*)mBindings[i].name, mBindings[i].length + 1);
+    }
+    MEMORY_FREE_ARRAY(NativeBinding, mBindings, mCapacity);
+
+    freeNames(mInputs);
+    freeNames(mGlobals);
+}
+
+const NativeBinding* Environment::find(const char* name, int length) const
+{
+    // Only used while compiling
+    for (std::size_t i = 0; i < mCount; i++)
+    {
+        if (mBindings[i].length == length && memcmp(mBindings[i].name, name, length) == 0)
+        {
+            return &mBindings[i];
+        }
+    }
+    return nullptr;
+}
+
+std::size_t Environment::size() const
+{
+    return mCount;
+}
+
+int Environment::addInput(const char* name)
+{
+    int slot = addName(mInputs, name, ENVIRONMENT_MAX_INPUTS);
+    if (slot < 0)
+    {
+        fprintf(stderr, "Too many inputs in one environment.\n");
+    }
+    return slot;
+}
+
+int Environment::findInput(const char* name, int length) const
+{
+    return findName(mInputs, name, length);
+}
+
+std::size_t Environment::inputCount() const
+{
+    return mInputs.count;
+}
+
+int Environment::addGlobal(const char* name)
+{
+    int index = addName(mGlobals, name, ENVIRONMENT_MAX_GLOBALS);
+    if (index < 0)
+    {
+        fprintf(stderr, "Too many globals in one environment.\n");
+    }
+    return index;
+}
+
+int Environment::findGlobal(const char* name, int length) const
+{
+    return findName(mGlobals, name, length);
+}
+
+std::size_t Environment::globalCount() const
+{
+    return mGlobals.count;
+}
+
+void Environment::add(const char* name, NativeThunk thunk, NativeFunction function, int arity)
+{
+    int length = (int)strlen(name);
+
+    // Binding the same name again replaces the previous function
+    NativeBinding* binding = (NativeBinding*)find(name, length);
+    if (binding == nullptr)
+    {
+        if (mCapacity < mCount + 1)
+        {
+            std::size_t capacity = MEMORY_GROW_CAPACITY(mCapacity);
+            mBindings = MEMORY_GROW_ARRAY(mBindings, NativeBinding, mCapacity, capacity);
+            mCapacity = capacity;
+        }
+
+        char* copy = MEMORY_ALLOCATE(char, length + 1);
+        memcpy(copy, name, length + 1);
+
+        binding = &mBindings[mCount];
+        binding->name = copy;
+        binding->length = length;
+        mCount++;
+    }
+
+    binding->thunk = thunk;
+    binding->function = function;
+    binding->arity = arity;
+}
+
+int Environment::addName(Names& names, const char* name, std::size_t max)
+{
+    int length = (int)strlen(name);
+    int slot = findName(names, name, length);
+    if (slot >= 0)
+    {
+        return slot;
+    }
+
+    if (names.count == max)
+    {
+        return -1;
+    }
+
+    if (names.capacity < names.count + 1)
+    {
+        std::size_t capacity = MEMORY_GROW_CAPACITY(names.capacity);
+        names.names = MEMORY_GROW_ARRAY(names.names, char*, names.capacity, capacity);
+        names.capacity = capacity;
+    }
+
+    char* copy = MEMORY_ALLOCATE(char, length + 1);
+    memcpy(copy, name, length + 1);
+    names.names[names.count] = copy;
+    return (int)names.count++;
+}
+
+int Environment::findName(const Names& names, const char* name, int length)
+{
+    for (std::size_t i = 0; i < names.count; i++)
+    {
+        if (strncmp(names.names[i], name, length) == 0 && names.names[i][length] == '\0')
+        {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+void Environment::freeNames(Names& names)
+{
+    for (std::size_t i = 0; i < names.count; i++)
+    {
+        MEMORY_FREE_ARRAY(char, names.names[i], strlen(names.names[i]) + 1);
+    }
+    MEMORY_FREE_ARRAY(char*, names.names, names.capacity);
+}
@@ -0,0 +1,59 @@
+#include "Heap.hpp"
+
+#include "Value.hpp"
+
+Heap::Heap()
+    : mObjects(nullptr)
+    , mCount(0)
+{
+}
+
+Heap::~Heap()
+{
+    clear();
+}
+
+void Heap::add(Obj* object)
+{
+    object->next = mObjects;
+    mObjects = object;
+    mCount++;
+}
+
+void Heap::clear()
+{
+    Obj* object = mObjects;
+    while (object != nullptr)
+    {
+        Obj* next = object->next;
+        freeObject(object);
+        object = next;
+    }
+    mObjects = nullptr;
+    mCount = 0;
+}
+
+std::size_t Heap::size() const
+{
+    return mCount;
+}
+
+void Heap::freeObject(Obj* object)
+{
+    switch (object->type)
+    {
+        case Obj::Type::String:
+        {
+            ObjString* string = (ObjString*)object;
+            MEMORY_FREE_ARRAY(char, string->chars, string->length + 1);
+            Memory::reallocate(string, sizeof(ObjString), 0);
+            break;
+        }
+        case Obj::Type::Native:
+        {
+            // The name is another object of the heap
+            Memory::reallocate(object, sizeof(ObjNative), 0);
+            break;
+        }
+    }
+}
@@ -0,0 +1,883 @@
+#include "Jit.hpp"
+
+#ifdef BLISSX_JIT
+
+#include "Arithmetic.hpp"
+#include "TypeInference.hpp"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <type_traits>
+
+// The templates read and write values in place : a 32 bits type at offset 0 then the payload at offset 8
+static_assert(std::is_standard_layout_v<Value> && sizeof(Value) == 16 && sizeof(Value::Type) == 4, "Unexpected layout of Value");
+
+namespace
+{
+    typedef X64Assembler Asm;
+
+    // Registers kept during the whole function (callee saved) : the first slot of the stack, the inputs and the globals
+    const Asm::Register Stack = Asm::RBX;
+    const Asm::Register Inputs = Asm::R12;
+    const Asm::Register Globals = Asm::R13;
+
+    // Type of a stack slot while translating, Unknown when only known at run time
+    const int Unknown = -1;
+
+    std::int32_t typeOf(std::size_t slot)
+    {
+        return (std::int32_t)(slot * sizeof(Value));
+    }
+
+    std::int32_t payloadOf(std::size_t slot)
+    {
+        return (std::int32_t)(slot * sizeof(Value) + 8);
+    }
+
+    bool maybeNumber(int type)
+    {
+        return type == Unknown || type == Value::Number || type == Value::Integer;
+    }
+
+    bool maybeInteger(int type)
+    {
+        return type == Unknown || type == Value::Integer;
+    }
+
+    // Called by the templates when an integer and a double compare equal or unordered once converted to doubles :
+    // the conversion may have rounded the integer (2^53 + 1 is 2^53.0), the other outcomes are exact
+    bool compareExactly(const Value* operands, std::uint8_t instruction)
+    {
+        const Value& left = operands[0];
+        const Value& right = operands[1];
+        double order;
+        if (left.isInteger()) order = Arithmetic::compareMixed(left.asInteger(), right.asDouble());
+        else if (right.isInteger()) order = -Arithmetic::compareMixed(right.asInteger(), left.asDouble());
+        else order = left.asDouble() == right.asDouble() ? 0.0 : left.asDouble() - right.asDouble();
+        switch (instruction)
+        {
+            case Chunk::Op_Greater: return order > 0.0;
+            case Chunk::Op_GreaterEqual: return order >= 0.0;
+            case Chunk::Op_Less: return order < 0.0;
+            default: return order <= 0.0;
+        }
+    }
+
+    // Translation of one chunk, the stack depth of every instruction is known since there are no jumps
+    class Translator
+    {
+        public:
+            Translator(Asm& assembler, const Chunk& chunk)
+                : a(assembler)
+                , mChunk(chunk)
+                , mTypes(MEMORY_ALLOCATE(int, chunk.getMaxStackDepth() + 1))
+                , mDepth(0)
+                , mOffset(0)
+                , mInstructionDepth(0)
+                , mDeopt(0)
+                , mHasDeopt(false)
+                , mExits(nullptr)
+                , mExitCount(0)
+                , mExitCapacity(0)
+            {
+            }
+
+            ~Translator()
+            {
+                MEMORY_FREE_ARRAY(int, mTypes, mChunk.getMaxStackDepth() + 1);
+                MEMORY_FREE_ARRAY(PendingExit, mExits, mExitCapacity);
+            }
+
+            bool translate();
+
+        private:
+            // Label jumping back to the interpreter before the current instruction, created on first use
+            Asm::Label deopt();
+
+            void constant(const Value& value);
+            void input(std::uint8_t slot);
+            void copyValue(Asm::Register to, std::int32_t toOffset, Asm::Register from, std::int32_t fromOffset, int type);
+            void getLocal(std::uint8_t slot);
+            void setLocal(std::uint8_t slot);
+            void getGlobal(std::uint8_t index);
+            void setGlobal(std::uint8_t index);
+            void arithmetic(std::uint8_t instruction);
+            void comparison(std::uint8_t instruction);
+            void equality(bool negated);
+            void mixedEquality(std::size_t doubleSlot, std::size_t integerSlot);
+            void logicalNot();
+            void negate();
+            void callNative(const ObjNative* native, std::uint8_t argumentCount);
+
+            // Double in the register, from a double or an integer slot, anything else goes back to the interpreter
+            void loadNumber(Asm::Xmm destination, std::size_t slot);
+            // The bool in al
+            void storeBool(std::size_t slot);
+
+            static std::uint64_t exitCode(std::size_t offset, std::size_t depth);
+
+            Asm& a;
+            const Chunk& mChunk;
+            int* mTypes;
+            std::size_t mDepth;
+            // Offset and stack depth of the instruction being translated, where its deopt resumes
+            std::size_t mOffset;
+            std::size_t mInstructionDepth;
+            Asm::Label mDeopt;
+            bool mHasDeopt;
+
+            struct PendingExit
+            {
+                Asm::Label label;
+                std::uint64_t code;
+            };
+            PendingExit* mExits;
+            std::size_t mExitCount;
+            std::size_t mExitCapacity;
+    };
+
+    // Returned in rax : depth in the high half, offset in the low half
+    std::uint64_t Translator::exitCode(std::size_t offset, std::size_t depth)
+    {
+        return (std::uint64_t)depth << 32 | (std::uint64_t)offset;
+    }
+
+    Asm::Label Translator::deopt()
+    {
+        if (!mHasDeopt)
+        {
+            if (mExitCapacity < mExitCount + 1)
+            {
+                std::size_t capacity = MEMORY_GROW_CAPACITY(mExitCapacity);
+                mExits = MEMORY_GROW_ARRAY(mExits, PendingExit, mExitCapacity, capacity);
+                mExitCapacity = capacity;
+            }
+            mDeopt = a.newLabel();
+            mExits[mExitCount++] = { mDeopt, exitCode(mOffset, mInstructionDepth) };
+            mHasDeopt = true;
+        }
+        return mDeopt;
+    }
+
+    // uint64_t function(Value* stack, const Value* inputs, Value* globals)
+    bool Translator::translate()
+    {
+        Asm::Label exit = a.newLabel();
+
+        // Three pushes keep the stack aligned on 16 bytes for the native calls
+        a.push(Stack);
+        a.push(Inputs);
+        a.push(Globals);
+        a.mov(Stack, Asm::RDI);
+        a.mov(Inputs, Asm::RSI);
+        a.mov(Globals, Asm::RDX);
+
+        for (mOffset = 0; mOffset < mChunk.size(); mOffset += Chunk::getInstructionLength(mChunk.getCode(mOffset)))
+        {
+            mHasDeopt = false;
+            mInstructionDepth = mDepth;
+            const std::uint8_t* operands = &mChunk.getCode(mOffset) + 1;
+            // Unchecked variants are translated as their checked instruction, the types tracked here remove the same checks
+            std::uint8_t instruction = TypeInference::generalize(mChunk.getCode(mOffset));
+            switch (instruction)
+            {
+                case Chunk::Op_Constant: constant(mChunk.getConstant(operands[0])); break;
+                case Chunk::Op_Null: constant(Value()); break;
+                case Chunk::Op_True: constant(Value(true)); break;
+                case Chunk::Op_False: constant(Value(false)); break;
+                case Chunk::Op_GetInput: input(operands[0]); break;
+                case Chunk::Op_GetLocal: getLocal(operands[0]); break;
+                case Chunk::Op_SetLocal: setLocal(operands[0]); break;
+                case Chunk::Op_GetGlobal: getGlobal(operands[0]); break;
+                case Chunk::Op_SetGlobal: setGlobal(operands[0]); break;
+                case Chunk::Op_Pop: mDepth--; break;
+                case Chunk::Op_Equal: equality(false); break;
+                case Chunk::Op_BangEqual: equality(true); break;
+                case Chunk::Op_Greater:
+                case Chunk::Op_GreaterEqual:
+                case Chunk::Op_Less:
+                case Chunk::Op_LessEqual:
+                    comparison(instruction);
+                    break;
+                case Chunk::Op_Add:
+                case Chunk::Op_Substract:
+                case Chunk::Op_Multiply:
+                case Chunk::Op_Divide:
+                    arithmetic(instruction);
+                    break;
+                case Chunk::Op_Not: logicalNot(); break;
+                case Chunk::Op_Negate: negate(); break;
+                case Chunk::Op_CallNative: callNative(mChunk.getConstant(operands[0]).asNative(), operands[1]); break;
+                case Chunk::Op_Return:
+                    // The interpreter has nothing left to do, execute pops the result
+                    a.movImmediate(Asm::RAX, exitCode(mOffset, mDepth));
+                    a.jump(exit);
+                    break;
+                default:
+                    return false;
+            }
+        }
+
+        for (std::size_t i = 0; i < mExitCount; i++)
+        {
+            a.bind(mExits[i].label);
+            a.movImmediate(Asm::RAX, mExits[i].code);
+            a.jump(exit);
+        }
+
+        a.bind(exit);
+        a.pop(Globals);
+        a.pop(Inputs);
+        a.pop(Stack);
+        a.ret();
+        return a.resolve();
+    }
+
+    void Translator::constant(const Value& value)
+    {
+        std::uint64_t payload = 0;
+        if (value.isBool())
+        {
+            payload = value.asBool();
+        }
+        else if (!value.isNull())
+        {
+            memcpy(&payload, (const char*)&value + 8, sizeof(payload));
+        }
+
+        a.store32Immediate(Stack, typeOf(mDepth), value.getType());
+        a.movImmediate(Asm::RAX, payload);
+        a.store(Stack, payloadOf(mDepth), Asm::RAX);
+        mTypes[mDepth++] = value.getType();
+    }
+
+    void Translator::input(std::uint8_t slot)
+    {
+        a.loadValue(Asm::XMM0, Inputs, typeOf(slot));
+        a.storeValue(Stack, typeOf(mDepth), Asm::XMM0);
+        mTypes[mDepth++] = Unknown;
+    }
+
+    // Field by field : a 16 bytes load of a value just written by two smaller stores can't be forwarded from them
+    void Translator::copyValue(Asm::Register to, std::int32_t toOffset, Asm::Register from, std::int32_t fromOffset, int type)
+    {
+        if (type == Unknown)
+        {
+            a.load32(Asm::RAX, from, fromOffset);
+            a.store32(to, toOffset, Asm::RAX);
+        }
+        else
+        {
+            a.store32Immediate(to, toOffset, type);
+        }
+        a.load(Asm::RAX, from, fromOffset + 8);
+        a.store(to, toOffset + 8, Asm::RAX);
+    }
+
+    void Translator::getLocal(std::uint8_t slot)
+    {
+        copyValue(Stack, typeOf(mDepth), Stack, typeOf(slot), mTypes[slot]);
+        mTypes[mDepth] = mTypes[slot];
+        mDepth++;
+    }
+
+    void Translator::setLocal(std::uint8_t slot)
+    {
+        copyValue(Stack, typeOf(slot), Stack, typeOf(mDepth - 1), mTypes[mDepth - 1]);
+        mTypes[slot] = mTypes[mDepth - 1];
+    }
+
+    void Translator::getGlobal(std::uint8_t index)
+    {
+        copyValue(Stack, typeOf(mDepth), Globals, typeOf(index), Unknown);
+        mTypes[mDepth++] = Unknown;
+    }
+
+    // Objects are refused by the interpreter
+    void Translator::setGlobal(std::uint8_t index)
+    {
+        std::size_t slot = mDepth - 1;
+        if (mTypes[slot] == Value::Object)
+        {
+            a.jump(deopt());
+            return;
+        }
+        if (mTypes[slot] == Unknown)
+        {
+            a.compare32Immediate(Stack, typeOf(slot), Value::Object);
+            a.jump(Asm::Equal, deopt());
+        }
+        copyValue(Globals, typeOf(index), Stack, typeOf(slot), mTypes[slot]);
+    }
+
+    void Translator::loadNumber(Asm::Xmm destination, std::size_t slot)
+    {
+        switch (mTypes[slot])
+        {
+            case Value::Number:
+                a.loadDouble(destination, Stack, payloadOf(slot));
+                break;
+            case Value::Integer:
+                a.convertInteger(destination, Stack, payloadOf(slot));
+                break;
+            default:
+            {
+                Asm::Label integer = a.newLabel();
+                Asm::Label loaded = a.newLabel();
+                a.compare32Immediate(Stack, typeOf(slot), Value::Number);
+                a.jump(Asm::NotEqual, integer);
+                a.loadDouble(destination, Stack, payloadOf(slot));
+                a.jump(loaded);
+                a.bind(integer);
+                a.compare32Immediate(Stack, typeOf(slot), Value::Integer);
+                a.jump(Asm::NotEqual, deopt());
+                a.convertInteger(destination, Stack, payloadOf(slot));
+                a.bind(loaded);
+                break;
+            }
+        }
+    }
+
+    void Translator::storeBool(std::size_t slot)
+    {
+        a.zeroExtendByte(Asm::RAX);
+        a.store32Immediate(Stack, typeOf(slot), Value::Bool);
+        a.store(Stack, payloadOf(slot), Asm::RAX);
+        mTypes[slot] = Value::Bool;
+    }
+
+    // Same as ARITHMETIC_OP : two integers stay integers unless the result overflows (or the division isn't exact),
+    // everything else is done on doubles
+    void Translator::arithmetic(std::uint8_t instruction)
+    {
+        std::size_t left = mDepth - 2;
+        std::size_t right = mDepth - 1;
+        int leftType = mTypes[left];
+        int rightType = mTypes[right];
+        mDepth--;
+
+        if (!maybeNumber(leftType) || !maybeNumber(rightType))
+        {
+            // Strings or a runtime error
+            a.jump(deopt());
+            mTypes[left] = Unknown;
+            return;
+        }
+
+        Asm::Label doubles = a.newLabel();
+        Asm::Label done = a.newLabel();
+        if (maybeInteger(leftType) && maybeInteger(rightType))
+        {
+            if (leftType == Unknown)
+            {
+                a.compare32Immediate(Stack, typeOf(left), Value::Integer);
+                a.jump(Asm::NotEqual, doubles);
+            }
+            if (rightType == Unknown)
+            {
+                a.compare32Immediate(Stack, typeOf(right), Value::Integer);
+                a.jump(Asm::NotEqual, doubles);
+            }
+
+            a.load(Asm::RAX, Stack, payloadOf(left));
+            a.load(Asm::RCX, Stack, payloadOf(right));
+            switch (instruction)
+            {
+                case Chunk::Op_Add:
+                    a.alu(Asm::Alu_Add, Asm::RAX, Asm::RCX);
+                    a.jump(Asm::Overflow, doubles);
+                    break;
+                case Chunk::Op_Substract:
+                    a.alu(Asm::Alu_Substract, Asm::RAX, Asm::RCX);
+                    a.jump(Asm::Overflow, doubles);
+                    break;
+                case Chunk::Op_Multiply:
+                    a.imul(Asm::RAX, Asm::RCX);
+                    a.jump(Asm::Overflow, doubles);
+                    break;
+                case Chunk::Op_Divide:
+                {
+                    // Exact divisions only, idiv faults on a zero divisor and on INT64_MIN / -1
+                    Asm::Label divide = a.newLabel();
+                    Asm::Label quotient = a.newLabel();
+                    a.alu(Asm::Alu_Or, Asm::RCX, Asm::RCX);
+                    a.jump(Asm::Equal, doubles);
+                    a.compareImmediate(Asm::RCX, -1);
+                    a.jump(Asm::NotEqual, divide);
+                    a.neg(Asm::RAX);
+                    a.jump(Asm::Overflow, doubles);
+                    a.jump(quotient);
+                    a.bind(divide);
+                    a.cqo();
+                    a.idiv(Asm::RCX);
+                    a.alu(Asm::Alu_Or, Asm::RDX, Asm::RDX);
+                    a.jump(Asm::NotEqual, doubles);
+                    a.bind(quotient);
+                    break;
+                }
+            }
+            a.store32Immediate(Stack, typeOf(left), Value::Integer);
+            a.store(Stack, payloadOf(left), Asm::RAX);
+            a.jump(done);
+        }
+
+        static const Asm::SseOperation operations[] = { Asm::Sse_Add, Asm::Sse_Substract, Asm::Sse_Multiply, Asm::Sse_Divide };
+        a.bind(doubles);
+        loadNumber(Asm::XMM0, left);
+        loadNumber(Asm::XMM1, right);
+        a.sse(operations[instruction - Chunk::Op_Add], Asm::XMM0, Asm::XMM1);
+        a.store32Immediate(Stack, typeOf(left), Value::Number);
+        a.storeDouble(Stack, payloadOf(left), Asm::XMM0);
+        a.bind(done);
+
+        // Integers give an integer or a double after an overflow
+        mTypes[left] = leftType == Value::Number || rightType == Value::Number ? Value::Number : Unknown;
+    }
+
+    // Same as COMPARISON_OP, NaN compares false like in C++ : ucomisd sets CF, ZF and PF on unordered operands
+    void Translator::comparison(std::uint8_t instruction)
+    {
+        std::size_t left = mDepth - 2;
+        std::size_t right = mDepth - 1;
+        int leftType = mTypes[left];
+        int rightType = mTypes[right];
+        mDepth--;
+
+        if (!maybeNumber(leftType) || !maybeNumber(rightType))
+        {
+            a.jump(deopt());
+            mTypes[left] = Value::Bool;
+            return;
+        }
+
+        Asm::Condition integerConditions[] = { Asm::Greater, Asm::GreaterEqual, Asm::Less, Asm::LessEqual };
+        Asm::Condition integerCondition = integerConditions[instruction - Chunk::Op_Greater];
+
+        Asm::Label doubles = a.newLabel();
+        Asm::Label done = a.newLabel();
+        if (maybeInteger(leftType) && maybeInteger(rightType))
+        {
+            if (leftType == Unknown)
+            {
+                a.compare32Immediate(Stack, typeOf(left), Value::Integer);
+                a.jump(Asm::NotEqual, doubles);
+            }
+            if (rightType == Unknown)
+            {
+                a.compare32Immediate(Stack, typeOf(right), Value::Integer);
+                a.jump(Asm::NotEqual, doubles);
+            }
+            a.load(Asm::RAX, Stack, payloadOf(left));
+            a.compare(Asm::RAX, Stack, payloadOf(right));
+            a.setByte(integerCondition, Asm::RAX);
+            a.jump(done);
+        }
+
+        a.bind(doubles);
+        loadNumber(Asm::XMM0, left);
+        loadNumber(Asm::XMM1, right);
+        // a < b is b > a : only 'above' conditions are false on unordered operands
+        bool swapped = instruction == Chunk::Op_Less || instruction == Chunk::Op_LessEqual;
+        a.ucomisd(swapped ? Asm::XMM1 : Asm::XMM0, swapped ? Asm::XMM0 : Asm::XMM1);
+        bool strict = instruction == Chunk::Op_Greater || instruction == Chunk::Op_Less;
+        a.setByte(strict ? Asm::Above : Asm::AboveEqual, Asm::RAX);
+        if (leftType != Value::Number || rightType != Value::Number)
+        {
+            // Mixed operands : ZF is set when equal or unordered
+            a.jump(Asm::NotEqual, done);
+            a.lea(Asm::RDI, Stack, typeOf(left));
+            a.movImmediate(Asm::RSI, instruction);
+            a.movImmediate(Asm::RAX, (std::uint64_t)&compareExactly);
+            a.call(Asm::RAX);
+        }
+        a.bind(done);
+
+        storeBool(left);
+    }
+
+    // Value::isEquals : integers and doubles are equal when the double is exactly the integer
+    void Translator::mixedEquality(std::size_t doubleSlot, std::size_t integerSlot)
+    {
+        a.loadDouble(Asm::XMM0, Stack, payloadOf(doubleSlot));
+        a.truncateDouble(Asm::RCX, Asm::XMM0);
+        a.convertInteger(Asm::XMM1, Asm::RCX);
+        a.ucomisd(Asm::XMM0, Asm::XMM1);
+        a.setByte(Asm::Equal, Asm::RAX);
+        a.setByte(Asm::NotParity, Asm::RDX);
+        a.alu8(Asm::Alu_And, Asm::RAX, Asm::RDX);
+        a.compare(Asm::RCX, Stack, payloadOf(integerSlot));
+        a.setByte(Asm::Equal, Asm::RDX);
+        a.alu8(Asm::Alu_And, Asm::RAX, Asm::RDX);
+    }
+
+    // Strings go back to the interpreter, every other pair of types is compared here
+    void Translator::equality(bool negated)
+    {
+        std::size_t left = mDepth - 2;
+        std::size_t right = mDepth - 1;
+        int leftType = mTypes[left];
+        int rightType = mTypes[right];
+        mDepth--;
+
+        Asm::Label done = a.newLabel();
+        if (leftType == Value::Number && rightType == Value::Number)
+        {
+            a.loadDouble(Asm::XMM0, Stack, payloadOf(left));
+            a.loadDouble(Asm::XMM1, Stack, payloadOf(right));
+            a.ucomisd(Asm::XMM0, Asm::XMM1);
+            a.setByte(Asm::Equal, Asm::RAX);
+            a.setByte(Asm::NotParity, Asm::RCX);
+            a.alu8(Asm::Alu_And, Asm::RAX, Asm::RCX);
+        }
+        else if (leftType == Value::Integer && rightType == Value::Integer)
+        {
+            a.load(Asm::RAX, Stack, payloadOf(left));
+            a.compare(Asm::RAX, Stack, payloadOf(right));
+            a.setByte(Asm::Equal, Asm::RAX);
+        }
+        else
+        {
+            Asm::Label mixed = a.newLabel();
+            Asm::Label notDouble = a.newLabel();
+            Asm::Label notInteger = a.newLabel();
+            Asm::Label notBool = a.newLabel();
+            Asm::Label mixedInteger = a.newLabel();
+            Asm::Label different = a.newLabel();
+
+            a.load32(Asm::RAX, Stack, typeOf(left));
+            a.load32(Asm::RCX, Stack, typeOf(right));
+            a.compare32(Asm::RAX, Asm::RCX);
+            a.jump(Asm::NotEqual, mixed);
+
+            a.compare32Immediate(Asm::RAX, Value::Number);
+            a.jump(Asm::NotEqual, notDouble);
+            a.loadDouble(Asm::XMM0, Stack, payloadOf(left));
+            a.loadDouble(Asm::XMM1, Stack, payloadOf(right));
+            a.ucomisd(Asm::XMM0, Asm::XMM1);
+            a.setByte(Asm::Equal, Asm::RAX);
+            a.setByte(Asm::NotParity, Asm::RCX);
+            a.alu8(Asm::Alu_And, Asm::RAX, Asm::RCX);
+            a.jump(done);
+
+            a.bind(notDouble);
+            a.compare32Immediate(Asm::RAX, Value::Integer);
+            a.jump(Asm::NotEqual, notInteger);
+            a.load(Asm::RAX, Stack, payloadOf(left));
+            a.compare(Asm::RAX, Stack, payloadOf(right));
+            a.setByte(Asm::Equal, Asm::RAX);
+            a.jump(done);
+
+            a.bind(notInteger);
+            a.compare32Immediate(Asm::RAX, Value::Bool);
+            a.jump(Asm::NotEqual, notBool);
+            a.loadByte(Asm::RAX, Stack, payloadOf(left));
+            a.loadByte(Asm::RCX, Stack, payloadOf(right));
+            a.compare32(Asm::RAX, Asm::RCX);
+            a.setByte(Asm::Equal, Asm::RAX);
+            a.jump(done);
+
+            // Two nulls are equal, two objects are compared by the interpreter
+            a.bind(notBool);
+            a.compare32Immediate(Asm::RAX, Value::Null);
+            a.jump(Asm::NotEqual, deopt());
+            a.movByteImmediate(Asm::RAX, 1);
+            a.jump(done);
+
+            a.bind(mixed);
+            a.compare32Immediate(Asm::RAX, Value::Number);
+            a.jump(Asm::NotEqual, mixedInteger);
+            a.compare32Immediate(Asm::RCX, Value::Integer);
+            a.jump(Asm::NotEqual, different);
+            mixedEquality(left, right);
+            a.jump(done);
+
+            a.bind(mixedInteger);
+            a.compare32Immediate(Asm::RAX, Value::Integer);
+            a.jump(Asm::NotEqual, different);
+            a.compare32Immediate(Asm::RCX, Value::Number);
+            a.jump(Asm::NotEqual, different);
+            mixedEquality(right, left);
+            a.jump(done);
+
+            a.bind(different);
+            a.movByteImmediate(Asm::RAX, 0);
+        }
+        a.bind(done);
+
+        if (negated)
+        {
+            a.xor8Immediate(Asm::RAX, 1);
+        }
+        storeBool(left);
+    }
+
+    // Value::isFalsey : only null and false
+    void Translator::logicalNot()
+    {
+        std::size_t slot = mDepth - 1;
+        switch (mTypes[slot])
+        {
+            case Value::Bool:
+                a.loadByte(Asm::RAX, Stack, payloadOf(slot));
+                a.xor8Immediate(Asm::RAX, 1);
+                break;
+            case Value::Null:
+                a.movByteImmediate(Asm::RAX, 1);
+                break;
+            case Unknown:
+            {
+                Asm::Label notBool = a.newLabel();
+                Asm::Label done = a.newLabel();
+                a.load32(Asm::RAX, Stack, typeOf(slot));
+                a.compare32Immediate(Asm::RAX, Value::Bool);
+                a.jump(Asm::NotEqual, notBool);
+                a.loadByte(Asm::RAX, Stack, payloadOf(slot));
+                a.xor8Immediate(Asm::RAX, 1);
+                a.jump(done);
+                a.bind(notBool);
+                a.compare32Immediate(Asm::RAX, Value::Null);
+                a.setByte(Asm::Equal, Asm::RAX);
+                a.bind(done);
+                break;
+            }
+            default:
+                a.movByteImmediate(Asm::RAX, 0);
+                break;
+        }
+        storeBool(slot);
+    }
+
+    // INT64_MIN can't be negated as an integer, the interpreter makes it a double
+    void Translator::negate()
+    {
+        std::size_t slot = mDepth - 1;
+        int type = mTypes[slot];
+        if (!maybeNumber(type))
+        {
+            a.jump(deopt());
+            return;
+        }
+
+        Asm::Label integer = a.newLabel();
+        Asm::Label done = a.newLabel();
+        if (type == Unknown)
+        {
+            a.compare32Immediate(Stack, typeOf(slot), Value::Number);
+            a.jump(Asm::NotEqual, integer);
+        }
+        if (type != Value::Integer)
+        {
+            a.load(Asm::RAX, Stack, payloadOf(slot));
+            a.flipSign(Asm::RAX);
+            a.store(Stack, payloadOf(slot), Asm::RAX);
+            a.jump(done);
+        }
+        a.bind(integer);
+        if (type != Value::Number)
+        {
+            if (type == Unknown)
+            {
+                a.compare32Immediate(Stack, typeOf(slot), Value::Integer);
+                a.jump(Asm::NotEqual, deopt());
+            }
+            a.load(Asm::RAX, Stack, payloadOf(slot));
+            a.neg(Asm::RAX);
+            a.jump(Asm::Overflow, deopt());
+            a.store(Stack, payloadOf(slot), Asm::RAX);
+        }
+        a.bind(done);
+    }
+
+    // thunk(function, arguments, result) : the result replaces the first argument, the thunk reads every argument first
+    // A thunk failing has not called the function, the interpreter calls it again to report the error
+    void Translator::callNative(const ObjNative* native, std::uint8_t argumentCount)
+    {
+        std::size_t first = mDepth - argumentCount;
+        a.movImmediate(Asm::RDI, (std::uint64_t)native->function);
+        a.lea(Asm::RSI, Stack, typeOf(first));
+        a.lea(Asm::RDX, Stack, typeOf(first));
+        a.movImmediate(Asm::RAX, (std::uint64_t)native->thunk);
+        a.call(Asm::RAX);
+        a.test8(Asm::RAX);
+        a.jump(Asm::Equal, deopt());
+
+        mDepth = first + 1;
+        mTypes[first] = Unknown;
+    }
+}
+
+JitCode::Exit JitCode::run(Value* stack, const Value* inputs, Value* globals) const
+{
+    typedef std::uint64_t (*Function)(Value* stack, const Value* inputs, Value* globals);
+    std::uint64_t code = ((Function)memory)(stack, inputs, globals);
+    return { (std::size_t)(code & 0xFFFFFFFF), (std::size_t)(code >> 32) };
+}
+
+Jit::Jit()
+    : mEntries(nullptr)
+    , mCount(0)
+    , mCapacity(0)
+    , mThreshold(JIT_DEFAULT_THRESHOLD)
+{
+}
+
+Jit::~Jit()
+{
+    clear();
+    MEMORY_FREE_ARRAY(Entry, mEntries, mCapacity);
+}
+
+void Jit::setThreshold(std::size_t executions)
+{
+    mThreshold = executions;
+}
+
+std::size_t Jit::getThreshold() const
+{
+    return mThreshold;
+}
+
+const JitCode* Jit::enter(const Chunk& chunk)
+{
+    Entry* entry = findEntry(&chunk);
+    if (entry->id != chunk.getVerifiedId())
+    {
+        freeCode(&entry->code);
+        entry->id = chunk.getVerifiedId();
+        entry->executions = 0;
+        entry->translated = false;
+    }
+
+    if (!entry->translated)
+    {
+        if (entry->executions < mThreshold)
+        {
+            entry->executions++;
+            return nullptr;
+        }
+        entry->translated = true;
+        if (chunk.size() < JIT_MIN_CHUNK_SIZE || !translate(chunk, &entry->code))
+        {
+            freeCode(&entry->code);
+        }
+    }
+    return entry->code.memory != nullptr ? &entry->code : nullptr;
+}
+
+void Jit::clear()
+{
+    for (std::size_t i = 0; i < mCapacity; i++)
+    {
+        if (mEntries[i].chunk != nullptr)
+        {
+            freeCode(&mEntries[i].code);
+            mEntries[i].chunk = nullptr;
+        }
+    }
+    mCount = 0;
+}
+
+// Open addressing on the address of the chunk, the table is only emptied as a whole
+Jit::Entry* Jit::findEntry(const Chunk* chunk)
+{
+    if (mCount + 1 > mCapacity * 3 / 4)
+    {
+        if (mCount >= JIT_MAX_CHUNKS)
+        {
+            clear();
+        }
+        else
+        {
+            std::size_t oldCapacity = mCapacity;
+            Entry* oldEntries = mEntries;
+            mCapacity = MEMORY_GROW_CAPACITY(mCapacity);
+            mEntries = MEMORY_ALLOCATE(Entry, mCapacity);
+            for (std::size_t i = 0; i < mCapacity; i++)
+            {
+                mEntries[i].chunk = nullptr;
+            }
+            // The chunks of the entries may be gone already, only their addresses are used
+            for (std::size_t i = 0; i < oldCapacity; i++)
+            {
+                if (oldEntries[i].chunk != nullptr)
+                {
+                    std::size_t index = slotOf(oldEntries[i].chunk);
+                    while (mEntries[index].chunk != nullptr)
+                    {
+                        index = (index + 1) & (mCapacity - 1);
+                    }
+                    mEntries[index] = oldEntries[i];
+                }
+            }
+            MEMORY_FREE_ARRAY(Entry, oldEntries, oldCapacity);
+        }
+    }
+
+    std::size_t index = slotOf(chunk);
+    for (;;)
+    {
+        Entry* entry = &mEntries[index];
+        if (entry->chunk == chunk)
+        {
+            return entry;
+        }
+        if (entry->chunk == nullptr)
+        {
+            entry->chunk = chunk;
+            entry->id = chunk->getVerifiedId();
+            entry->executions = 0;
+            entry->translated = false;
+            entry->code = { nullptr, 0 };
+            mCount++;
+            return entry;
+        }
+        index = (index + 1) & (mCapacity - 1);
+    }
+}
+
+std::size_t Jit::slotOf(const Chunk* chunk) const
+{
+    return ((std::uintptr_t)chunk >> 4) * 0x9E3779B97F4A7C15ull >> 32 & (mCapacity - 1);
+}
+
+// The code is written in writable pages which are then made executable, never both at the same time (W^X)
+bool Jit::translate(const Chunk& chunk, JitCode* code)
+{
+    mAssembler.clear();
+    Translator translator(mAssembler, chunk);
+    if (!translator.translate())
+    {
+        return false;
+    }
+
+    std::size_t pageSize = (std::size_t)sysconf(_SC_PAGESIZE);
+    std::size_t size = (mAssembler.size() + pageSize - 1) / pageSize * pageSize;
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+    {
+        return false;
+    }
+    memcpy(memory, mAssembler.code(), mAssembler.size());
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0)
+    {
+        munmap(memory, size);
+        return false;
+    }
+
+    code->memory = memory;
+    code->size = size;
+    return true;
+}
+
+void Jit::freeCode(JitCode* code)
+{
+    if (code->memory != nullptr)
+    {
+        munmap(code->memory, code->size);
+        code->memory = nullptr;
+        code->size = 0;
+    }
+}
+
+#endif // BLISSX_JIT
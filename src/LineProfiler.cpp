@@ -0,0 +1,169 @@
+#include "LineProfiler.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <csignal>
+    #include <sys/time.h>
+    #define LINEPROFILER_TIMER
+#endif
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "The timer signal handler needs a lock-free atomic");
+
+std::atomic<int> LineProfiler::sTimerTicks(0);
+
+LineProfiler::LineProfiler(std::uint32_t interval)
+    : mInterval(interval)
+    , mCountdown(interval)
+    , mSampleCount(0)
+    , mCount(0)
+    , mCapacity(0)
+    , mEntries(nullptr)
+{
+}
+
+LineProfiler::~LineProfiler()
+{
+    clear();
+    MEMORY_FREE_ARRAY(Entry, mEntries, mCapacity);
+}
+
+bool LineProfiler::startTimer(std::uint32_t periodMicroseconds)
+{
+#ifdef LINEPROFILER_TIMER
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = &LineProfiler::onTimer;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, nullptr) != 0) return false;
+
+    struct itimerval timer;
+    timer.it_interval.tv_sec = periodMicroseconds / 1000000;
+    timer.it_interval.tv_usec = periodMicroseconds % 1000000;
+    timer.it_value = timer.it_interval;
+    return setitimer(ITIMER_PROF, &timer, nullptr) == 0;
+#else
+    (void)periodMicroseconds;
+    return false;
+#endif
+}
+
+void LineProfiler::stopTimer()
+{
+#ifdef LINEPROFILER_TIMER
+    struct itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, nullptr);
+#endif
+    sTimerTicks.store(0, std::memory_order_relaxed);
+}
+
+void LineProfiler::onTimer(int)
+{
+    sTimerTicks.store(1, std::memory_order_relaxed);
+}
+
+void LineProfiler::sample(const Chunk& chunk, std::size_t offset)
+{
+    const char* name = chunk.getName();
+    int nameLength = (int)strlen(name);
+    int line = chunk.getLine(offset);
+    mSampleCount++;
+
+    if (mCapacity < (mCount + 1) * 2)
+    {
+        grow();
+    }
+
+    std::size_t index = hash(name, nameLength, line) & (mCapacity - 1);
+    for (;;)
+    {
+        Entry& entry = mEntries[index];
+        if (entry.name == nullptr)
+        {
+            entry.name = MEMORY_ALLOCATE(char, nameLength + 1);
+            memcpy(entry.name, name, nameLength + 1);
+            entry.nameLength = nameLength;
+            entry.line = line;
+            entry.count = 1;
+            mCount++;
+            return;
+        }
+        if (entry.line == line && entry.nameLength == nameLength && memcmp(entry.name, name, nameLength) == 0)
+        {
+            entry.count++;
+            return;
+        }
+        index = (index + 1) & (mCapacity - 1);
+    }
+}
+
+void LineProfiler::clear()
+{
+    for (std::size_t i = 0; i < mCapacity; i++)
+    {
+        if (mEntries[i].name != nullptr)
+        {
+            MEMORY_FREE_ARRAY(char, mEntries[i].name, mEntries[i].nameLength + 1);
+            mEntries[i].name = nullptr;
+        }
+    }
+    mCount = 0;
+    mSampleCount = 0;
+    mCountdown = mInterval;
+}
+
+std::uint64_t LineProfiler::getSampleCount() const
+{
+    return mSampleCount;
+}
+
+void LineProfiler::writeFolded(OutputSink& sink) const
+{
+    for (std::size_t i = 0; i < mCapacity; i++)
+    {
+        const Entry& entry = mEntries[i];
+        if (entry.name == nullptr) continue;
+        sink.print("%s;%s:%d %llu\n", entry.name, entry.name, entry.line, (unsigned long long)entry.count);
+    }
+}
+
+std::uint32_t LineProfiler::hash(const char* name, int nameLength, int line)
+{
+    // FNV-1a
+    std::uint32_t hash = 2166136261u;
+    for (int i = 0; i < nameLength; i++)
+    {
+        hash ^= (std::uint8_t)name[i];
+        hash *= 16777619u;
+    }
+    hash ^= (std::uint32_t)line;
+    hash *= 16777619u;
+    return hash;
+}
+
+void LineProfiler::grow()
+{
+    std::size_t oldCapacity = mCapacity;
+    Entry* oldEntries = mEntries;
+
+    mCapacity = MEMORY_GROW_CAPACITY(mCapacity);
+    mEntries = MEMORY_ALLOCATE(Entry, mCapacity);
+    for (std::size_t i = 0; i < mCapacity; i++)
+    {
+        mEntries[i].name = nullptr;
+    }
+
+    for (std::size_t i = 0; i < oldCapacity; i++)
+    {
+        const Entry& entry = oldEntries[i];
+        if (entry.name == nullptr) continue;
+        std::size_t index = hash(entry.name, entry.nameLength, entry.line) & (mCapacity - 1);
+        while (mEntries[index].name != nullptr)
+        {
+            index = (index + 1) & (mCapacity - 1);
+        }
+        mEntries[index] = entry;
+    }
+
+    MEMORY_FREE_ARRAY(Entry, oldEntries, oldCapacity);
+}
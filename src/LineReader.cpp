@@ -0,0 +1,79 @@
+#include "LineReader.hpp"
+
+#include "Memory.hpp"
+
+#include <cstring>
+
+LineReader::LineReader(FILE* file, std::size_t blockSize)
+    : mFile(file)
+    , mBlockSize(blockSize)
+    , mBuffer(nullptr)
+    , mCapacity(0)
+    , mBegin(0)
+    , mEnd(0)
+    , mEndOfFile(false)
+{
+}
+
+LineReader::~LineReader()
+{
+    MEMORY_FREE_ARRAY(char, mBuffer, mCapacity);
+}
+
+const char* LineReader::next()
+{
+    for (;;)
+    {
+        char* line = mBuffer + mBegin;
+        char* newLine = mBegin < mEnd ? (char*)memchr(line, '\n', mEnd - mBegin) : nullptr;
+        if (newLine != nullptr)
+        {
+            *newLine = '\0';
+            mBegin = (std::size_t)(newLine - mBuffer) + 1;
+            return line;
+        }
+
+        if (mEndOfFile)
+        {
+            if (mBegin == mEnd) return nullptr;
+            // There is always room for the terminator (see fill)
+            mBuffer[mEnd] = '\0';
+            mBegin = mEnd;
+            return line;
+        }
+
+        fill();
+    }
+}
+
+bool LineReader::hasError() const
+{
+    return ferror(mFile) != 0;
+}
+
+void LineReader::fill()
+{
+    std::size_t pending = mEnd - mBegin;
+    if (mBegin > 0)
+    {
+        memmove(mBuffer, mBuffer + mBegin, pending);
+        mBegin = 0;
+        mEnd = pending;
+    }
+
+    // A whole block after the incomplete line, plus the terminator
+    if (mCapacity < pending + mBlockSize + 1)
+    {
+        std::size_t capacity = MEMORY_GROW_CAPACITY(mCapacity);
+        if (capacity < pending + mBlockSize + 1) capacity = pending + mBlockSize + 1;
+        mBuffer = MEMORY_GROW_ARRAY(mBuffer, char, mCapacity, capacity);
+        mCapacity = capacity;
+    }
+
+    std::size_t read = fread(mBuffer + mEnd, 1, mCapacity - 1 - mEnd, mFile);
+    mEnd += read;
+    if (read == 0)
+    {
+        mEndOfFile = true;
+    }
+}
@@ -0,0 +1,131 @@
+#include "OpCodeProfile.hpp"
+
+#include "Debug.hpp"
+
+#include <algorithm>
+
+OpCodeProfile::OpCodeProfile()
+{
+    reset();
+}
+
+void OpCodeProfile::reset()
+{
+    memset(mCounts, 0, sizeof(mCounts));
+    memset(mPairs, 0, sizeof(mPairs));
+    memset(mTicks, 0, sizeof(mTicks));
+    memset(mSamples, 0, sizeof(mSamples));
+    mPrevious = Chunk::Op_Count;
+    mSampled = 0;
+    mSampling = false;
+    mCountdown = BLISSX_PROFILE_SAMPLE_INTERVAL;
+    mSampleStart = 0;
+}
+
+void OpCodeProfile::beginRun()
+{
+    // Pairs don't span runs
+    mPrevious = Chunk::Op_Count;
+    mSampling = false;
+}
+
+void OpCodeProfile::endRun()
+{
+    if (mSampling)
+    {
+        mTicks[mSampled] += now() - mSampleStart;
+        mSamples[mSampled]++;
+        mSampling = false;
+    }
+}
+
+std::uint64_t OpCodeProfile::getCount(std::uint8_t instruction) const
+{
+    return mCounts[instruction];
+}
+
+std::uint64_t OpCodeProfile::getPairCount(std::uint8_t first, std::uint8_t second) const
+{
+    return mPairs[first][second];
+}
+
+double OpCodeProfile::getAverageTicks(std::uint8_t instruction) const
+{
+    if (mSamples[instruction] == 0) return 0.0;
+    return (double)mTicks[instruction] / (double)mSamples[instruction];
+}
+
+const char* OpCodeProfile::getTickUnit()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return "cycles";
+#else
+    return "ns";
+#endif
+}
+
+void OpCodeProfile::report(OutputSink& sink, std::size_t maxPairs) const
+{
+    std::uint8_t opcodes[Chunk::Op_Count];
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < Chunk::Op_Count; i++)
+    {
+        opcodes[i] = (std::uint8_t)i;
+        total += mCounts[i];
+    }
+    std::stable_sort(opcodes, opcodes + Chunk::Op_Count, [this](std::uint8_t a, std::uint8_t b) { return mCounts[a] > mCounts[b]; });
+
+    sink.print("== opcodes (%llu executed) ==\n", (unsigned long long)total);
+    sink.print("%-20s %14s %8s %14s\n", "opcode", "count", "%", getTickUnit());
+    for (std::size_t i = 0; i < Chunk::Op_Count && mCounts[opcodes[i]] != 0; i++)
+    {
+        std::uint8_t opcode = opcodes[i];
+        sink.print("%-20s %14llu %7.2f%% %14.1f\n", Debug::getOpCodeName(opcode), (unsigned long long)mCounts[opcode],
+            100.0 * (double)mCounts[opcode] / (double)total, getAverageTicks(opcode));
+    }
+
+    std::uint16_t pairs[Chunk::Op_Count * Chunk::Op_Count];
+    std::size_t pairCount = 0;
+    for (std::size_t i = 0; i < Chunk::Op_Count * Chunk::Op_Count; i++)
+    {
+        if (mPairs[i / Chunk::Op_Count][i % Chunk::Op_Count] != 0)
+        {
+            pairs[pairCount++] = (std::uint16_t)i;
+        }
+    }
+    auto pairCountOf = [this](std::uint16_t pair) { return mPairs[pair / Chunk::Op_Count][pair % Chunk::Op_Count]; };
+    std::stable_sort(pairs, pairs + pairCount, [&](std::uint16_t a, std::uint16_t b) { return pairCountOf(a) > pairCountOf(b); });
+
+    sink.print("== pairs ==\n");
+    for (std::size_t i = 0; i < pairCount && i < maxPairs; i++)
+    {
+        sink.print("%-20s %-20s %14llu\n", Debug::getOpCodeName(pairs[i] / Chunk::Op_Count), Debug::getOpCodeName(pairs[i] % Chunk::Op_Count),
+            (unsigned long long)pairCountOf(pairs[i]));
+    }
+}
+
+void OpCodeProfile::reportJson(OutputSink& sink) const
+{
+    sink.print("{\"unit\":\"%s\",\"sampleInterval\":%d,\"opcodes\":[", getTickUnit(), BLISSX_PROFILE_SAMPLE_INTERVAL);
+    bool first = true;
+    for (std::size_t i = 0; i < Chunk::Op_Count; i++)
+    {
+        if (mCounts[i] == 0) continue;
+        sink.print("%s{\"name\":\"%s\",\"count\":%llu,\"samples\":%llu,\"ticks\":%llu}", first ? "" : ",", Debug::getOpCodeName((std::uint8_t)i),
+            (unsigned long long)mCounts[i], (unsigned long long)mSamples[i], (unsigned long long)mTicks[i]);
+        first = false;
+    }
+    sink.write("],\"pairs\":[");
+    first = true;
+    for (std::size_t i = 0; i < Chunk::Op_Count; i++)
+    {
+        for (std::size_t j = 0; j < Chunk::Op_Count; j++)
+        {
+            if (mPairs[i][j] == 0) continue;
+            sink.print("%s{\"first\":\"%s\",\"second\":\"%s\",\"count\":%llu}", first ? "" : ",", Debug::getOpCodeName((std::uint8_t)i),
+                Debug::getOpCodeName((std::uint8_t)j), (unsigned long long)mPairs[i][j]);
+            first = false;
+        }
+    }
+    sink.write("]}\n");
+}
@@ -0,0 +1,141 @@
+#include "OutputSink.hpp"
+
+#include "Memory.hpp"
+
+#include <cstdarg>
+#include <charconv>
+
+OutputSink::~OutputSink()
+{
+}
+
+void OutputSink::flush()
+{
+}
+
+void OutputSink::write(const char* string)
+{
+    write(string, strlen(string));
+}
+
+void OutputSink::print(const char* format, ...)
+{
+    char buffer[256];
+
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    if (length < 0) return;
+    if ((std::size_t)length < sizeof(buffer))
+    {
+        write(buffer, (std::size_t)length);
+        return;
+    }
+
+    char* heapBuffer = MEMORY_ALLOCATE(char, length + 1);
+    va_start(args, format);
+    vsnprintf(heapBuffer, length + 1, format, args);
+    va_end(args);
+    write(heapBuffer, (std::size_t)length);
+    MEMORY_FREE_ARRAY(char, heapBuffer, length + 1);
+}
+
+void OutputSink::printNumber(double value)
+{
+    // The longest shortest double is 24 characters (e.g. -2.2250738585072014e-308)
+    char buffer[32];
+    std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general);
+    write(buffer, result.ptr - buffer);
+}
+
+void OutputSink::printInteger(std::int64_t value)
+{
+    char buffer[24];
+    std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    write(buffer, result.ptr - buffer);
+}
+
+OutputSink& OutputSink::getStandardOutput()
+{
+    static FileSink standardOutput(stdout);
+    return standardOutput;
+}
+
+FileSink::FileSink(FILE* file)
+    : mFile(file)
+{
+}
+
+void FileSink::write(const char* data, std::size_t size)
+{
+    fwrite(data, 1, size, mFile);
+}
+
+void FileSink::flush()
+{
+    fflush(mFile);
+}
+
+BufferedSink::BufferedSink(OutputSink* destination, std::size_t capacity)
+    : mDestination(destination)
+    , mBuffer(MEMORY_ALLOCATE(char, capacity))
+    , mSize(0)
+    , mCapacity(capacity)
+{
+}
+
+BufferedSink::~BufferedSink()
+{
+    // The destination is only used when there is something left, it may already be gone otherwise
+    if (mSize > 0)
+    {
+        flush();
+    }
+    MEMORY_FREE_ARRAY(char, mBuffer, mCapacity);
+}
+
+void BufferedSink::write(const char* data, std::size_t size)
+{
+    if (size > mCapacity - mSize)
+    {
+        drain();
+        if (size >= mCapacity)
+        {
+            mDestination->write(data, size);
+            return;
+        }
+    }
+    memcpy(mBuffer + mSize, data, size);
+    mSize += size;
+}
+
+void BufferedSink::flush()
+{
+    drain();
+    mDestination->flush();
+}
+
+void BufferedSink::setDestination(OutputSink* destination)
+{
+    if (mSize > 0)
+    {
+        flush();
+    }
+    mDestination = destination;
+}
+
+OutputSink* BufferedSink::getDestination() const
+{
+    return mDestination;
+}
+
+void BufferedSink::drain()
+{
+    if (mSize > 0)
+    {
+        mDestination->write(mBuffer, mSize);
+        mSize = 0;
+    }
+}
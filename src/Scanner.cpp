@@ -1,8 +1,112 @@
 #include "Scanner.hpp"
 
+#include <charconv>
 #include <utility>
 #include <cstring>
 
+// Blocks of 16 bytes in string literals (needs __builtin_ctz)
+#if defined(__SSE2__) && defined(__GNUC__)
+    #define SCANNER_SSE2
+    #include <emmintrin.h>
+#endif
+
+namespace
+{
+    // Length of the valid UTF-8 sequence starting with a non ASCII byte, 0 when invalid (overlong, surrogate, above
+    // U+10FFFF or truncated). Stops at the terminating '\0', which is never a continuation byte
+    int utf8Length(const unsigned char* c)
+    {
+        auto isContinuation = [](unsigned char byte) { return (byte & 0xC0) == 0x80; };
+        if (c[0] >= 0xC2 && c[0] <= 0xDF)
+        {
+            return isContinuation(c[1]) ? 2 : 0;
+        }
+        if (c[0] >= 0xE0 && c[0] <= 0xEF)
+        {
+            // Second byte range excluding overlongs (E0) and surrogates (ED)
+            unsigned char low = c[0] == 0xE0 ? 0xA0 : 0x80;
+            unsigned char high = c[0] == 0xED ? 0x9F : 0xBF;
+            return c[1] >= low && c[1] <= high && isContinuation(c[2]) ? 3 : 0;
+        }
+        if (c[0] >= 0xF0 && c[0] <= 0xF4)
+        {
+            // Second byte range excluding overlongs (F0) and code points above U+10FFFF (F4)
+            unsigned char low = c[0] == 0xF0 ? 0x90 : 0x80;
+            unsigned char high = c[0] == 0xF4 ? 0x8F : 0xBF;
+            return c[1] >= low && c[1] <= high && isContinuation(c[2]) && isContinuation(c[3]) ? 4 : 0;
+        }
+        return 0;
+    }
+
+    int utf8Size(std::uint32_t codePoint)
+    {
+        return codePoint < 0x80 ? 1 : codePoint < 0x800 ? 2 : codePoint < 0x10000 ? 3 : 4;
+    }
+
+    void encodeUtf8(std::uint32_t codePoint, char* destination)
+    {
+        switch (utf8Size(codePoint))
+        {
+            case 1:
+                destination[0] = (char)codePoint;
+                break;
+            case 2:
+                destination[0] = (char)(0xC0 | (codePoint >> 6));
+                destination[1] = (char)(0x80 | (codePoint & 0x3F));
+                break;
+            case 3:
+                destination[0] = (char)(0xE0 | (codePoint >> 12));
+                destination[1] = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+                destination[2] = (char)(0x80 | (codePoint & 0x3F));
+                break;
+            default:
+                destination[0] = (char)(0xF0 | (codePoint >> 18));
+                destination[1] = (char)(0x80 | ((codePoint >> 12) & 0x3F));
+                destination[2] = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+                destination[3] = (char)(0x80 | (codePoint & 0x3F));
+                break;
+        }
+    }
+
+    int hexadecimalDigit(char c)
+    {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    // Escape after a backslash : length of the escape without the backslash, 0 when invalid
+    // \u{0} and surrogates are refused, the value is always valid UTF-8 without '\0'
+    int parseEscape(const char* escape, std::uint32_t* codePoint)
+    {
+        switch (escape[0])
+        {
+            case 'n': *codePoint = '\n'; return 1;
+            case 't': *codePoint = '\t'; return 1;
+            case 'r': *codePoint = '\r'; return 1;
+            case '"': *codePoint = '"'; return 1;
+            case '\\': *codePoint = '\\'; return 1;
+            case 'u':
+            {
+                if (escape[1] != '{') return 0;
+                std::uint32_t value = 0;
+                int i = 2;
+                for (int digit; i < 8 && (digit = hexadecimalDigit(escape[i])) >= 0; i++)
+                {
+                    value = value * 16 + (std::uint32_t)digit;
+                }
+                if (i == 2 || escape[i] != '}') return 0;
+                if (value == 0 || value > 0x10FFFF || (value >= 0xD800 && value <= 0xDFFF)) return 0;
+                *codePoint = value;
+                return i + 1;
+            }
+            default:
+                return 0;
+        }
+    }
+}
+
 Token::Token()
 {
 }
@@ -12,20 +116,28 @@ Token::Token(Token::Type pType, const char* pStart, int pLength, int pLine)
     , start(pStart)
     , length(pLength)
     , line(pLine)
+    , integer(0)
+{
+}
+
+Scanner::Scanner()
+    : mStart(nullptr)
+    , mCurrent(nullptr)
+    , mEnd(nullptr)
+    , mLine(0)
 {
 }
 
-Scanner& Scanner::getInstance()
+Scanner::~Scanner()
 {
-    static Scanner instance;
-    return instance;
 }
 
-void Scanner::newSource(const char* source)
+void Scanner::newSource(const char* source, int line)
 {
     mStart = source;
     mCurrent = source;
-    mLine = 1;
+    mEnd = source + strlen(source);
+    mLine = line;
 }
 
 Token Scanner::scanToken()
@@ -63,45 +175,171 @@ Token Scanner::scanToken()
     return std::move(errorToken("Unexcepted character."));
 }
 
-Scanner::Scanner()
-    : mStart(nullptr)
-    , mCurrent(nullptr)
-    , mLine(0)
-{
-}
-
-Scanner::~Scanner()
+const char* Scanner::getTokenStart() const
 {
+    return mStart;
 }
 
 Token Scanner::string()
 {
-    while (peek() != '"' && !isAtEnd())
+    // One pass : finds the closing quote, validates the UTF-8 and the escapes, and measures the decoded value
+    // After an error the scan goes on to the closing quote, so the next token starts after the literal
+    const char* error = nullptr;
+    int removed = 0;
+    for (;;)
     {
-        if (peek() == '\n') mLine++;
-        advance();
+#ifdef SCANNER_SSE2
+        // Skips plain ASCII 16 bytes at a time, up to the first quote, backslash, newline or non ASCII byte
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i newLine = _mm_set1_epi8('\n');
+        while (mEnd - mCurrent >= 16)
+        {
+            __m128i block = _mm_loadu_si128((const __m128i*)mCurrent);
+            __m128i special = _mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash));
+            special = _mm_or_si128(special, _mm_cmpeq_epi8(block, newLine));
+            // Non ASCII bytes have their high bit set
+            int mask = _mm_movemask_epi8(_mm_or_si128(special, block));
+            if (mask != 0)
+            {
+                mCurrent += __builtin_ctz((unsigned int)mask);
+                break;
+            }
+            mCurrent += 16;
+        }
+#endif
+        char c = peek();
+        if (c == '"' || isAtEnd()) break;
+
+        if (c == '\n')
+        {
+            mLine++;
+            advance();
+        }
+        else if (c == '\\')
+        {
+            std::uint32_t codePoint = 0;
+            int length = parseEscape(mCurrent + 1, &codePoint);
+            if (length == 0)
+            {
+                if (error == nullptr) error = "Invalid escape sequence.";
+                advance();
+                continue;
+            }
+            removed += 1 + length - utf8Size(codePoint);
+            mCurrent += 1 + length;
+        }
+        else if ((unsigned char)c >= 0x80)
+        {
+            int length = utf8Length((const unsigned char*)mCurrent);
+            if (length == 0)
+            {
+                if (error == nullptr) error = "Invalid UTF-8 in string.";
+                advance();
+                continue;
+            }
+            mCurrent += length;
+        }
+        else
+        {
+            advance();
+        }
     }
 
     if (isAtEnd()) return std::move(errorToken("Unterminated string."));
 
     // The closing ".
     advance();
-    return std::move(makeToken(Token::Type::Token_String));
+    if (error != nullptr) return std::move(errorToken(error));
+
+    Token token = makeToken(Token::Type::Token_String);
+    token.decodedLength = token.length - 2 - removed;
+    return token;
+}
+
+void Scanner::decodeString(const Token& token, char* destination)
+{
+    const char* current = token.start + 1;
+    const char* end = token.start + token.length - 1;
+    // Copies the runs between escapes (memchr and memcpy work on blocks)
+    while (current < end)
+    {
+        const char* escape = (const char*)memchr(current, '\\', end - current);
+        if (escape == nullptr)
+        {
+            memcpy(destination, current, end - current);
+            return;
+        }
+        memcpy(destination, current, escape - current);
+        destination += escape - current;
+
+        std::uint32_t codePoint = 0;
+        int length = parseEscape(escape + 1, &codePoint);
+        encodeUtf8(codePoint, destination);
+        destination += utf8Size(codePoint);
+        current = escape + 1 + length;
+    }
 }
 
 Token Scanner::number()
 {
-    while (isDigit(peek())) advance();
+    // Accumulate the significant digits while scanning, the literal is then mantissa * 10^exponent
+    std::uint64_t mantissa = (std::uint64_t)(mStart[0] - '0');
+    int digits = (mantissa != 0) ? 1 : 0;
+    int exponent = 0;
+
+    while (isDigit(peek()))
+    {
+        char c = advance();
+        if (digits < 19) mantissa = mantissa * 10 + (c - '0');
+        if (mantissa != 0) digits++;
+    }
+
+    // Without fractional part, literals fitting in 64 bits are integers
+    if (!(peek() == '.' && isDigit(peekNext())) && digits <= 19 && mantissa <= (std::uint64_t)INT64_MAX)
+    {
+        Token token = makeToken(Token::Type::Token_Integer);
+        token.integer = (std::int64_t)mantissa;
+        return token;
+    }
 
     // Look for a fractional part
     if (peek() == '.' && isDigit(peekNext()))
     {
         // Consume the "."
         advance();
-        while (isDigit(peek())) advance();
+        while (isDigit(peek()))
+        {
+            char c = advance();
+            if (digits < 19) mantissa = mantissa * 10 + (c - '0');
+            if (mantissa != 0) digits++;
+            exponent--;
+        }
+    }
+
+    Token token = makeToken(Token::Type::Token_Number);
+    token.number = parseNumber(mantissa, digits, exponent);
+    return token;
+}
+
+double Scanner::parseNumber(std::uint64_t mantissa, int digits, int exponent) const
+{
+    // Exact powers of ten representable as double
+    static const double powersOfTen[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    // Fast path (Clinger) : both operands are exact, so the single IEEE division is correctly rounded
+    if (digits <= 19 && mantissa <= (std::uint64_t(1) << 53) && exponent >= -22)
+    {
+        return (double)mantissa / powersOfTen[-exponent];
     }
 
-    return std::move(makeToken(Token::Type::Token_Number));
+    // Slow path : exact, locale independent and correctly rounded like strtod in the "C" locale
+    double value = 0.0;
+    std::from_chars(mStart, mCurrent, value);
+    return value;
 }
 
 Token Scanner::identifier()
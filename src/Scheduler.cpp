@@ -0,0 +1,272 @@
+#include "Scheduler.hpp"
+
+TaskGroup::TaskGroup(Callback callback, void* userData)
+    : mCallback(callback)
+    , mUserData(userData)
+    , mPending(0)
+{
+}
+
+void TaskGroup::wait()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDone.wait(lock, [this]() { return mPending.load() == 0; });
+}
+
+bool TaskGroup::isDone() const
+{
+    // Under the lock, as wait : a completion still notifying once the count reached 0 holds it
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mPending.load() == 0;
+}
+
+void TaskGroup::add(std::size_t count)
+{
+    mPending.fetch_add(count);
+}
+
+void TaskGroup::complete(std::size_t count)
+{
+    // Under the lock : once wait returns, the group may be destroyed and this must not touch it anymore
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mPending.fetch_sub(count) == count)
+    {
+        mDone.notify_all();
+    }
+}
+
+Scheduler::Worker::Worker()
+    : ranges(nullptr)
+    , head(0)
+    , count(0)
+    , capacity(0)
+    , random(0)
+{
+}
+
+Scheduler::Worker::~Worker()
+{
+    MEMORY_FREE_ARRAY(Range, ranges, capacity);
+}
+
+Scheduler::Scheduler(std::size_t workerCount)
+    : mWorkers(nullptr)
+    , mWorkerCount(workerCount)
+    , mNextWorker(0)
+    , mQueued(0)
+    , mSleeping(0)
+    , mStopping(false)
+{
+    if (mWorkerCount == 0)
+    {
+        mWorkerCount = std::thread::hardware_concurrency();
+    }
+    if (mWorkerCount == 0)
+    {
+        mWorkerCount = 1;
+    }
+
+    mWorkers = new Worker[mWorkerCount];
+    for (std::size_t i = 0; i < mWorkerCount; i++)
+    {
+        mWorkers[i].random = (std::uint32_t)i * 2654435761u + 1;
+    }
+    // Started once every worker exists, they steal from each other
+    for (std::size_t i = 0; i < mWorkerCount; i++)
+    {
+        mWorkers[i].thread = std::thread(&Scheduler::work, this, i);
+    }
+}
+
+Scheduler::~Scheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+        mStopping = true;
+    }
+    mWake.notify_all();
+
+    for (std::size_t i = 0; i < mWorkerCount; i++)
+    {
+        mWorkers[i].thread.join();
+    }
+    delete[] mWorkers;
+}
+
+void Scheduler::submit(ScriptTask* tasks, std::size_t count, TaskGroup& group)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    group.add(count);
+    // Round robin : concurrent submissions start on different workers
+    Worker& worker = mWorkers[mNextWorker.fetch_add(1, std::memory_order_relaxed) % mWorkerCount];
+    push(worker, Range{ tasks, count, &group });
+}
+
+void Scheduler::resetHeaps()
+{
+    for (std::size_t i = 0; i < mWorkerCount; i++)
+    {
+        mWorkers[i].virtualMachine.resetHeap();
+    }
+}
+
+void Scheduler::setJitEnabled(bool enabled)
+{
+    for (std::size_t i = 0; i < mWorkerCount; i++)
+    {
+        mWorkers[i].virtualMachine.setJitEnabled(enabled);
+    }
+}
+
+std::size_t Scheduler::getWorkerCount() const
+{
+    return mWorkerCount;
+}
+
+void Scheduler::work(std::size_t index)
+{
+    Worker& worker = mWorkers[index];
+    for (;;)
+    {
+        Range range;
+        if (!popNewest(worker, &range) && !steal(index, &range))
+        {
+            if (!sleep())
+            {
+                return;
+            }
+            continue;
+        }
+
+        // Halves are pushed back from the biggest, thieves take the oldest first and so get the biggest ones
+        while (range.count > SCHEDULER_GRAIN)
+        {
+            std::size_t half = range.count / 2;
+            push(worker, Range{ range.tasks + range.count - half, half, range.group });
+            range.count -= half;
+        }
+        run(worker, range);
+    }
+}
+
+void Scheduler::push(Worker& worker, const Range& range)
+{
+    // Counted first so it never goes below the number of ranges in the deques
+    mQueued.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.head + worker.count == worker.capacity)
+        {
+            if (worker.head > 0)
+            {
+                memmove(worker.ranges, worker.ranges + worker.head, worker.count * sizeof(Range));
+                worker.head = 0;
+            }
+            else
+            {
+                std::size_t capacity = MEMORY_GROW_CAPACITY(worker.capacity);
+                worker.ranges = MEMORY_GROW_ARRAY(worker.ranges, Range, worker.capacity, capacity);
+                worker.capacity = capacity;
+            }
+        }
+        worker.ranges[worker.head + worker.count] = range;
+        worker.count++;
+    }
+
+    // A sleeping worker increments mSleeping before reading mQueued, so either it sees this range or it is seen here
+    if (mSleeping.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+        mWake.notify_one();
+    }
+}
+
+bool Scheduler::popNewest(Worker& worker, Range* range)
+{
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.count == 0)
+    {
+        return false;
+    }
+
+    worker.count--;
+    *range = worker.ranges[worker.head + worker.count];
+    mQueued.fetch_sub(1);
+    return true;
+}
+
+bool Scheduler::popOldest(Worker& worker, Range* range)
+{
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.count == 0)
+    {
+        return false;
+    }
+
+    *range = worker.ranges[worker.head];
+    worker.head++;
+    worker.count--;
+    if (worker.count == 0)
+    {
+        worker.head = 0;
+    }
+    mQueued.fetch_sub(1);
+    return true;
+}
+
+bool Scheduler::steal(std::size_t thief, Range* range)
+{
+    if (mWorkerCount == 1 || mQueued.load() == 0)
+    {
+        return false;
+    }
+
+    // xorshift32, victims are visited from a random one so thieves don't all hit the same deque
+    std::uint32_t& random = mWorkers[thief].random;
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+
+    std::size_t first = random % mWorkerCount;
+    for (std::size_t i = 0; i < mWorkerCount; i++)
+    {
+        std::size_t victim = (first + i) % mWorkerCount;
+        if (victim != thief && popOldest(mWorkers[victim], range))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Scheduler::sleep()
+{
+    std::unique_lock<std::mutex> lock(mSleepMutex);
+    mSleeping.fetch_add(1);
+    while (mQueued.load() == 0 && !mStopping)
+    {
+        mWake.wait(lock);
+    }
+    mSleeping.fetch_sub(1);
+    // Every pending task runs before the workers stop
+    return mQueued.load() > 0 || !mStopping;
+}
+
+void Scheduler::run(Worker& worker, const Range& range)
+{
+    TaskGroup& group = *range.group;
+    for (std::size_t i = 0; i < range.count; i++)
+    {
+        ScriptTask& task = range.tasks[i];
+        task.status = worker.virtualMachine.execute(*task.chunk, &task.result, task.inputs);
+        if (group.mCallback != nullptr)
+        {
+            group.mCallback(task, group.mUserData);
+        }
+    }
+    group.complete(range.count);
+}
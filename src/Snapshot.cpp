@@ -0,0 +1,662 @@
+#include "Snapshot.hpp"
+
+#include "Verifier.hpp"
+
+#include <cstdio>
+#include <type_traits>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #define BLISSX_SNAPSHOT_MMAP
+#endif
+
+#ifdef BLISSX_SNAPSHOT_MMAP
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+
+    // Every page is read while fixing the image, faulting them in with the mapping is cheaper (Linux)
+    #ifdef MAP_POPULATE
+        #define SNAPSHOT_MAP_FLAGS (MAP_PRIVATE | MAP_POPULATE)
+    #else
+        #define SNAPSHOT_MAP_FLAGS MAP_PRIVATE
+    #endif
+#endif
+
+// Objects and values are written with their in-memory layout, references replaced by offsets
+// The type of a value is read back as a 32 bits number at offset 0 (see Jit.cpp)
+static_assert(std::is_trivially_copyable_v<Value> && std::is_standard_layout_v<Value> && sizeof(Value) == 16
+              && sizeof(Value::Type) == 4, "Unexpected layout of Value");
+
+namespace
+{
+    const char imageMagic[8] = { 'B', 'L', 'I', 'S', 'S', 'X', 'S', '\0' };
+    // Read back as another number on a machine of the other endianness
+    const std::uint32_t imageByteOrder = 0x01020304;
+    // Every object and table starts on this alignment, enough for any of them
+    const std::size_t imageAlignment = 16;
+
+    struct ImageHeader
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t byteOrder;
+        std::uint32_t pointerSize;
+        std::uint32_t valueSize;
+        std::uint64_t size;
+        // Offsets of the objects, in increasing order
+        std::uint64_t objectCount;
+        std::uint64_t objectsOffset;
+        // ImageChunk records
+        std::uint64_t chunkCount;
+        std::uint64_t chunksOffset;
+        // Values
+        std::uint64_t valueCount;
+        std::uint64_t valuesOffset;
+    };
+
+    struct ImageChunk
+    {
+        std::uint64_t nameOffset;
+        std::uint64_t codeOffset;
+        std::uint64_t linesOffset;
+        std::uint64_t count;
+        std::uint64_t constantsOffset;
+        std::uint64_t constantCount;
+    };
+
+    // Builds the image in memory, an offset is the position of something from the start of the image
+    class ImageWriter
+    {
+        public:
+            ImageWriter()
+                : mData(nullptr)
+                , mSize(0)
+                , mCapacity(0)
+                , mObjects(nullptr)
+                , mObjectCount(0)
+                , mObjectCapacity(0)
+                , mStrings(nullptr)
+                , mStringCount(0)
+                , mStringCapacity(0)
+            {
+            }
+
+            ~ImageWriter()
+            {
+                MEMORY_FREE_ARRAY(char, mData, mCapacity);
+                MEMORY_FREE_ARRAY(std::uint64_t, mObjects, mObjectCapacity);
+                MEMORY_FREE_ARRAY(std::uint64_t, mStrings, mStringCapacity);
+            }
+
+            // Zeroed space, aligned
+            std::uint64_t reserve(std::size_t size, std::size_t alignment = imageAlignment)
+            {
+                std::size_t offset = (mSize + alignment - 1) / alignment * alignment;
+                if (offset + size > mCapacity)
+                {
+                    std::size_t capacity = mCapacity;
+                    while (offset + size > capacity)
+                    {
+                        capacity = MEMORY_GROW_CAPACITY(capacity);
+                    }
+                    mData = MEMORY_GROW_ARRAY(mData, char, mCapacity, capacity);
+                    mCapacity = capacity;
+                }
+                memset(mData + mSize, 0, offset + size - mSize);
+                mSize = offset + size;
+                return offset;
+            }
+
+            std::uint64_t append(const void* data, std::size_t size, std::size_t alignment = imageAlignment)
+            {
+                std::uint64_t offset = reserve(size, alignment);
+                if (size > 0)
+                {
+                    memcpy(mData + offset, data, size);
+                }
+                return offset;
+            }
+
+            // The value as written in the image : objects are replaced by their offset
+            Value imageValue(const Value& value)
+            {
+                if (!value.isObject())
+                {
+                    return value;
+                }
+                return Value((Obj*)(std::uintptr_t)writeObject(value.asObject()));
+            }
+
+            std::uint64_t writeObject(Obj* object)
+            {
+                if (object->type == Obj::Type::String)
+                {
+                    return writeString((ObjString*)object);
+                }
+
+                // Natives are deduplicated by the compiler, and only called by name in the image
+                ObjNative* native = (ObjNative*)object;
+                ObjNative record;
+                memset(&record, 0, sizeof(record));
+                record.obj.type = Obj::Type::Native;
+                record.arity = native->arity;
+                record.name = (ObjString*)(std::uintptr_t)writeString(native->name);
+                return addObject(append(&record, sizeof(record)));
+            }
+
+            std::uint64_t writeString(ObjString* string)
+            {
+                std::uint32_t hash = hashString(string->chars, string->length);
+                std::size_t slot = findString(string->chars, string->length, hash);
+                if (mStringCapacity > 0 && mStrings[slot] != 0)
+                {
+                    return mStrings[slot];
+                }
+
+                std::uint64_t chars = append(string->chars, string->length + 1, 1);
+                ObjString record;
+                memset(&record, 0, sizeof(record));
+                record.obj.type = Obj::Type::String;
+                record.length = string->length;
+                record.chars = (char*)(std::uintptr_t)chars;
+                std::uint64_t offset = addObject(append(&record, sizeof(record)));
+
+                // Grown at 3/4, the slot is searched again in the new table
+                if ((mStringCount + 1) * 4 > mStringCapacity * 3)
+                {
+                    growStrings();
+                    slot = findString(string->chars, string->length, hash);
+                }
+                mStrings[slot] = offset;
+                mStringCount++;
+                return offset;
+            }
+
+            std::uint64_t getObjectCount() const
+            {
+                return mObjectCount;
+            }
+
+            const std::uint64_t* getObjects() const
+            {
+                return mObjects;
+            }
+
+            char* getData()
+            {
+                return mData;
+            }
+
+            std::size_t getSize() const
+            {
+                return mSize;
+            }
+
+        private:
+            static std::uint32_t hashString(const char* chars, int length)
+            {
+                // FNV-1a
+                std::uint32_t hash = 2166136261u;
+                for (int i = 0; i < length; i++)
+                {
+                    hash ^= (std::uint8_t)chars[i];
+                    hash *= 16777619u;
+                }
+                return hash;
+            }
+
+            const ObjString& stringAt(std::uint64_t offset) const
+            {
+                return *(const ObjString*)(mData + offset);
+            }
+
+            // Slot of the string, or of the empty slot where it goes
+            std::size_t findString(const char* chars, int length, std::uint32_t hash) const
+            {
+                if (mStringCapacity == 0)
+                {
+                    return 0;
+                }
+                std::size_t mask = mStringCapacity - 1;
+                for (std::size_t slot = hash & mask; ; slot = (slot + 1) & mask)
+                {
+                    if (mStrings[slot] == 0)
+                    {
+                        return slot;
+                    }
+                    const ObjString& string = stringAt(mStrings[slot]);
+                    if (string.length == length && memcmp(mData + (std::uintptr_t)string.chars, chars, length) == 0)
+                    {
+                        return slot;
+                    }
+                }
+            }
+
+            void growStrings()
+            {
+                std::size_t oldCapacity = mStringCapacity;
+                std::uint64_t* oldStrings = mStrings;
+
+                mStringCapacity = oldCapacity == 0 ? 64 : oldCapacity * 2;
+                mStrings = MEMORY_ALLOCATE(std::uint64_t, mStringCapacity);
+                memset(mStrings, 0, mStringCapacity * sizeof(std::uint64_t));
+                for (std::size_t i = 0; i < oldCapacity; i++)
+                {
+                    if (oldStrings[i] != 0)
+                    {
+                        const ObjString& string = stringAt(oldStrings[i]);
+                        const char* chars = mData + (std::uintptr_t)string.chars;
+                        mStrings[findString(chars, string.length, hashString(chars, string.length))] = oldStrings[i];
+                    }
+                }
+                MEMORY_FREE_ARRAY(std::uint64_t, oldStrings, oldCapacity);
+            }
+
+            std::uint64_t addObject(std::uint64_t offset)
+            {
+                if (mObjectCount == mObjectCapacity)
+                {
+                    std::size_t capacity = MEMORY_GROW_CAPACITY(mObjectCapacity);
+                    mObjects = MEMORY_GROW_ARRAY(mObjects, std::uint64_t, mObjectCapacity, capacity);
+                    mObjectCapacity = capacity;
+                }
+                mObjects[mObjectCount++] = offset;
+                return offset;
+            }
+
+            char* mData;
+            std::size_t mSize;
+            std::size_t mCapacity;
+
+            std::uint64_t* mObjects;
+            std::size_t mObjectCount;
+            std::size_t mObjectCapacity;
+
+            // Open addressing set of the written strings (their offsets, never 0 which is the header)
+            std::uint64_t* mStrings;
+            std::size_t mStringCount;
+            std::size_t mStringCapacity;
+    };
+
+    // True when count elements of size bytes at offset are inside the image, without overflowing
+    bool inImage(std::uint64_t offset, std::uint64_t count, std::uint64_t size, std::uint64_t imageSize, std::uint64_t alignment)
+    {
+        if (offset % alignment != 0 || offset > imageSize) return false;
+        return size == 0 || count <= (imageSize - offset) / size;
+    }
+}
+
+Snapshot::Snapshot()
+    : mImage(nullptr)
+    , mSize(0)
+    , mChunks(nullptr)
+    , mChunkCount(0)
+    , mValues(nullptr)
+    , mValueCount(0)
+{
+}
+
+Snapshot::~Snapshot()
+{
+    close();
+}
+
+bool Snapshot::write(const char* path, const Chunk* const* chunks, std::size_t chunkCount, const Value* values, std::size_t valueCount)
+{
+    ImageWriter writer;
+    writer.reserve(sizeof(ImageHeader));
+
+    ImageChunk* records = MEMORY_ALLOCATE(ImageChunk, chunkCount);
+    for (std::size_t i = 0; i < chunkCount; i++)
+    {
+        const Chunk& chunk = *chunks[i];
+        if (!chunk.isVerified())
+        {
+            fprintf(stderr, "Chunk must be verified before being saved.\n");
+            MEMORY_FREE_ARRAY(ImageChunk, records, chunkCount);
+            return false;
+        }
+
+        // Converted first : writing the objects moves the image
+        std::size_t constantCount = chunk.constantCount();
+        Value* constants = MEMORY_ALLOCATE(Value, constantCount);
+        for (std::size_t constant = 0; constant < constantCount; constant++)
+        {
+            constants[constant] = writer.imageValue(chunk.getConstant(constant));
+        }
+
+        ImageChunk& record = records[i];
+        record.nameOffset = writer.append(chunk.getName(), strlen(chunk.getName()) + 1, 1);
+        record.codeOffset = writer.append(chunk.beginOfCode(), chunk.size(), 1);
+        record.linesOffset = writer.append(chunk.size() > 0 ? &chunk.getLine(0) : nullptr, chunk.size() * sizeof(int), alignof(int));
+        record.count = chunk.size();
+        record.constantsOffset = writer.append(constants, constantCount * sizeof(Value));
+        record.constantCount = constantCount;
+        MEMORY_FREE_ARRAY(Value, constants, constantCount);
+    }
+
+    Value* imageValues = MEMORY_ALLOCATE(Value, valueCount);
+    for (std::size_t i = 0; i < valueCount; i++)
+    {
+        imageValues[i] = writer.imageValue(values[i]);
+    }
+
+    ImageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, imageMagic, sizeof(imageMagic));
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrder = imageByteOrder;
+    header.pointerSize = sizeof(void*);
+    header.valueSize = sizeof(Value);
+    header.chunkCount = chunkCount;
+    header.chunksOffset = writer.append(records, chunkCount * sizeof(ImageChunk));
+    header.valueCount = valueCount;
+    header.valuesOffset = writer.append(imageValues, valueCount * sizeof(Value));
+    header.objectCount = writer.getObjectCount();
+    header.objectsOffset = writer.append(writer.getObjects(), writer.getObjectCount() * sizeof(std::uint64_t));
+    header.size = writer.getSize();
+    memcpy(writer.getData(), &header, sizeof(header));
+
+    MEMORY_FREE_ARRAY(ImageChunk, records, chunkCount);
+    MEMORY_FREE_ARRAY(Value, imageValues, valueCount);
+
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "Could not open file \"%s\".\n", path);
+        return false;
+    }
+    bool written = fwrite(writer.getData(), 1, writer.getSize(), file) == writer.getSize();
+    written = fclose(file) == 0 && written;
+    if (!written)
+    {
+        fprintf(stderr, "Could not write file \"%s\".\n", path);
+    }
+    return written;
+}
+
+bool Snapshot::open(const char* path, const Environment* environment)
+{
+    close();
+
+#ifdef BLISSX_SNAPSHOT_MMAP
+    int file = ::open(path, O_RDONLY);
+    if (file < 0)
+    {
+        fprintf(stderr, "Could not open file \"%s\".\n", path);
+        return false;
+    }
+    struct stat status;
+    if (fstat(file, &status) != 0 || !S_ISREG(status.st_mode) || status.st_size == 0)
+    {
+        ::close(file);
+        return error(path, "not an image");
+    }
+
+    // Private writable mapping : only the pages holding references are copied when fixing them
+    mSize = (std::size_t)status.st_size;
+    void* image = mmap(nullptr, mSize, PROT_READ | PROT_WRITE, SNAPSHOT_MAP_FLAGS, file, 0);
+    ::close(file);
+    if (image == MAP_FAILED)
+    {
+        mSize = 0;
+        fprintf(stderr, "Could not map file \"%s\".\n", path);
+        return false;
+    }
+    mImage = (char*)image;
+#else
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "Could not open file \"%s\".\n", path);
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size <= 0)
+    {
+        fclose(file);
+        return error(path, "not an image");
+    }
+    mSize = (std::size_t)size;
+    mImage = MEMORY_ALLOCATE(char, mSize);
+    bool read = fread(mImage, 1, mSize, file) == mSize;
+    fclose(file);
+    if (!read)
+    {
+        return error(path, "could not be read");
+    }
+#endif
+
+    if (mSize < sizeof(ImageHeader))
+    {
+        return error(path, "not an image");
+    }
+    ImageHeader header;
+    memcpy(&header, mImage, sizeof(header));
+    if (memcmp(header.magic, imageMagic, sizeof(imageMagic)) != 0)
+    {
+        return error(path, "not an image");
+    }
+    if (header.version != SNAPSHOT_VERSION || header.byteOrder != imageByteOrder || header.pointerSize != sizeof(void*)
+        || header.valueSize != sizeof(Value))
+    {
+        return error(path, "written by another version or for another machine");
+    }
+    if (header.size != mSize
+        || !inImage(header.objectsOffset, header.objectCount, sizeof(std::uint64_t), mSize, imageAlignment)
+        || !inImage(header.chunksOffset, header.chunkCount, sizeof(ImageChunk), mSize, imageAlignment)
+        || !inImage(header.valuesOffset, header.valueCount, sizeof(Value), mSize, imageAlignment))
+    {
+        return error(path, "truncated or corrupted");
+    }
+
+    // Objects first, so the values can then only reference fixed objects
+    // A reference must be the offset of one of the objects, found by binary search in their sorted offsets
+    const std::uint64_t* objects = (const std::uint64_t*)(mImage + header.objectsOffset);
+    auto findObject = [&](std::uint64_t offset)
+    {
+        std::uint64_t low = 0;
+        std::uint64_t high = header.objectCount;
+        while (low < high)
+        {
+            std::uint64_t middle = low + (high - low) / 2;
+            if (objects[middle] < offset) low = middle + 1;
+            else high = middle;
+        }
+        return low < header.objectCount && objects[low] == offset ? low : header.objectCount;
+    };
+
+    for (std::uint64_t i = 0; i < header.objectCount; i++)
+    {
+        std::uint64_t offset = objects[i];
+        if ((i > 0 && offset <= objects[i - 1]) || !inImage(offset, 1, sizeof(Obj), mSize, imageAlignment))
+        {
+            return error(path, "truncated or corrupted");
+        }
+
+        // Types are read as numbers first, they may not even be one of the enumerators
+        Obj* object = (Obj*)(mImage + offset);
+        std::uint32_t type;
+        memcpy(&type, &object->type, sizeof(type));
+        object->next = nullptr;
+        if (type == Obj::Type::String)
+        {
+            ObjString* string = (ObjString*)object;
+            std::uint64_t chars = (std::uintptr_t)string->chars;
+            if (!inImage(offset, 1, sizeof(ObjString), mSize, imageAlignment) || string->length < 0
+                || !inImage(chars, (std::uint64_t)string->length + 1, 1, mSize, 1) || mImage[chars + string->length] != '\0')
+            {
+                return error(path, "truncated or corrupted");
+            }
+            string->chars = mImage + chars;
+        }
+        else if (type == Obj::Type::Native)
+        {
+            // The name is written before the native, so it is already checked and fixed
+            ObjNative* native = (ObjNative*)object;
+            std::uint64_t name = (std::uintptr_t)native->name;
+            if (!inImage(offset, 1, sizeof(ObjNative), mSize, imageAlignment) || findObject(name) >= i
+                || ((Obj*)(mImage + name))->type != Obj::Type::String)
+            {
+                return error(path, "truncated or corrupted");
+            }
+            native->name = (ObjString*)(mImage + name);
+
+            const NativeBinding* binding = environment != nullptr ? environment->find(native->name->chars, native->name->length) : nullptr;
+            if (binding == nullptr)
+            {
+                fprintf(stderr, "Image \"%s\" calls the undefined native function '%s'.\n", path, native->name->chars);
+                close();
+                return false;
+            }
+            if (binding->arity != native->arity)
+            {
+                fprintf(stderr, "Image \"%s\" calls '%s' with %d arguments, it takes %d.\n", path, native->name->chars,
+                        native->arity, binding->arity);
+                close();
+                return false;
+            }
+            native->thunk = binding->thunk;
+            native->function = binding->function;
+        }
+        else
+        {
+            return error(path, "truncated or corrupted");
+        }
+    }
+
+    auto fixValue = [&](Value& value)
+    {
+        std::uint32_t type;
+        std::uint64_t payload;
+        memcpy(&type, &value, sizeof(type));
+        memcpy(&payload, (const char*)&value + 8, sizeof(payload));
+        if (type == Value::Type::Bool)
+        {
+            return payload <= 1;
+        }
+        if (type != Value::Type::Object)
+        {
+            return type < Value::Type::Object;
+        }
+        std::uint64_t offset = (std::uintptr_t)value.asObject();
+        if (findObject(offset) == header.objectCount)
+        {
+            return false;
+        }
+        value = Value((Obj*)(mImage + offset));
+        return true;
+    };
+
+    Value* values = (Value*)(mImage + header.valuesOffset);
+    for (std::uint64_t i = 0; i < header.valueCount; i++)
+    {
+        if (!fixValue(values[i]))
+        {
+            return error(path, "truncated or corrupted");
+        }
+    }
+
+    const ImageChunk* records = (const ImageChunk*)(mImage + header.chunksOffset);
+    mChunks = new Chunk[header.chunkCount];
+    mChunkCount = header.chunkCount;
+    for (std::uint64_t i = 0; i < header.chunkCount; i++)
+    {
+        const ImageChunk& record = records[i];
+        if (!inImage(record.nameOffset, 1, 1, mSize, 1) || memchr(mImage + record.nameOffset, '\0', mSize - record.nameOffset) == nullptr
+            || !inImage(record.codeOffset, record.count, 1, mSize, 1)
+            || !inImage(record.linesOffset, record.count, sizeof(int), mSize, alignof(int))
+            || !inImage(record.constantsOffset, record.constantCount, sizeof(Value), mSize, imageAlignment))
+        {
+            return error(path, "truncated or corrupted");
+        }
+
+        Value* constants = (Value*)(mImage + record.constantsOffset);
+        for (std::uint64_t constant = 0; constant < record.constantCount; constant++)
+        {
+            if (!fixValue(constants[constant]))
+            {
+                return error(path, "truncated or corrupted");
+            }
+        }
+
+        Chunk& chunk = mChunks[i];
+        chunk.setName(mImage + record.nameOffset);
+        chunk.setExternal((const std::uint8_t*)(mImage + record.codeOffset), (const int*)(mImage + record.linesOffset),
+                          record.count, constants, record.constantCount);
+        if (!Verifier::verify(chunk))
+        {
+            return error(path, "invalid chunk");
+        }
+        // The host gives the inputs of the environment to execute, a chunk reading more would read past them
+        if (chunk.getInputCount() > (environment != nullptr ? environment->inputCount() : 0))
+        {
+            return error(path, "chunk reads inputs missing from the environment");
+        }
+        // Indices of globals only have a meaning in the environment the chunk was compiled with
+        if (chunk.getGlobalCount() > (environment != nullptr ? environment->globalCount() : 0))
+        {
+            return error(path, "chunk uses globals missing from the environment");
+        }
+    }
+
+    mValues = values;
+    mValueCount = header.valueCount;
+    return true;
+}
+
+void Snapshot::close()
+{
+    // The chunks are views of the image
+    delete[] mChunks;
+    mChunks = nullptr;
+    mChunkCount = 0;
+    mValues = nullptr;
+    mValueCount = 0;
+
+    if (mImage != nullptr)
+    {
+#ifdef BLISSX_SNAPSHOT_MMAP
+        munmap(mImage, mSize);
+#else
+        MEMORY_FREE_ARRAY(char, mImage, mSize);
+#endif
+        mImage = nullptr;
+    }
+    mSize = 0;
+}
+
+bool Snapshot::isOpen() const
+{
+    return mImage != nullptr;
+}
+
+std::size_t Snapshot::getChunkCount() const
+{
+    return mChunkCount;
+}
+
+const Chunk& Snapshot::getChunk(std::size_t index) const
+{
+    return mChunks[index];
+}
+
+std::size_t Snapshot::getValueCount() const
+{
+    return mValueCount;
+}
+
+const Value& Snapshot::getValue(std::size_t index) const
+{
+    return mValues[index];
+}
+
+bool Snapshot::error(const char* path, const char* message)
+{
+    fprintf(stderr, "Image \"%s\": %s.\n", path, message);
+    close();
+    return false;
+}
@@ -0,0 +1,167 @@
+#include "SourceFile.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+    #define BLISSX_SOURCEFILE_MMAP
+#endif
+
+#ifdef BLISSX_SOURCEFILE_MMAP
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#else
+    #include "Memory.hpp"
+
+    #include <cstdio>
+#endif
+
+SourceFile::SourceFile()
+    : mData(nullptr)
+    , mSize(0)
+    , mMappedSize(0)
+{
+}
+
+SourceFile::~SourceFile()
+{
+    close();
+}
+
+#ifdef BLISSX_SOURCEFILE_MMAP
+
+bool SourceFile::open(const char* path)
+{
+    close();
+
+    int file = ::open(path, O_RDONLY);
+    if (file < 0)
+    {
+        return false;
+    }
+
+    struct stat status;
+    if (fstat(file, &status) != 0 || !S_ISREG(status.st_mode))
+    {
+        ::close(file);
+        return false;
+    }
+
+    std::size_t size = (std::size_t)status.st_size;
+    std::size_t pageSize = (std::size_t)sysconf(_SC_PAGESIZE);
+
+    // Reserve the file size plus one byte, rounded up to whole pages, as zeroed anonymous memory
+    // The file is then mapped over the beginning of it : the bytes after the end of the file are zeros,
+    // either from the tail of its last page or from the extra page when the size is a multiple of the page size
+    std::size_t mappedSize = (size + 1 + pageSize - 1) / pageSize * pageSize;
+    void* reserved = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (reserved == MAP_FAILED)
+    {
+        ::close(file);
+        return false;
+    }
+
+    if (size > 0 && mmap(reserved, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, file, 0) == MAP_FAILED)
+    {
+        munmap(reserved, mappedSize);
+        ::close(file);
+        return false;
+    }
+
+    // The mapping stays valid once the descriptor is closed
+    ::close(file);
+
+    mData = (char*)reserved;
+    mSize = size;
+    mMappedSize = mappedSize;
+    return true;
+}
+
+void SourceFile::close()
+{
+    if (mData != nullptr)
+    {
+        munmap(mData, mMappedSize);
+    }
+    mData = nullptr;
+    mSize = 0;
+    mMappedSize = 0;
+}
+
+void SourceFile::adviseSequential()
+{
+    if (mData != nullptr)
+    {
+        madvise(mData, mMappedSize, MADV_SEQUENTIAL);
+    }
+}
+
+#else
+
+bool SourceFile::open(const char* path)
+{
+    close();
+
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    fseek(file, 0L, SEEK_END);
+    std::size_t fileSize = ftell(file);
+    rewind(file);
+
+    char* buffer = MEMORY_ALLOCATE(char, fileSize + 1);
+    if (buffer == NULL)
+    {
+        fclose(file);
+        return false;
+    }
+
+    std::size_t bytesRead = fread(buffer, sizeof(char), fileSize, file);
+    fclose(file);
+    if (bytesRead < fileSize)
+    {
+        MEMORY_FREE_ARRAY(char, buffer, fileSize + 1);
+        return false;
+    }
+
+    buffer[bytesRead] = '\0';
+
+    mData = buffer;
+    mSize = bytesRead;
+    mMappedSize = fileSize + 1;
+    return true;
+}
+
+void SourceFile::close()
+{
+    if (mData != nullptr)
+    {
+        MEMORY_FREE_ARRAY(char, mData, mMappedSize);
+    }
+    mData = nullptr;
+    mSize = 0;
+    mMappedSize = 0;
+}
+
+void SourceFile::adviseSequential()
+{
+}
+
+#endif // BLISSX_SOURCEFILE_MMAP
+
+bool SourceFile::isOpen() const
+{
+    return mData != nullptr;
+}
+
+const char* SourceFile::getSource() const
+{
+    return mData;
+}
+
+std::size_t SourceFile::getSize() const
+{
+    return mSize;
+}
@@ -0,0 +1,322 @@
+#include "TokenStream.hpp"
+
+#include "Memory.hpp"
+
+#include <algorithm>
+#include <thread>
+
+TokenStream::TokenStream()
+    : mSource(nullptr)
+    , mCount(0)
+    , mCapacity(0)
+    , mTypes(nullptr)
+    , mOffsets(nullptr)
+    , mLengths(nullptr)
+    , mLines(nullptr)
+    , mLiterals(nullptr)
+    , mMessageCount(0)
+    , mMessageCapacity(0)
+    , mMessages(nullptr)
+{
+}
+
+TokenStream::~TokenStream()
+{
+    MEMORY_FREE_ARRAY(std::uint8_t, mTypes, mCapacity);
+    MEMORY_FREE_ARRAY(std::uint32_t, mOffsets, mCapacity);
+    MEMORY_FREE_ARRAY(std::uint32_t, mLengths, mCapacity);
+    MEMORY_FREE_ARRAY(int, mLines, mCapacity);
+    MEMORY_FREE_ARRAY(Literal, mLiterals, mCapacity);
+    MEMORY_FREE_ARRAY(const char*, mMessages, mMessageCapacity);
+}
+
+void TokenStream::clear()
+{
+    // Keep the buffers, the stream is usually reused for the next source
+    mSource = nullptr;
+    mCount = 0;
+    mMessageCount = 0;
+}
+
+void TokenStream::tokenize(const char* source)
+{
+    clear();
+    mSource = source;
+
+    std::size_t size = strlen(source);
+    if (size > UINT32_MAX)
+    {
+        push(Token(Token::Type::Token_Error, "Source too large.", 17, 1), 0);
+        push(Token(Token::Type::Token_EndOfFile, source, 0, 1), 0);
+        return;
+    }
+
+    std::size_t segmentCount = 1;
+    if (size >= TOKENSTREAM_PARALLEL_THRESHOLD)
+    {
+        segmentCount = std::min<std::size_t>(std::thread::hardware_concurrency(), size / TOKENSTREAM_MIN_SEGMENT_SIZE);
+    }
+
+    if (segmentCount > 1)
+    {
+        tokenizeParallel(source, size, segmentCount);
+    }
+    else
+    {
+        tokenizeSequential(source, size);
+    }
+}
+
+std::size_t TokenStream::size() const
+{
+    return mCount;
+}
+
+Token TokenStream::getToken(std::size_t index) const
+{
+    if (index >= mCount) index = mCount - 1;
+
+    Token::Type type = (Token::Type)mTypes[index];
+    if (type == Token::Type::Token_Error)
+    {
+        const char* message = mMessages[mLengths[index]];
+        return Token(type, message, (int)strlen(message), mLines[index]);
+    }
+    Token token(type, mSource + mOffsets[index], (int)mLengths[index], mLines[index]);
+    token.integer = mLiterals[index].integer;
+    return token;
+}
+
+Token::Type TokenStream::getType(std::size_t index) const
+{
+    return (Token::Type)mTypes[index];
+}
+
+std::uint32_t TokenStream::getOffset(std::size_t index) const
+{
+    return mOffsets[index];
+}
+
+std::uint32_t TokenStream::getLength(std::size_t index) const
+{
+    return mLengths[index];
+}
+
+int TokenStream::getLine(std::size_t index) const
+{
+    return mLines[index];
+}
+
+double TokenStream::getNumber(std::size_t index) const
+{
+    return mLiterals[index].number;
+}
+
+std::int64_t TokenStream::getInteger(std::size_t index) const
+{
+    return mLiterals[index].integer;
+}
+
+void TokenStream::tokenizeSequential(const char* source, std::size_t size)
+{
+    reserve(size / 8 + 16);
+
+    Scanner scanner;
+    scanner.newSource(source);
+    for (;;)
+    {
+        Token token = scanner.scanToken();
+        push(token, (std::uint32_t)(scanner.getTokenStart() - source));
+        if (token.type == Token::Type::Token_EndOfFile) break;
+    }
+}
+
+void TokenStream::tokenizeParallel(const char* source, std::size_t size, std::size_t segmentCount)
+{
+    // Segments always start at the beginning of a line, so they can't start inside a comment
+    // They can still start inside a multi-line string : this is fixed while stitching
+    std::uint32_t* bounds = MEMORY_ALLOCATE(std::uint32_t, segmentCount + 1);
+    bounds[0] = 0;
+    for (std::size_t i = 1; i < segmentCount; i++)
+    {
+        std::size_t position = std::max<std::size_t>(i * size / segmentCount, bounds[i - 1]);
+        const char* newLine = (const char*)memchr(source + position, '\n', size - position);
+        bounds[i] = (std::uint32_t)(newLine != nullptr ? newLine - source + 1 : size);
+    }
+    bounds[segmentCount] = (std::uint32_t)size;
+
+    TokenStream* segments = new TokenStream[segmentCount];
+    std::uint32_t* resumes = MEMORY_ALLOCATE(std::uint32_t, segmentCount);
+    int* lineBases = MEMORY_ALLOCATE(int, segmentCount);
+
+    auto work = [&](std::size_t i)
+    {
+        segments[i].reserve((bounds[i + 1] - bounds[i]) / 8 + 16);
+        resumes[i] = segments[i].tokenizeSegment(source, bounds[i], bounds[i + 1], i + 1 == segmentCount);
+        lineBases[i] = (int)std::count(source + bounds[i], source + bounds[i + 1], '\n');
+    };
+
+    std::thread* threads = new std::thread[segmentCount - 1];
+    for (std::size_t i = 1; i < segmentCount; i++)
+    {
+        threads[i - 1] = std::thread(work, i);
+    }
+    work(0);
+    for (std::size_t i = 1; i < segmentCount; i++)
+    {
+        threads[i - 1].join();
+    }
+    delete[] threads;
+
+    // Newline counts to absolute line of the first line of each segment
+    int line = 1;
+    for (std::size_t i = 0; i < segmentCount; i++)
+    {
+        int count = lineBases[i];
+        lineBases[i] = line;
+        line += count;
+    }
+
+    auto segmentOf = [&](std::uint32_t offset)
+    {
+        std::size_t i = std::upper_bound(bounds + 1, bounds + segmentCount, offset) - (bounds + 1);
+        return i;
+    };
+
+    reserve(size / 8 + 16);
+
+    std::size_t segment = 0;
+    std::size_t from = 0;
+    for (;;)
+    {
+        append(segments[segment], from, lineBases[segment]);
+        if (segment + 1 == segmentCount) break;
+
+        // The next token starts at resumes[segment]. If a later segment lexed a token starting there, both agree from
+        // this point on. Otherwise (that segment started inside a string) lex sequentially until they agree again.
+        std::uint32_t offset = resumes[segment];
+        std::size_t owner = segmentOf(offset);
+        std::size_t index = segments[owner].find(offset);
+        if (index < segments[owner].size())
+        {
+            segment = owner;
+            from = index;
+            continue;
+        }
+
+        Scanner scanner;
+        int startLine = lineBases[owner] + (int)std::count(source + bounds[owner], source + offset, '\n');
+        scanner.newSource(source + offset, startLine);
+        Token token = scanner.scanToken();
+        for (;;)
+        {
+            push(token, offset);
+            if (token.type == Token::Type::Token_EndOfFile) break;
+
+            token = scanner.scanToken();
+            offset = (std::uint32_t)(scanner.getTokenStart() - source);
+            owner = segmentOf(offset);
+            index = segments[owner].find(offset);
+            if (index < segments[owner].size()) break;
+        }
+
+        if (token.type == Token::Type::Token_EndOfFile) break;
+        segment = owner;
+        from = index;
+    }
+
+    delete[] segments;
+    MEMORY_FREE_ARRAY(int, lineBases, segmentCount);
+    MEMORY_FREE_ARRAY(std::uint32_t, resumes, segmentCount);
+    MEMORY_FREE_ARRAY(std::uint32_t, bounds, segmentCount + 1);
+}
+
+std::uint32_t TokenStream::tokenizeSegment(const char* source, std::uint32_t begin, std::uint32_t end, bool last)
+{
+    clear();
+    mSource = source;
+
+    Scanner scanner;
+    scanner.newSource(source + begin, 0);
+    for (;;)
+    {
+        Token token = scanner.scanToken();
+        std::uint32_t offset = (std::uint32_t)(scanner.getTokenStart() - source);
+        if (!last && offset >= end) return offset;
+
+        push(token, offset);
+        if (token.type == Token::Type::Token_EndOfFile) return offset;
+    }
+}
+
+void TokenStream::push(const Token& token, std::uint32_t offset)
+{
+    if (mCapacity < mCount + 1)
+    {
+        reserve(MEMORY_GROW_CAPACITY(mCapacity));
+    }
+
+    std::uint32_t length = (std::uint32_t)token.length;
+    if (token.type == Token::Type::Token_Error)
+    {
+        if (mMessageCapacity < mMessageCount + 1)
+        {
+            std::size_t capacity = MEMORY_GROW_CAPACITY(mMessageCapacity);
+            mMessages = MEMORY_GROW_ARRAY(mMessages, const char*, mMessageCapacity, capacity);
+            mMessageCapacity = capacity;
+        }
+        mMessages[mMessageCount] = token.start;
+        length = (std::uint32_t)mMessageCount;
+        mMessageCount++;
+    }
+
+    mTypes[mCount] = (std::uint8_t)token.type;
+    mOffsets[mCount] = offset;
+    mLengths[mCount] = length;
+    mLines[mCount] = token.line;
+    mLiterals[mCount].integer = token.integer;
+    mCount++;
+}
+
+void TokenStream::append(const TokenStream& other, std::size_t from, int lineBase)
+{
+    reserve(mCount + other.mCount - from);
+    for (std::size_t i = from; i < other.mCount; i++)
+    {
+        Token::Type type = (Token::Type)other.mTypes[i];
+        if (type == Token::Type::Token_Error)
+        {
+            push(Token(type, other.mMessages[other.mLengths[i]], 0, other.mLines[i] + lineBase), other.mOffsets[i]);
+            continue;
+        }
+        mTypes[mCount] = other.mTypes[i];
+        mOffsets[mCount] = other.mOffsets[i];
+        mLengths[mCount] = other.mLengths[i];
+        mLines[mCount] = other.mLines[i] + lineBase;
+        mLiterals[mCount] = other.mLiterals[i];
+        mCount++;
+    }
+}
+
+void TokenStream::reserve(std::size_t size)
+{
+    if (mCapacity < size)
+    {
+        mTypes = MEMORY_GROW_ARRAY(mTypes, std::uint8_t, mCapacity, size);
+        mOffsets = MEMORY_GROW_ARRAY(mOffsets, std::uint32_t, mCapacity, size);
+        mLengths = MEMORY_GROW_ARRAY(mLengths, std::uint32_t, mCapacity, size);
+        mLines = MEMORY_GROW_ARRAY(mLines, int, mCapacity, size);
+        mLiterals = MEMORY_GROW_ARRAY(mLiterals, Literal, mCapacity, size);
+        mCapacity = size;
+    }
+}
+
+std::size_t TokenStream::find(std::uint32_t offset) const
+{
+    const std::uint32_t* it = std::lower_bound(mOffsets, mOffsets + mCount, offset);
+    if (it != mOffsets + mCount && *it == offset)
+    {
+        return it - mOffsets;
+    }
+    return mCount;
+}
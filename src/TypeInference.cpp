@@ -0,0 +1,178 @@
+#include "TypeInference.hpp"
+
+TypeInference::Type TypeInference::ofValue(const Value& value)
+{
+    switch (value.getType())
+    {
+        case Value::Type::Null: return Type_Null;
+        case Value::Type::Bool: return Type_Bool;
+        case Value::Type::Number: return Type_Double;
+        case Value::Type::Integer: return Type_Integer;
+        case Value::Type::Object: return value.isString() ? Type_String : Type_Unknown;
+    }
+    return Type_Unknown;
+}
+
+TypeInference::Type TypeInference::getResultType(std::uint8_t instruction, Type left, Type right)
+{
+    switch (generalize(instruction))
+    {
+        case Chunk::Op_Null: return Type_Null;
+        case Chunk::Op_True:
+        case Chunk::Op_False:
+        case Chunk::Op_Equal:
+        case Chunk::Op_BangEqual:
+        case Chunk::Op_Greater:
+        case Chunk::Op_GreaterEqual:
+        case Chunk::Op_Less:
+        case Chunk::Op_LessEqual:
+        case Chunk::Op_Not:
+            return Type_Bool;
+        case Chunk::Op_Add:
+            // Two strings or two numbers : one proven operand is enough
+            if (left == Type_String || right == Type_String) return Type_String;
+            if (!isNumber(left) && !isNumber(right)) return Type_Unknown;
+            return getArithmeticType(left, right);
+        case Chunk::Op_Substract:
+        case Chunk::Op_Multiply:
+        case Chunk::Op_Divide:
+            return getArithmeticType(left, right);
+        case Chunk::Op_Negate:
+            // Negating INT64_MIN gives a double
+            return right == Type_Double ? Type_Double : Type_Number;
+        case Chunk::Op_SetLocal:
+        case Chunk::Op_SetGlobal:
+            return right;
+        default:
+            return Type_Unknown;
+    }
+}
+
+const char* TypeInference::getError(std::uint8_t instruction, Type left, Type right)
+{
+    switch (instruction)
+    {
+        case Chunk::Op_Add:
+            if (left == Type_Null || left == Type_Bool || right == Type_Null || right == Type_Bool
+                || (left == Type_String && isNumber(right)) || (isNumber(left) && right == Type_String))
+            {
+                return "Operands must be two numbers or two strings.";
+            }
+            return nullptr;
+        case Chunk::Op_Greater:
+        case Chunk::Op_GreaterEqual:
+        case Chunk::Op_Less:
+        case Chunk::Op_LessEqual:
+        case Chunk::Op_Substract:
+        case Chunk::Op_Multiply:
+        case Chunk::Op_Divide:
+            return isNotNumber(left) || isNotNumber(right) ? "Operands must be numbers." : nullptr;
+        case Chunk::Op_Negate:
+            return isNotNumber(right) ? "Operand must be a number." : nullptr;
+        case Chunk::Op_SetGlobal:
+            return right == Type_String ? "Only numbers, bools and null can be stored in globals." : nullptr;
+        default:
+            return nullptr;
+    }
+}
+
+std::uint8_t TypeInference::specialize(std::uint8_t instruction, Type left, Type right)
+{
+    bool numbers = isNumber(left) && isNumber(right);
+    bool doubles = numbers && (left == Type_Double || right == Type_Double);
+    if (instruction == Chunk::Op_Negate)
+    {
+        if (right == Type_Double) return Chunk::Op_NegateDouble;
+        if (isNumber(right)) return Chunk::Op_NegateNumber;
+        return instruction;
+    }
+    if (!numbers)
+    {
+        return instruction;
+    }
+
+    switch (instruction)
+    {
+        case Chunk::Op_Greater: return Chunk::Op_GreaterNumber;
+        case Chunk::Op_GreaterEqual: return Chunk::Op_GreaterEqualNumber;
+        case Chunk::Op_Less: return Chunk::Op_LessNumber;
+        case Chunk::Op_LessEqual: return Chunk::Op_LessEqualNumber;
+        case Chunk::Op_Add: return doubles ? (std::uint8_t)Chunk::Op_AddDouble : (std::uint8_t)Chunk::Op_AddNumber;
+        case Chunk::Op_Substract: return doubles ? (std::uint8_t)Chunk::Op_SubstractDouble : (std::uint8_t)Chunk::Op_SubstractNumber;
+        case Chunk::Op_Multiply: return doubles ? (std::uint8_t)Chunk::Op_MultiplyDouble : (std::uint8_t)Chunk::Op_MultiplyNumber;
+        case Chunk::Op_Divide: return doubles ? (std::uint8_t)Chunk::Op_DivideDouble : (std::uint8_t)Chunk::Op_DivideNumber;
+        default:
+            return instruction;
+    }
+}
+
+std::uint8_t TypeInference::generalize(std::uint8_t instruction)
+{
+    switch (instruction)
+    {
+        case Chunk::Op_GreaterNumber: return Chunk::Op_Greater;
+        case Chunk::Op_GreaterEqualNumber: return Chunk::Op_GreaterEqual;
+        case Chunk::Op_LessNumber: return Chunk::Op_Less;
+        case Chunk::Op_LessEqualNumber: return Chunk::Op_LessEqual;
+        case Chunk::Op_AddNumber:
+        case Chunk::Op_AddDouble:
+            return Chunk::Op_Add;
+        case Chunk::Op_SubstractNumber:
+        case Chunk::Op_SubstractDouble:
+            return Chunk::Op_Substract;
+        case Chunk::Op_MultiplyNumber:
+        case Chunk::Op_MultiplyDouble:
+            return Chunk::Op_Multiply;
+        case Chunk::Op_DivideNumber:
+        case Chunk::Op_DivideDouble:
+            return Chunk::Op_Divide;
+        case Chunk::Op_NegateNumber:
+        case Chunk::Op_NegateDouble:
+            return Chunk::Op_Negate;
+        default:
+            return instruction;
+    }
+}
+
+bool TypeInference::isAccepted(std::uint8_t instruction, Type left, Type right)
+{
+    bool numbers = isNumber(left) && isNumber(right);
+    switch (instruction)
+    {
+        case Chunk::Op_GreaterNumber:
+        case Chunk::Op_GreaterEqualNumber:
+        case Chunk::Op_LessNumber:
+        case Chunk::Op_LessEqualNumber:
+        case Chunk::Op_AddNumber:
+        case Chunk::Op_SubstractNumber:
+        case Chunk::Op_MultiplyNumber:
+        case Chunk::Op_DivideNumber:
+            return numbers;
+        case Chunk::Op_AddDouble:
+        case Chunk::Op_SubstractDouble:
+        case Chunk::Op_MultiplyDouble:
+        case Chunk::Op_DivideDouble:
+            return numbers && (left == Type_Double || right == Type_Double);
+        case Chunk::Op_NegateNumber: return isNumber(right);
+        case Chunk::Op_NegateDouble: return right == Type_Double;
+        default:
+            return true;
+    }
+}
+
+bool TypeInference::isNumber(Type type)
+{
+    return type == Type_Integer || type == Type_Double || type == Type_Number;
+}
+
+bool TypeInference::isNotNumber(Type type)
+{
+    return type == Type_Null || type == Type_Bool || type == Type_String;
+}
+
+TypeInference::Type TypeInference::getArithmeticType(Type left, Type right)
+{
+    // Any double operand makes a double, integers overflowing 64 bits or not divided exactly give doubles too
+    if (left == Type_Double || right == Type_Double) return Type_Double;
+    return Type_Number;
+}
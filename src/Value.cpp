@@ -1,110 +1,71 @@
 #include "Value.hpp"
 
-#define ALLOCATE_OBJ(type, objType) \
-    (type*)Obj::allocateObj(sizeof(type), objType)
+#define ALLOCATE_OBJ(heap, type, objType) \
+    (type*)Obj::allocateObj(heap, sizeof(type), objType)
 
-Obj* Obj::allocateObj(std::size_t size, Obj::Type type)
+Obj* Obj::allocateObj(Heap& heap, std::size_t size, Obj::Type type)
 {
     Obj* object = (Obj*)Memory::reallocate(NULL, 0, size);
     object->type = type;
+    heap.add(object);
     return object;
 }
 
-ObjString* ObjString::copyString(const char* chars, int length)
+ObjString* ObjString::copyString(Heap& heap, const char* chars, int length)
 {
     char* heapChars = MEMORY_ALLOCATE(char, length + 1);
     memcpy(heapChars, chars, length);
     heapChars[length] = '\0';
-    return allocateString(heapChars, length);
+    return allocateString(heap, heapChars, length);
 }
 
-ObjString* ObjString::takeString(char* chars, int length)
+ObjString* ObjString::takeString(Heap& heap, char* chars, int length)
 {
-    return allocateString(chars, length);
+    return allocateString(heap, chars, length);
 }
 
-ObjString* ObjString::allocateString(char* chars, int length)
+ObjString* ObjString::allocateString(Heap& heap, char* chars, int length)
 {
-    ObjString* string = ALLOCATE_OBJ(ObjString, Obj::Type::String);
+    ObjString* string = ALLOCATE_OBJ(heap, ObjString, Obj::Type::String);
     string->length = length;
     string->chars = chars;
     return string;
 }
 
-Value::Value()
-    : mType(Value::Type::Null)
+ObjNative* ObjNative::allocateNative(Heap& heap, NativeThunk thunk, NativeFunction function, int arity, ObjString* name)
 {
-    mAs.number = 0;
-}
-
-Value::Value(bool value)
-    : mType(Value::Type::Bool)
-{
-    mAs.boolean = value;
-}
-
-Value::Value(double value)
-    : mType(Value::Type::Number)
-{
-    mAs.number = value;
-}
-
-Value::Value(Obj* object)
-    : mType(Value::Type::Object)
-{
-    mAs.object = object;
-}
-
-Value::Type Value::getType() const
-{
-    return mType;
-}
-
-Obj::Type Value::getObjectType() const
-{
-    return mAs.object->type;
-}
-
-bool Value::isNull() const
-{
-    return mType == Value::Type::Null;
-}
-
-bool Value::isBool() const
-{
-    return mType == Value::Type::Bool;
-}
-
-bool Value::isNumber() const
-{
-    return mType == Value::Type::Number;
-}
-
-bool Value::isObject() const
-{
-    return mType == Value::Type::Object;
-}
-
-bool Value::isString() const
-{
-    return isObject() && asObject()->type == Obj::Type::String;
-}
-
-bool Value::isFalsey() const
-{
-    return isNull() || (isBool() && !asBool());
+    ObjNative* native = ALLOCATE_OBJ(heap, ObjNative, Obj::Type::Native);
+    native->thunk = thunk;
+    native->function = function;
+    native->arity = arity;
+    native->name = name;
+    return native;
 }
 
 bool Value::isEquals(const Value& value) const
 {
-    if (mType != value.mType) return false;
+    if (mType != value.mType)
+    {
+        // Exact comparison : the double must be integral and in the range of integers
+        if (isInteger() && value.isDouble()) return value.isEquals(*this);
+        if (isDouble() && value.isInteger())
+        {
+            double number = asDouble();
+            return number >= -9223372036854775808.0 && number < 9223372036854775808.0 && (double)(std::int64_t)number == number
+                && (std::int64_t)number == value.asInteger();
+        }
+        return false;
+    }
+
     switch (mType)
     {
         case Value::Type::Bool: return asBool() == value.asBool();
         case Value::Type::Null: return true;
-        case Value::Type::Number: return asNumber() == value.asNumber();
+        case Value::Type::Number: return asDouble() == value.asDouble();
+        case Value::Type::Integer: return asInteger() == value.asInteger();
         case Value::Type::Object:
         {
+            if (!isString() || !value.isString()) return asObject() == value.asObject();
             ObjString* aString = asString();
             ObjString* bString = value.asString();
             return aString->length == bString->length && memcmp(aString->chars, bString->chars, aString->length) == 0;
@@ -113,31 +74,6 @@ bool Value::isEquals(const Value& value) const
     return false;
 }
 
-bool Value::asBool() const
-{
-    return mAs.boolean;
-}
-
-double Value::asNumber() const
-{
-    return mAs.number;
-}
-
-Obj* Value::asObject() const
-{
-    return mAs.object;
-}
-
-ObjString* Value::asString() const
-{
-    return (ObjString*)mAs.object;
-}
-
-char* Value::asCString() const
-{
-    return ((ObjString*)mAs.object)->chars;
-}
-
 ValueArray::ValueArray()
     : mCount(0)
     , mCapacity(0)
@@ -152,12 +88,26 @@ ValueArray::~ValueArray()
 
 void ValueArray::clear()
 {
-    MEMORY_FREE_ARRAY(Value, mValues, mCapacity);
+    // External values have no capacity, they aren't owned
+    if (mCapacity > 0)
+    {
+        MEMORY_FREE_ARRAY(Value, mValues, mCapacity);
+    }
     mCount = 0;
     mCapacity = 0;
     mValues = nullptr;
 }
 
+void ValueArray::reset()
+{
+    if (mCapacity == 0)
+    {
+        clear();
+        return;
+    }
+    mCount = 0;
+}
+
 void ValueArray::push(Value value)
 {
     if (mCapacity < mCount + 1)
@@ -173,11 +123,27 @@ void ValueArray::reserve(std::size_t size)
 {
     if (mCapacity < size)
     {
-        mValues = MEMORY_GROW_ARRAY(mValues, Value, mCapacity, size);
+        if (mCapacity == 0 && mValues != nullptr)
+        {
+            Value* values = MEMORY_ALLOCATE(Value, size);
+            memcpy(values, mValues, mCount * sizeof(Value));
+            mValues = values;
+        }
+        else
+        {
+            mValues = MEMORY_GROW_ARRAY(mValues, Value, mCapacity, size);
+        }
         mCapacity = size;
     }
 }
 
+void ValueArray::setExternal(Value* values, std::size_t count)
+{
+    clear();
+    mValues = values;
+    mCount = count;
+}
+
 std::size_t ValueArray::size() const
 {
     return mCount;
@@ -0,0 +1,164 @@
+#include "Verifier.hpp"
+
+#include "TypeInference.hpp"
+
+#include <cstdio>
+
+bool Verifier::verify(Chunk& chunk)
+{
+    static const std::uint8_t popCounts[] = {
+        #define BLISSX_OPCODE_POPS(name, format, pops, pushes) pops,
+        BLISSX_OPCODES(BLISSX_OPCODE_POPS)
+        #undef BLISSX_OPCODE_POPS
+    };
+    static const std::uint8_t pushCounts[] = {
+        #define BLISSX_OPCODE_PUSHES(name, format, pops, pushes) pushes,
+        BLISSX_OPCODES(BLISSX_OPCODE_PUSHES)
+        #undef BLISSX_OPCODE_PUSHES
+    };
+
+    // Type of each stack slot as the compiler inferred it, the operands of unchecked instructions must be proven
+    TypeInference::Type* types = nullptr;
+    std::size_t typeCapacity = 0;
+
+    std::size_t depth = 0;
+    std::size_t maxDepth = 0;
+    std::size_t inputCount = 0;
+    std::size_t globalCount = 0;
+    std::size_t offset = 0;
+    const char* message = "Missing return at end of chunk.";
+    bool verified = false;
+    while (offset < chunk.size())
+    {
+        std::uint8_t instruction = chunk.getCode(offset);
+        if (instruction >= Chunk::Op_Count)
+        {
+            message = "Unknown opcode.";
+            break;
+        }
+        if (offset + Chunk::getInstructionLength(instruction) > chunk.size())
+        {
+            message = "Truncated operand.";
+            break;
+        }
+        if ((instruction == Chunk::Op_Constant || instruction == Chunk::Op_CallNative) && chunk.getCode(offset + 1) >= chunk.constantCount())
+        {
+            message = "Constant index out of range.";
+            break;
+        }
+
+        if (instruction == Chunk::Op_GetInput && chunk.getCode(offset + 1) >= inputCount)
+        {
+            inputCount = chunk.getCode(offset + 1) + 1;
+        }
+        if ((instruction == Chunk::Op_GetGlobal || instruction == Chunk::Op_SetGlobal) && chunk.getCode(offset + 1) >= globalCount)
+        {
+            globalCount = chunk.getCode(offset + 1) + 1;
+        }
+
+        std::size_t pops = popCounts[instruction];
+        if (instruction == Chunk::Op_CallNative)
+        {
+            const Value& native = chunk.getConstant(chunk.getCode(offset + 1));
+            if (!native.isNative())
+            {
+                message = "Call of a value which is not a native function.";
+                break;
+            }
+            if (native.asNative()->arity != chunk.getCode(offset + 2))
+            {
+                message = "Wrong argument count for native function.";
+                break;
+            }
+            pops += chunk.getCode(offset + 2);
+        }
+        if (depth < pops)
+        {
+            message = "Stack underflow.";
+            break;
+        }
+
+        // A local is below the values the instruction pops, assigning the top would overwrite the value being assigned
+        std::size_t operand = Chunk::getInstructionLength(instruction) > 1 ? chunk.getCode(offset + 1) : 0;
+        if ((instruction == Chunk::Op_GetLocal && operand >= depth) || (instruction == Chunk::Op_SetLocal && operand + 1 >= depth))
+        {
+            message = "Local slot out of range.";
+            break;
+        }
+
+        TypeInference::Type right = pops >= 1 ? types[depth - 1] : TypeInference::Type_Unknown;
+        TypeInference::Type left = pops >= 2 ? types[depth - 2] : TypeInference::Type_Unknown;
+        if (!TypeInference::isAccepted(instruction, left, right))
+        {
+            message = "Operand types not proven for an unchecked instruction.";
+            break;
+        }
+
+        depth = depth - pops + pushCounts[instruction];
+        if (depth > typeCapacity)
+        {
+            std::size_t capacity = MEMORY_GROW_CAPACITY(typeCapacity);
+            types = MEMORY_GROW_ARRAY(types, TypeInference::Type, typeCapacity, capacity);
+            typeCapacity = capacity;
+        }
+        if (instruction == Chunk::Op_SetLocal)
+        {
+            types[operand] = right;
+        }
+        if (pushCounts[instruction] > 0)
+        {
+            if (instruction == Chunk::Op_Constant)
+            {
+                types[depth - 1] = TypeInference::ofValue(chunk.getConstant(operand));
+            }
+            else if (instruction == Chunk::Op_GetLocal)
+            {
+                types[depth - 1] = types[operand];
+            }
+            else
+            {
+                types[depth - 1] = TypeInference::getResultType(instruction, left, right);
+            }
+        }
+        if (depth > maxDepth)
+        {
+            maxDepth = depth;
+        }
+
+        // There are no jumps : everything after a return would be unreachable
+        if (instruction == Chunk::Op_Return)
+        {
+            if (offset + 1 != chunk.size())
+            {
+                message = "Unreachable code after return.";
+                offset++;
+                break;
+            }
+            verified = true;
+            break;
+        }
+
+        offset += Chunk::getInstructionLength(instruction);
+    }
+
+    MEMORY_FREE_ARRAY(TypeInference::Type, types, typeCapacity);
+    if (!verified)
+    {
+        return error(chunk, offset, message);
+    }
+    chunk.setVerified(maxDepth, inputCount, globalCount);
+    return true;
+}
+
+bool Verifier::error(const Chunk& chunk, std::size_t offset, const char* message)
+{
+    if (offset < chunk.size())
+    {
+        fprintf(stderr, "[line %d] Invalid chunk at %04zu: %s\n", chunk.getLine(offset), offset, message);
+    }
+    else
+    {
+        fprintf(stderr, "Invalid chunk at %04zu: %s\n", offset, message);
+    }
+    return false;
+}
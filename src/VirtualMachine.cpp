@@ -1,12 +1,40 @@
 #include "VirtualMachine.hpp"
 
+#include "AotScript.hpp"
+#include "Arithmetic.hpp"
+#include "Debug.hpp"
+
+#include <algorithm>
+
 VirtualMachine::VirtualMachine()
+    : mChunk(nullptr)
+    , mInstructionPointer(nullptr)
+    , mInputs(nullptr)
+    , mStack(nullptr)
+    , mStackTop(nullptr)
+    , mStackCapacity(0)
+    , mGlobals(nullptr)
+    , mGlobalCount(0)
+    , mOutputSink(&OutputSink::getStandardOutput())
+    , mOutputBuffer(mOutputSink)
+    , mTraceSink(nullptr)
+    , mLineProfiler(nullptr)
+    , mInstructionBudget(0)
+    , mTimeBudget(0)
+    , mBudgetCountdown(0)
+    , mBudgetSlice(0)
+    , mBudgetRemaining(0)
+    , mSuspended(false)
+    , mJitEnabled(true)
 {
+    reserveStack(STACK_INITIAL_SIZE);
     resetStack();
 }
 
 VirtualMachine::~VirtualMachine()
 {
+    MEMORY_FREE_ARRAY(Value, mStack, mStackCapacity);
+    MEMORY_FREE_ARRAY(Value, mGlobals, mGlobalCount);
 }
 
 void VirtualMachine::push(Value value)
@@ -23,7 +51,19 @@ Value VirtualMachine::pop()
 
 void VirtualMachine::resetStack()
 {
-    mStackTop = mStack;
+    mStackTop = mStack + 1;
+}
+
+void VirtualMachine::reserveStack(std::size_t depth)
+{
+    // One more slot for mStack[0]
+    if (mStackCapacity < depth + 1)
+    {
+        std::size_t used = mStackTop != nullptr ? mStackTop - mStack : 0;
+        mStack = MEMORY_GROW_ARRAY(mStack, Value, mStackCapacity, depth + 1);
+        mStackCapacity = depth + 1;
+        mStackTop = mStack + used;
+    }
 }
 
 void VirtualMachine::runtimeError(const char* format, ...)
@@ -34,128 +74,728 @@ void VirtualMachine::runtimeError(const char* format, ...)
     va_end(args);
     fputs("\n", stderr);
 
-    std::size_t instruction = mInstructionPointer - mChunk->beginOfCode();
+    std::size_t instruction = mInstructionPointer - mChunk->beginOfCode() - 1;
     fprintf(stderr, "[line %d] in script\n", mChunk->getLine(instruction));
 
     resetStack();
 }
 
-VirtualMachine::InterpretResult VirtualMachine::interpret(const char* source)
+VirtualMachine::InterpretResult VirtualMachine::interpret(const char* source, const char* name)
 {
     Chunk chunk;
 
-    if (!Compiler::compile(source, &chunk))
+    InterpretResult result = compile(source, &chunk, name);
+    if (result != Interpret_Ok)
+    {
+        return result;
+    }
+
+    Value value;
+    result = execute(chunk, &value);
+    if (result == Interpret_Ok)
+    {
+        Debug::printValue(value, mOutputBuffer);
+        mOutputBuffer.write("\n", 1);
+    }
+
+    resetHeap();
+    return result;
+}
+
+VirtualMachine::InterpretResult VirtualMachine::compile(const char* source, Chunk* chunk, const char* name)
+{
+    // A chunk compiled again and again keeps its buffers
+    chunk->reset();
+    chunk->setName(name);
+    if (!mCompiler.compile(source, chunk))
     {
         return Interpret_CompileError;
     }
 
+    if (mTraceSink != nullptr)
+    {
+        Debug::disassembleChunk(*chunk, chunk->getName(), *mTraceSink);
+    }
+
+    return Interpret_Ok;
+}
+
+VirtualMachine::InterpretResult VirtualMachine::execute(const Chunk& chunk, Value* result, const Value* inputs)
+{
+    if (!chunk.isVerified())
+    {
+        fprintf(stderr, "Chunk must be verified before being executed.\n");
+        return Interpret_VerifyError;
+    }
+    if (chunk.getInputCount() > 0 && inputs == nullptr)
+    {
+        fprintf(stderr, "Chunk reads %zu inputs but none were given.\n", chunk.getInputCount());
+        return Interpret_VerifyError;
+    }
+
+    reserveStack(chunk.getMaxStackDepth());
+    resetStack();
+    reserveGlobals(chunk.getGlobalCount());
+
     mChunk = &chunk;
     mInstructionPointer = mChunk->beginOfCode();
+    mInputs = inputs;
+    // A suspended execution is abandoned
+    mSuspended = false;
 
-    return run();
+    return runChunk(result);
 }
 
-VirtualMachine::InterpretResult VirtualMachine::run()
+VirtualMachine::InterpretResult VirtualMachine::resume(Value* result)
 {
-    #define READ_BYTE() (*mInstructionPointer++)
-    #define READ_CONSTANT() (mChunk->getConstant(READ_BYTE()))
-    #define BINARY_OP(op) \
-        do { \
-            if (!peek(0).isNumber() || !peek(1).isNumber()) \
+    if (!mSuspended)
+    {
+        fprintf(stderr, "No suspended execution to resume.\n");
+        return Interpret_VerifyError;
+    }
+
+    return runChunk(result);
+}
+
+bool VirtualMachine::isSuspended() const
+{
+    return mSuspended;
+}
+
+VirtualMachine::InterpretResult VirtualMachine::runChunk(Value* result)
+{
+    bool budgeted = mInstructionBudget > 0 || mTimeBudget.count() > 0;
+    if (budgeted)
+    {
+        startBudget();
+    }
+
+#ifdef BLISSX_PROFILE_OPCODES
+    mOpCodeProfile.beginRun();
+#endif
+
+    InterpretResult status;
+#ifdef BLISSX_JIT
+    // The native code can't stop between two instructions, it only runs complete executions
+    const JitCode* code = mJitEnabled && !budgeted && !mSuspended && mTraceSink == nullptr && mLineProfiler == nullptr
+                        ? mJit.enter(*mChunk) : nullptr;
+    if (code != nullptr)
+    {
+        status = runNative(*code);
+    }
+    else
+#endif
+    if (budgeted)
+    {
+        if (mTraceSink != nullptr)
+        {
+            status = mLineProfiler != nullptr ? run<true, true, true>() : run<true, false, true>();
+        }
+        else
+        {
+            status = mLineProfiler != nullptr ? run<false, true, true>() : run<false, false, true>();
+        }
+    }
+    else if (mTraceSink != nullptr)
+    {
+        status = mLineProfiler != nullptr ? run<true, true, false>() : run<true, false, false>();
+    }
+    else
+    {
+        status = mLineProfiler != nullptr ? run<false, true, false>() : run<false, false, false>();
+    }
+
+#ifdef BLISSX_PROFILE_OPCODES
+    mOpCodeProfile.endRun();
+#endif
+
+    mSuspended = status == Interpret_Yield;
+
+    // Op_Return leaves the result on the stack
+    if (status == Interpret_Ok)
+    {
+        Value value = pop();
+        if (result != nullptr)
+        {
+            *result = value;
+        }
+    }
+    return status;
+}
+
+void VirtualMachine::startBudget()
+{
+    mBudgetRemaining = mInstructionBudget > 0 ? mInstructionBudget : SIZE_MAX;
+    mBudgetSlice = mBudgetRemaining;
+    if (mTimeBudget.count() > 0)
+    {
+        mBudgetDeadline = std::chrono::steady_clock::now() + mTimeBudget;
+        mBudgetSlice = std::min<std::size_t>(mBudgetSlice, BUDGET_CLOCK_INTERVAL);
+    }
+    mBudgetCountdown = mBudgetSlice;
+}
+
+bool VirtualMachine::budgetSpent()
+{
+    mBudgetRemaining -= mBudgetSlice;
+    if (mBudgetRemaining == 0)
+    {
+        return true;
+    }
+    if (mTimeBudget.count() > 0)
+    {
+        if (std::chrono::steady_clock::now() >= mBudgetDeadline)
+        {
+            return true;
+        }
+        mBudgetSlice = std::min<std::size_t>(mBudgetRemaining, BUDGET_CLOCK_INTERVAL);
+    }
+    else
+    {
+        mBudgetSlice = mBudgetRemaining;
+    }
+    // The instruction about to run is the first one of the new slice
+    mBudgetCountdown = mBudgetSlice - 1;
+    return false;
+}
+
+VirtualMachine::InterpretResult VirtualMachine::execute(const AotScript& script, Value* result, const Value* inputs)
+{
+    if (!script.isLinked())
+    {
+        fprintf(stderr, "Script must be linked before being executed.\n");
+        return Interpret_VerifyError;
+    }
+    const AotDefinition& definition = script.getDefinition();
+    if (definition.inputCount > 0 && inputs == nullptr)
+    {
+        fprintf(stderr, "Script reads %zu inputs but none were given.\n", definition.inputCount);
+        return Interpret_VerifyError;
+    }
+
+    reserveGlobals(definition.globalCount);
+
+    Value value;
+    InterpretResult status = definition.function(*this, script.getNatives(), inputs, &value);
+    if (status == Interpret_Ok && result != nullptr)
+    {
+        *result = value;
+    }
+    return status;
+}
+
+bool VirtualMachine::setGlobal(std::size_t index, Value value)
+{
+    // An object could be freed while the global still references it
+    if (value.isObject())
+    {
+        fprintf(stderr, "Only numbers, bools and null can be stored in globals.\n");
+        return false;
+    }
+    reserveGlobals(index + 1);
+    mGlobals[index] = value;
+    return true;
+}
+
+Value VirtualMachine::getGlobal(std::size_t index) const
+{
+    return index < mGlobalCount ? mGlobals[index] : Value();
+}
+
+void VirtualMachine::reserveGlobals(std::size_t count)
+{
+    if (mGlobalCount < count)
+    {
+        mGlobals = MEMORY_GROW_ARRAY(mGlobals, Value, mGlobalCount, count);
+        for (std::size_t i = mGlobalCount; i < count; i++)
+        {
+            mGlobals[i] = Value();
+        }
+        mGlobalCount = count;
+    }
+}
+
+void VirtualMachine::resetHeap()
+{
+    mHeap.clear();
+}
+
+void VirtualMachine::setEnvironment(const Environment* environment)
+{
+    mCompiler.setEnvironment(environment);
+}
+
+void VirtualMachine::setOutputSink(OutputSink* sink)
+{
+    mOutputBuffer.setDestination(sink);
+    mOutputSink = sink;
+}
+
+OutputSink* VirtualMachine::getOutputSink() const
+{
+    return mOutputSink;
+}
+
+void VirtualMachine::flushOutput()
+{
+    mOutputBuffer.flush();
+}
+
+void VirtualMachine::setTraceSink(OutputSink* sink)
+{
+    mTraceSink = sink;
+}
+
+OutputSink* VirtualMachine::getTraceSink() const
+{
+    return mTraceSink;
+}
+
+void VirtualMachine::setLineProfiler(LineProfiler* profiler)
+{
+    mLineProfiler = profiler;
+}
+
+LineProfiler* VirtualMachine::getLineProfiler() const
+{
+    return mLineProfiler;
+}
+
+void VirtualMachine::setInstructionBudget(std::size_t instructions)
+{
+    mInstructionBudget = instructions;
+}
+
+void VirtualMachine::setTimeBudget(std::chrono::nanoseconds time)
+{
+    mTimeBudget = time;
+}
+
+void VirtualMachine::setJitEnabled(bool enabled)
+{
+    mJitEnabled = enabled;
+}
+
+void VirtualMachine::setJitThreshold(std::size_t executions)
+{
+#ifdef BLISSX_JIT
+    mJit.setThreshold(executions);
+#else
+    (void)executions;
+#endif
+}
+
+#ifdef BLISSX_JIT
+VirtualMachine::InterpretResult VirtualMachine::runNative(const JitCode& code)
+{
+    JitCode::Exit exit = code.run(mStack + 1, mInputs, mGlobals);
+    mStackTop = mStack + 1 + exit.depth;
+    mInstructionPointer = mChunk->beginOfCode() + exit.offset;
+    if (*mInstructionPointer == Chunk::Op_Return)
+    {
+        return Interpret_Ok;
+    }
+    return run<false, false, false>();
+}
+#endif
+
+#ifdef BLISSX_PROFILE_OPCODES
+OpCodeProfile& VirtualMachine::getOpCodeProfile()
+{
+    return mOpCodeProfile;
+}
+#endif
+
+// Macros used by the instruction handlers (VirtualMachineOps.inl), VM is the running VirtualMachine
+// The instruction pointer and the stack pointer are kept in locals (ip, sp) while running,
+// the members are only synchronized when the VM itself needs them (STORE_STATE / LOAD_STATE)
+#define READ_BYTE() (*ip++)
+#define READ_CONSTANT() (VM.mChunk->getConstant(READ_BYTE()))
+
+#ifdef BLISSX_TOS_CACHING
+
+// The top of the stack is cached in the local 'top', sp points to its home slot which is stale in memory
+// With an empty stack, sp points to mStack[0] which is never part of the stack
+#define STACK_LOCALS Value* sp; Value top
+#define STACK_PARAMETERS Value* sp, Value top
+#define STACK_ARGUMENTS sp, top
+#define PEEK(distance) ((distance) == 0 ? top : sp[-(distance)])
+#define PUSH(value) \
+    do { \
+        Value pushed = (value); \
+        *sp++ = top; \
+        top = pushed; \
+    } while (false)
+#define DROP() (top = *--sp)
+#define REPLACE(value) (top = (value))
+// The slot of a local is counted from the bottom of the stack, it may be the cached top
+#define GET_LOCAL(slot) (VM.mStack + 1 + (slot) == sp ? top : VM.mStack[1 + (slot)])
+// The verifier proved the slot is below the top
+#define SET_LOCAL(slot, value) (VM.mStack[1 + (slot)] = (value))
+// Spills the cached top, then points to the first of the count values on top of the stack
+#define ARGUMENTS(count) (*sp = top, sp + 1 - (count))
+// Only valid after ARGUMENTS, the new top is read back from memory
+#define DROP_ARGUMENTS(count) (sp -= (count), top = *sp)
+#define LOAD_STATE() \
+    do { \
+        ip = VM.mInstructionPointer; \
+        sp = VM.mStackTop - 1; \
+        top = *sp; \
+    } while (false)
+#define STORE_STATE() \
+    do { \
+        *sp = top; \
+        VM.mStackTop = sp + 1; \
+        VM.mInstructionPointer = ip; \
+    } while (false)
+
+#else
+
+#define STACK_LOCALS Value* sp
+#define STACK_PARAMETERS Value* sp
+#define STACK_ARGUMENTS sp
+#define PEEK(distance) (sp[-1 - (distance)])
+#define PUSH(value) (*sp++ = (value))
+#define DROP() (--sp)
+#define REPLACE(value) (sp[-1] = (value))
+#define GET_LOCAL(slot) (VM.mStack[1 + (slot)])
+#define SET_LOCAL(slot, value) (VM.mStack[1 + (slot)] = (value))
+#define ARGUMENTS(count) (sp - (count))
+#define DROP_ARGUMENTS(count) (sp -= (count))
+#define LOAD_STATE() \
+    do { \
+        ip = VM.mInstructionPointer; \
+        sp = VM.mStackTop; \
+    } while (false)
+#define STORE_STATE() \
+    do { \
+        VM.mStackTop = sp; \
+        VM.mInstructionPointer = ip; \
+    } while (false)
+
+#endif // BLISSX_TOS_CACHING
+
+#define RUNTIME_ERROR(...) \
+    do { \
+        STORE_STATE(); \
+        VM.runtimeError(__VA_ARGS__); \
+        return Interpret_RuntimeError; \
+    } while (false)
+// Integer fast path of the arithmetic : operations overflowing 64 bits are done again on doubles
+// Mixed integer / double operations are done on doubles
+#define ARITHMETIC_OP(op, checkedOp) \
+    do { \
+        Value right = PEEK(0); \
+        Value left = PEEK(1); \
+        if (left.isInteger() && right.isInteger()) \
+        { \
+            std::int64_t result; \
+            if (!checkedOp(left.asInteger(), right.asInteger(), &result)) \
             { \
-                runtimeError("Operands must be numbers."); \
-                return Interpret_RuntimeError; \
+                DROP(); \
+                REPLACE(Value(result)); \
+                break; \
             } \
-            double b = pop().asNumber(); \
-            double a = pop().asNumber(); \
-            push(Value(a op b)); \
-        } while(false)
+        } \
+        else if (!left.isNumber() || !right.isNumber()) \
+        { \
+            RUNTIME_ERROR("Operands must be numbers."); \
+        } \
+        double b = right.asNumber(); \
+        double a = left.asNumber(); \
+        DROP(); \
+        REPLACE(Value(a op b)); \
+    } while (false)
+#define COMPARISON_OP(op) \
+    do { \
+        Value right = PEEK(0); \
+        Value left = PEEK(1); \
+        bool result; \
+        if (left.isInteger() && right.isInteger()) \
+        { \
+            result = left.asInteger() op right.asInteger(); \
+        } \
+        else if (left.isDouble() && right.isDouble()) \
+        { \
+            result = left.asDouble() op right.asDouble(); \
+        } \
+        else if (left.isInteger() && right.isDouble()) \
+        { \
+            result = Arithmetic::compareMixed(left.asInteger(), right.asDouble()) op 0.0; \
+        } \
+        else if (left.isDouble() && right.isInteger()) \
+        { \
+            result = 0.0 op Arithmetic::compareMixed(right.asInteger(), left.asDouble()); \
+        } \
+        else \
+        { \
+            RUNTIME_ERROR("Operands must be numbers."); \
+        } \
+        DROP(); \
+        REPLACE(Value(result)); \
+    } while (false)
+
+// Unchecked variants, the verifier proved the operands are numbers (see TypeInference)
+#define NUMBER_OP(op, checkedOp) \
+    do { \
+        Value right = PEEK(0); \
+        Value left = PEEK(1); \
+        if (left.isInteger() && right.isInteger()) \
+        { \
+            std::int64_t result; \
+            if (!checkedOp(left.asInteger(), right.asInteger(), &result)) \
+            { \
+                DROP(); \
+                REPLACE(Value(result)); \
+                break; \
+            } \
+        } \
+        double b = right.asNumber(); \
+        double a = left.asNumber(); \
+        DROP(); \
+        REPLACE(Value(a op b)); \
+    } while (false)
+// At least one double : never on integers
+#define DOUBLE_OP(op) \
+    do { \
+        double b = PEEK(0).asNumber(); \
+        double a = PEEK(1).asNumber(); \
+        DROP(); \
+        REPLACE(Value(a op b)); \
+    } while (false)
+#define NUMBER_COMPARISON_OP(op) \
+    do { \
+        Value right = PEEK(0); \
+        Value left = PEEK(1); \
+        bool result; \
+        if (left.isInteger()) \
+        { \
+            result = right.isInteger() ? left.asInteger() op right.asInteger() : Arithmetic::compareMixed(left.asInteger(), right.asDouble()) op 0.0; \
+        } \
+        else \
+        { \
+            result = right.isDouble() ? left.asDouble() op right.asDouble() : 0.0 op Arithmetic::compareMixed(right.asInteger(), left.asDouble()); \
+        } \
+        DROP(); \
+        REPLACE(Value(result)); \
+    } while (false)
+
+// Traced is a template parameter of the running instantiation, the untraced one has no trace code at all
+#define TRACE_INSTRUCTION() \
+    do { \
+        if constexpr (Traced) \
+        { \
+            STORE_STATE(); \
+            VM.traceInstruction(); \
+        } \
+    } while (false)
+
+// ip points to the opcode of the next instruction
+#ifdef BLISSX_PROFILE_OPCODES
+    #define PROFILE_INSTRUCTION() VM.mOpCodeProfile.record(*ip)
+#else
+    #define PROFILE_INSTRUCTION() do { } while (false)
+#endif
+
+// Sampled is the other template parameter, the unsampled instantiations have no profiling code at all
+#define SAMPLE_INSTRUCTION() \
+    do { \
+        if constexpr (Sampled) \
+        { \
+            if (VM.mLineProfiler->shouldSample()) \
+            { \
+                VM.mLineProfiler->sample(*VM.mChunk, ip - VM.mChunk->beginOfCode()); \
+            } \
+        } \
+    } while (false)
+
+// Budgeted is the last template parameter : once the budget is spent, the state is stored with ip on the next opcode
+// and resume starts again from it. The countdown is post-decremented so a budget of N runs exactly N instructions
+#define BUDGET_INSTRUCTION() \
+    do { \
+        if constexpr (Budgeted) \
+        { \
+            if (VM.mBudgetCountdown-- == 0 && VM.budgetSpent()) \
+            { \
+                STORE_STATE(); \
+                return Interpret_Yield; \
+            } \
+        } \
+    } while (false)
+
+// Everything done before dispatching an instruction, the budget first so a resumed instruction is profiled and traced once
+#define BEFORE_INSTRUCTION() \
+    do { \
+        BUDGET_INSTRUCTION(); \
+        PROFILE_INSTRUCTION(); \
+        SAMPLE_INSTRUCTION(); \
+        TRACE_INSTRUCTION(); \
+    } while (false)
+
+#if defined(BLISSX_DISPATCH_TAIL_CALL)
+
+#if defined(__has_cpp_attribute) && __has_cpp_attribute(clang::musttail)
+    #define BLISSX_MUSTTAIL [[clang::musttail]]
+#elif defined(__has_cpp_attribute) && __has_cpp_attribute(gnu::musttail)
+    #define BLISSX_MUSTTAIL [[gnu::musttail]]
+#else
+    #error "BLISSX_DISPATCH_TAIL_CALL requires a compiler supporting guaranteed tail calls (musttail)"
+#endif
+
+// One function per instruction, each one ends by jumping (guaranteed tail call) into the handler of the next instruction
+// The interpreter state is passed in registers as the handler arguments
+template <bool Traced, bool Sampled, bool Budgeted>
+struct VirtualMachine::Handlers
+{
+    typedef InterpretResult (*Handler)(VirtualMachine& vm, const std::uint8_t* ip, STACK_PARAMETERS);
+
+    static const Handler table[];
+
+    #define VM vm
+    #define HANDLER(name) static InterpretResult Handle##name(VirtualMachine& vm, const std::uint8_t* ip, STACK_PARAMETERS)
+    #define NEXT() \
+        do { \
+            BEFORE_INSTRUCTION(); \
+            std::uint8_t instruction = READ_BYTE(); \
+            BLISSX_MUSTTAIL return table[instruction](vm, ip, STACK_ARGUMENTS); \
+        } while (false)
+
+    #include "VirtualMachineOps.inl"
+
+    #undef NEXT
+    #undef HANDLER
+    #undef VM
+};
+
+template <bool Traced, bool Sampled, bool Budgeted>
+const typename VirtualMachine::Handlers<Traced, Sampled, Budgeted>::Handler VirtualMachine::Handlers<Traced, Sampled, Budgeted>::table[] = {
+    #define BLISSX_OPCODE_HANDLER(name, format, pops, pushes) &VirtualMachine::Handlers<Traced, Sampled, Budgeted>::Handle##name,
+    BLISSX_OPCODES(BLISSX_OPCODE_HANDLER)
+    #undef BLISSX_OPCODE_HANDLER
+};
+
+template <bool Traced, bool Sampled, bool Budgeted>
+VirtualMachine::InterpretResult VirtualMachine::run()
+{
+    #define VM (*this)
+    const std::uint8_t* ip;
+    STACK_LOCALS;
+    LOAD_STATE();
+
+    BEFORE_INSTRUCTION();
+    std::uint8_t instruction = READ_BYTE();
+    return Handlers<Traced, Sampled, Budgeted>::table[instruction](*this, ip, STACK_ARGUMENTS);
+    #undef VM
+}
+
+#elif defined(BLISSX_DISPATCH_COMPUTED_GOTO)
+
+// Every handler ends with its own indirect jump, which gives the branch predictor one jump per instruction to learn from
+template <bool Traced, bool Sampled, bool Budgeted>
+VirtualMachine::InterpretResult VirtualMachine::run()
+{
+    static void* const dispatchTable[] = {
+        #define BLISSX_OPCODE_LABEL(name, format, pops, pushes) &&Label_##name,
+        BLISSX_OPCODES(BLISSX_OPCODE_LABEL)
+        #undef BLISSX_OPCODE_LABEL
+    };
+
+    #define VM (*this)
+    #define HANDLER(name) Label_##name:
+    #define NEXT() \
+        do { \
+            BEFORE_INSTRUCTION(); \
+            goto *dispatchTable[READ_BYTE()]; \
+        } while (false)
+
+    const std::uint8_t* ip;
+    STACK_LOCALS;
+    LOAD_STATE();
+
+    NEXT();
+
+    #include "VirtualMachineOps.inl"
+
+    #undef NEXT
+    #undef HANDLER
+    #undef VM
+}
+
+#else // BLISSX_DISPATCH_SWITCH
+
+template <bool Traced, bool Sampled, bool Budgeted>
+VirtualMachine::InterpretResult VirtualMachine::run()
+{
+    #define VM (*this)
+    #define HANDLER(name) case Chunk::Op_##name:
+    #define NEXT() continue
+
+    const std::uint8_t* ip;
+    STACK_LOCALS;
+    LOAD_STATE();
 
     for(;;)
     {
-        #ifdef DEBUG_TRACE_EXECUTION
-            printf("          ");
-            for (Value* slot = mStack; slot < mStackTop; slot++)
-            {
-                printf("[ ");
-                Debug::printValue(*slot);
-                printf(" ]");
-            }
-            printf("\n");
-            Debug::disassembleInstruction(*mChunk, (int)(mInstructionPointer - mChunk->beginOfCode()));
-        #endif
-
-        uint8_t instruction;
-        switch (instruction = READ_BYTE())
+        BEFORE_INSTRUCTION();
+
+        switch (READ_BYTE())
         {
-            case Chunk::Op_Constant: push(READ_CONSTANT()); break;
-            case Chunk::Op_Null: push(Value()); break;
-            case Chunk::Op_True: push(Value(true)); break;
-            case Chunk::Op_False: push(Value(false)); break;
-            case Chunk::Op_Equal: push(Value(pop().isEquals(pop()))); break;
-            case Chunk::Op_BangEqual: push(Value(!pop().isEquals(pop()))); break;
-            case Chunk::Op_Greater: BINARY_OP(>); break;
-            case Chunk::Op_GreaterEqual: BINARY_OP(>=); break;
-            case Chunk::Op_Less: BINARY_OP(<); break;
-            case Chunk::Op_LessEqual: BINARY_OP(<=); break;
-            case Chunk::Op_Add:
-            {
-                if (peek(0).isString() && peek(1).isString())
-                {
-                    concatenate();
-                }
-                else if (peek(0).isNumber() && peek(1).isNumber())
-                {
-                    push(Value(pop().asNumber() + pop().asNumber()));
-                }
-                else
-                {
-                    runtimeError("Operands must be two numbers or two strings.");
-                    return Interpret_RuntimeError;
-                }
-                break;
-            }
-            case Chunk::Op_Substract: BINARY_OP(-); break;
-            case Chunk::Op_Multiply: BINARY_OP(*); break;
-            case Chunk::Op_Divide: BINARY_OP(/); break;
-            case Chunk::Op_Not: push(Value(pop().isFalsey())); break;
-            case Chunk::Op_Negate:
-                if (!peek(0).isNumber())
-                {
-                    runtimeError("Operand must be a number.");
-                    return Interpret_RuntimeError;
-                }
-                push(Value(-pop().asNumber()));
-                break;
-            case Chunk::Op_Return:
-            {
-                Debug::printValue(pop());
-                printf("\n");
-                return Interpret_Ok;
-            }
+            #include "VirtualMachineOps.inl"
         }
     }
 
-    #undef BINARY_OP
-    #undef READ_CONSTANT
-    #undef READ_BYTE
+    #undef NEXT
+    #undef HANDLER
+    #undef VM
 }
 
-void VirtualMachine::concatenate()
+#endif // BLISSX_DISPATCH_SWITCH
+
+#undef BEFORE_INSTRUCTION
+#undef BUDGET_INSTRUCTION
+#undef SAMPLE_INSTRUCTION
+#undef PROFILE_INSTRUCTION
+#undef TRACE_INSTRUCTION
+#undef NUMBER_COMPARISON_OP
+#undef DOUBLE_OP
+#undef NUMBER_OP
+#undef COMPARISON_OP
+#undef ARITHMETIC_OP
+#undef RUNTIME_ERROR
+#undef STORE_STATE
+#undef LOAD_STATE
+#undef DROP_ARGUMENTS
+#undef ARGUMENTS
+#undef REPLACE
+#undef DROP
+#undef PUSH
+#undef PEEK
+#undef STACK_ARGUMENTS
+#undef STACK_PARAMETERS
+#undef STACK_LOCALS
+#undef READ_CONSTANT
+#undef READ_BYTE
+
+void VirtualMachine::traceInstruction()
 {
-    ObjString* b = pop().asString();
-    ObjString* a = pop().asString();
+    mTraceSink->write("          ");
+    for (Value* slot = mStack + 1; slot < mStackTop; slot++)
+    {
+        mTraceSink->write("[ ");
+        Debug::printValue(*slot, *mTraceSink);
+        mTraceSink->write(" ]");
+    }
+    mTraceSink->write("\n");
+    Debug::disassembleInstruction(*mChunk, mInstructionPointer - mChunk->beginOfCode(), *mTraceSink);
+}
 
+ObjString* VirtualMachine::concatenate(ObjString* a, ObjString* b)
+{
     int length = a->length + b->length;
     char* chars = MEMORY_ALLOCATE(char, length + 1);
     memcpy(chars, a->chars, a->length);
     memcpy(chars + a->length, b->chars, b->length);
     chars[length] = '\0';
 
-    push(Value((Obj*)ObjString::takeString(chars, length)));
-}
-
-Value VirtualMachine::peek(int distance)
-{
-    return mStackTop[-1 - distance];
+    return ObjString::takeString(mHeap, chars, length);
 }
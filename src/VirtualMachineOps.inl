@@ -0,0 +1,288 @@
+// Instruction handlers of VirtualMachine::run, shared by every dispatch strategy (see VirtualMachine.cpp)
+// There must be one handler per entry of BLISSX_OPCODES, they only use the macros defined by the strategy :
+// HANDLER, NEXT, VM, READ_BYTE, READ_CONSTANT, PEEK, PUSH, DROP, REPLACE, GET_LOCAL, SET_LOCAL, ARGUMENTS, DROP_ARGUMENTS,
+// ARITHMETIC_OP, COMPARISON_OP, NUMBER_OP, DOUBLE_OP, NUMBER_COMPARISON_OP, RUNTIME_ERROR, STORE_STATE
+
+HANDLER(Constant)
+{
+    PUSH(READ_CONSTANT());
+    NEXT();
+}
+
+HANDLER(Null)
+{
+    PUSH(Value());
+    NEXT();
+}
+
+HANDLER(True)
+{
+    PUSH(Value(true));
+    NEXT();
+}
+
+HANDLER(False)
+{
+    PUSH(Value(false));
+    NEXT();
+}
+
+// The verifier recorded the highest slot, execute checked inputs were given
+HANDLER(GetInput)
+{
+    PUSH(VM.mInputs[READ_BYTE()]);
+    NEXT();
+}
+
+// The verifier checked the slot is on the stack
+HANDLER(GetLocal)
+{
+    std::uint8_t slot = READ_BYTE();
+    PUSH(GET_LOCAL(slot));
+    NEXT();
+}
+
+// The assigned value stays on the stack
+HANDLER(SetLocal)
+{
+    std::uint8_t slot = READ_BYTE();
+    SET_LOCAL(slot, PEEK(0));
+    NEXT();
+}
+
+// execute grew the globals to the highest index the verifier recorded
+HANDLER(GetGlobal)
+{
+    PUSH(VM.mGlobals[READ_BYTE()]);
+    NEXT();
+}
+
+// Objects are refused : a global outlives the heap of the VM and the chunk
+HANDLER(SetGlobal)
+{
+    std::uint8_t index = READ_BYTE();
+    if (PEEK(0).isObject())
+    {
+        RUNTIME_ERROR("Only numbers, bools and null can be stored in globals.");
+    }
+    VM.mGlobals[index] = PEEK(0);
+    NEXT();
+}
+
+HANDLER(Pop)
+{
+    DROP();
+    NEXT();
+}
+
+HANDLER(Equal)
+{
+    bool equals = PEEK(1).isEquals(PEEK(0));
+    DROP();
+    REPLACE(Value(equals));
+    NEXT();
+}
+
+HANDLER(BangEqual)
+{
+    bool equals = PEEK(1).isEquals(PEEK(0));
+    DROP();
+    REPLACE(Value(!equals));
+    NEXT();
+}
+
+HANDLER(Greater)
+{
+    COMPARISON_OP(>);
+    NEXT();
+}
+
+HANDLER(GreaterEqual)
+{
+    COMPARISON_OP(>=);
+    NEXT();
+}
+
+HANDLER(Less)
+{
+    COMPARISON_OP(<);
+    NEXT();
+}
+
+HANDLER(LessEqual)
+{
+    COMPARISON_OP(<=);
+    NEXT();
+}
+
+HANDLER(Add)
+{
+    if (PEEK(0).isString() && PEEK(1).isString())
+    {
+        ObjString* b = PEEK(0).asString();
+        ObjString* a = PEEK(1).asString();
+        DROP();
+        REPLACE(Value((Obj*)VM.concatenate(a, b)));
+    }
+    else if (PEEK(0).isNumber() && PEEK(1).isNumber())
+    {
+        ARITHMETIC_OP(+, Arithmetic::checkedAdd);
+    }
+    else
+    {
+        RUNTIME_ERROR("Operands must be two numbers or two strings.");
+    }
+    NEXT();
+}
+
+HANDLER(Substract)
+{
+    ARITHMETIC_OP(-, Arithmetic::checkedSubstract);
+    NEXT();
+}
+
+HANDLER(Multiply)
+{
+    ARITHMETIC_OP(*, Arithmetic::checkedMultiply);
+    NEXT();
+}
+
+HANDLER(Divide)
+{
+    ARITHMETIC_OP(/, Arithmetic::checkedDivide);
+    NEXT();
+}
+
+HANDLER(Not)
+{
+    REPLACE(Value(PEEK(0).isFalsey()));
+    NEXT();
+}
+
+HANDLER(Negate)
+{
+    if (PEEK(0).isInteger() && PEEK(0).asInteger() != INT64_MIN)
+    {
+        REPLACE(Value(-PEEK(0).asInteger()));
+        NEXT();
+    }
+    if (!PEEK(0).isNumber())
+    {
+        RUNTIME_ERROR("Operand must be a number.");
+    }
+    REPLACE(Value(-PEEK(0).asNumber()));
+    NEXT();
+}
+
+// Unchecked variants : the verifier proved the operands are numbers, and for the Double ones that one of them is a double
+
+HANDLER(GreaterNumber)
+{
+    NUMBER_COMPARISON_OP(>);
+    NEXT();
+}
+
+HANDLER(GreaterEqualNumber)
+{
+    NUMBER_COMPARISON_OP(>=);
+    NEXT();
+}
+
+HANDLER(LessNumber)
+{
+    NUMBER_COMPARISON_OP(<);
+    NEXT();
+}
+
+HANDLER(LessEqualNumber)
+{
+    NUMBER_COMPARISON_OP(<=);
+    NEXT();
+}
+
+HANDLER(AddNumber)
+{
+    NUMBER_OP(+, Arithmetic::checkedAdd);
+    NEXT();
+}
+
+HANDLER(SubstractNumber)
+{
+    NUMBER_OP(-, Arithmetic::checkedSubstract);
+    NEXT();
+}
+
+HANDLER(MultiplyNumber)
+{
+    NUMBER_OP(*, Arithmetic::checkedMultiply);
+    NEXT();
+}
+
+HANDLER(DivideNumber)
+{
+    NUMBER_OP(/, Arithmetic::checkedDivide);
+    NEXT();
+}
+
+HANDLER(NegateNumber)
+{
+    if (PEEK(0).isInteger() && PEEK(0).asInteger() != INT64_MIN)
+    {
+        REPLACE(Value(-PEEK(0).asInteger()));
+        NEXT();
+    }
+    REPLACE(Value(-PEEK(0).asNumber()));
+    NEXT();
+}
+
+HANDLER(AddDouble)
+{
+    DOUBLE_OP(+);
+    NEXT();
+}
+
+HANDLER(SubstractDouble)
+{
+    DOUBLE_OP(-);
+    NEXT();
+}
+
+HANDLER(MultiplyDouble)
+{
+    DOUBLE_OP(*);
+    NEXT();
+}
+
+HANDLER(DivideDouble)
+{
+    DOUBLE_OP(/);
+    NEXT();
+}
+
+HANDLER(NegateDouble)
+{
+    REPLACE(Value(-PEEK(0).asDouble()));
+    NEXT();
+}
+
+// The verifier checked the constant is a native function taking this argument count
+HANDLER(CallNative)
+{
+    const ObjNative* native = READ_CONSTANT().asNative();
+    std::uint8_t argumentCount = READ_BYTE();
+    Value result;
+    if (!native->thunk(native->function, ARGUMENTS(argumentCount), &result))
+    {
+        RUNTIME_ERROR("Invalid argument types for native function '%s'.", native->name->chars);
+    }
+    DROP_ARGUMENTS(argumentCount);
+    PUSH(result);
+    NEXT();
+}
+
+// The result stays on the stack, it is popped by execute
+HANDLER(Return)
+{
+    STORE_STATE();
+    return Interpret_Ok;
+}
@@ -0,0 +1,443 @@
+#include "X64Assembler.hpp"
+
+X64Assembler::X64Assembler()
+    : mCode(nullptr)
+    , mCount(0)
+    , mCapacity(0)
+    , mLabels(nullptr)
+    , mLabelCount(0)
+    , mLabelCapacity(0)
+    , mFixups(nullptr)
+    , mFixupCount(0)
+    , mFixupCapacity(0)
+{
+}
+
+X64Assembler::~X64Assembler()
+{
+    MEMORY_FREE_ARRAY(std::uint8_t, mCode, mCapacity);
+    MEMORY_FREE_ARRAY(std::int64_t, mLabels, mLabelCapacity);
+    MEMORY_FREE_ARRAY(Fixup, mFixups, mFixupCapacity);
+}
+
+const std::uint8_t* X64Assembler::code() const
+{
+    return mCode;
+}
+
+std::size_t X64Assembler::size() const
+{
+    return mCount;
+}
+
+void X64Assembler::clear()
+{
+    mCount = 0;
+    mLabelCount = 0;
+    mFixupCount = 0;
+}
+
+X64Assembler::Label X64Assembler::newLabel()
+{
+    if (mLabelCapacity < mLabelCount + 1)
+    {
+        std::size_t capacity = MEMORY_GROW_CAPACITY(mLabelCapacity);
+        mLabels = MEMORY_GROW_ARRAY(mLabels, std::int64_t, mLabelCapacity, capacity);
+        mLabelCapacity = capacity;
+    }
+    mLabels[mLabelCount] = -1;
+    return (Label)mLabelCount++;
+}
+
+void X64Assembler::bind(Label label)
+{
+    mLabels[label] = (std::int64_t)mCount;
+}
+
+void X64Assembler::jump(Label label)
+{
+    byte(0xE9);
+    if (mFixupCapacity < mFixupCount + 1)
+    {
+        std::size_t capacity = MEMORY_GROW_CAPACITY(mFixupCapacity);
+        mFixups = MEMORY_GROW_ARRAY(mFixups, Fixup, mFixupCapacity, capacity);
+        mFixupCapacity = capacity;
+    }
+    mFixups[mFixupCount++] = { mCount, label };
+    int32(0);
+}
+
+void X64Assembler::jump(Condition condition, Label label)
+{
+    byte(0x0F);
+    // 0F 80+cc is jcc rel32, the E9 written by jump is replaced
+    jump(label);
+    mCode[mCount - 5] = (std::uint8_t)(0x80 + condition);
+}
+
+bool X64Assembler::resolve()
+{
+    for (std::size_t i = 0; i < mFixupCount; i++)
+    {
+        std::int64_t target = mLabels[mFixups[i].label];
+        if (target < 0)
+        {
+            return false;
+        }
+        std::int32_t relative = (std::int32_t)(target - (std::int64_t)(mFixups[i].position + 4));
+        memcpy(mCode + mFixups[i].position, &relative, sizeof(relative));
+    }
+    return true;
+}
+
+void X64Assembler::push(Register reg)
+{
+    rex(false, 0, reg);
+    byte(0x50 + (reg & 7));
+}
+
+void X64Assembler::pop(Register reg)
+{
+    rex(false, 0, reg);
+    byte(0x58 + (reg & 7));
+}
+
+void X64Assembler::ret()
+{
+    byte(0xC3);
+}
+
+void X64Assembler::call(Register reg)
+{
+    rex(false, 0, reg);
+    byte(0xFF);
+    registers(2, reg);
+}
+
+void X64Assembler::mov(Register destination, Register source)
+{
+    rex(true, source, destination);
+    byte(0x89);
+    registers(source, destination);
+}
+
+void X64Assembler::movImmediate(Register destination, std::uint64_t immediate)
+{
+    rex(true, 0, destination);
+    byte(0xB8 + (destination & 7));
+    for (int i = 0; i < 8; i++)
+    {
+        byte((std::uint8_t)(immediate >> (8 * i)));
+    }
+}
+
+void X64Assembler::load(Register destination, Register base, std::int32_t displacement)
+{
+    rex(true, destination, base);
+    byte(0x8B);
+    memory(destination, base, displacement);
+}
+
+void X64Assembler::store(Register base, std::int32_t displacement, Register source)
+{
+    rex(true, source, base);
+    byte(0x89);
+    memory(source, base, displacement);
+}
+
+void X64Assembler::lea(Register destination, Register base, std::int32_t displacement)
+{
+    rex(true, destination, base);
+    byte(0x8D);
+    memory(destination, base, displacement);
+}
+
+void X64Assembler::alu(AluOperation operation, Register destination, Register source)
+{
+    rex(true, source, destination);
+    byte((std::uint8_t)operation);
+    registers(source, destination);
+}
+
+void X64Assembler::compare(Register left, Register base, std::int32_t displacement)
+{
+    rex(true, left, base);
+    byte(0x3B);
+    memory(left, base, displacement);
+}
+
+void X64Assembler::addImmediate(Register destination, std::int8_t immediate)
+{
+    rex(true, 0, destination);
+    byte(0x83);
+    registers(0, destination);
+    byte((std::uint8_t)immediate);
+}
+
+void X64Assembler::compareImmediate(Register reg, std::int8_t immediate)
+{
+    rex(true, 0, reg);
+    byte(0x83);
+    registers(7, reg);
+    byte((std::uint8_t)immediate);
+}
+
+void X64Assembler::imul(Register destination, Register source)
+{
+    rex(true, destination, source);
+    byte(0x0F);
+    byte(0xAF);
+    registers(destination, source);
+}
+
+void X64Assembler::neg(Register reg)
+{
+    rex(true, 0, reg);
+    byte(0xF7);
+    registers(3, reg);
+}
+
+void X64Assembler::cqo()
+{
+    byte(0x48);
+    byte(0x99);
+}
+
+void X64Assembler::idiv(Register divisor)
+{
+    rex(true, 0, divisor);
+    byte(0xF7);
+    registers(7, divisor);
+}
+
+// btc reg, 63
+void X64Assembler::flipSign(Register reg)
+{
+    rex(true, 0, reg);
+    byte(0x0F);
+    byte(0xBA);
+    registers(7, reg);
+    byte(63);
+}
+
+void X64Assembler::load32(Register destination, Register base, std::int32_t displacement)
+{
+    rex(false, destination, base);
+    byte(0x8B);
+    memory(destination, base, displacement);
+}
+
+void X64Assembler::store32(Register base, std::int32_t displacement, Register source)
+{
+    rex(false, source, base);
+    byte(0x89);
+    memory(source, base, displacement);
+}
+
+void X64Assembler::store32Immediate(Register base, std::int32_t displacement, std::int32_t immediate)
+{
+    rex(false, 0, base);
+    byte(0xC7);
+    memory(0, base, displacement);
+    int32(immediate);
+}
+
+void X64Assembler::compare32Immediate(Register base, std::int32_t displacement, std::int32_t immediate)
+{
+    rex(false, 0, base);
+    byte(0x81);
+    memory(7, base, displacement);
+    int32(immediate);
+}
+
+void X64Assembler::compare32Immediate(Register reg, std::int32_t immediate)
+{
+    rex(false, 0, reg);
+    byte(0x81);
+    registers(7, reg);
+    int32(immediate);
+}
+
+void X64Assembler::compare32(Register left, Register right)
+{
+    rex(false, right, left);
+    byte(0x39);
+    registers(right, left);
+}
+
+// movzx r32, byte [base + displacement]
+void X64Assembler::loadByte(Register destination, Register base, std::int32_t displacement)
+{
+    rex(false, destination, base);
+    byte(0x0F);
+    byte(0xB6);
+    memory(destination, base, displacement);
+}
+
+// Only al, cl, dl and bl : the other byte registers would need a REX prefix
+void X64Assembler::setByte(Condition condition, Register destination)
+{
+    byte(0x0F);
+    byte((std::uint8_t)(0x90 + condition));
+    registers(0, destination);
+}
+
+// movzx r32, r8
+void X64Assembler::zeroExtendByte(Register reg)
+{
+    byte(0x0F);
+    byte(0xB6);
+    registers(reg, reg);
+}
+
+// The 8 bits forms of the ALU operations are the 64 bits opcodes minus one
+void X64Assembler::alu8(AluOperation operation, Register destination, Register source)
+{
+    byte((std::uint8_t)(operation - 1));
+    registers(source, destination);
+}
+
+void X64Assembler::xor8Immediate(Register destination, std::uint8_t immediate)
+{
+    byte(0x80);
+    registers(6, destination);
+    byte(immediate);
+}
+
+void X64Assembler::test8(Register reg)
+{
+    byte(0x84);
+    registers(reg, reg);
+}
+
+void X64Assembler::movByteImmediate(Register destination, std::uint8_t immediate)
+{
+    byte(0xB0 + (destination & 7));
+    byte(immediate);
+}
+
+void X64Assembler::loadDouble(Xmm destination, Register base, std::int32_t displacement)
+{
+    byte(0xF2);
+    rex(false, destination, base);
+    byte(0x0F);
+    byte(0x10);
+    memory(destination, base, displacement);
+}
+
+void X64Assembler::storeDouble(Register base, std::int32_t displacement, Xmm source)
+{
+    byte(0xF2);
+    rex(false, source, base);
+    byte(0x0F);
+    byte(0x11);
+    memory(source, base, displacement);
+}
+
+void X64Assembler::sse(SseOperation operation, Xmm destination, Xmm source)
+{
+    byte(0xF2);
+    byte(0x0F);
+    byte((std::uint8_t)operation);
+    registers(destination, source);
+}
+
+void X64Assembler::ucomisd(Xmm left, Xmm right)
+{
+    byte(0x66);
+    byte(0x0F);
+    byte(0x2E);
+    registers(left, right);
+}
+
+// cvtsi2sd xmm, qword [base + displacement]
+void X64Assembler::convertInteger(Xmm destination, Register base, std::int32_t displacement)
+{
+    byte(0xF2);
+    rex(true, destination, base);
+    byte(0x0F);
+    byte(0x2A);
+    memory(destination, base, displacement);
+}
+
+void X64Assembler::convertInteger(Xmm destination, Register source)
+{
+    byte(0xF2);
+    rex(true, destination, source);
+    byte(0x0F);
+    byte(0x2A);
+    registers(destination, source);
+}
+
+// cvttsd2si, out of range and NaN give INT64_MIN
+void X64Assembler::truncateDouble(Register destination, Xmm source)
+{
+    byte(0xF2);
+    rex(true, destination, source);
+    byte(0x0F);
+    byte(0x2C);
+    registers(destination, source);
+}
+
+void X64Assembler::loadValue(Xmm destination, Register base, std::int32_t displacement)
+{
+    byte(0xF3);
+    rex(false, destination, base);
+    byte(0x0F);
+    byte(0x6F);
+    memory(destination, base, displacement);
+}
+
+void X64Assembler::storeValue(Register base, std::int32_t displacement, Xmm source)
+{
+    byte(0xF3);
+    rex(false, source, base);
+    byte(0x0F);
+    byte(0x7F);
+    memory(source, base, displacement);
+}
+
+void X64Assembler::byte(std::uint8_t value)
+{
+    if (mCapacity < mCount + 1)
+    {
+        std::size_t capacity = MEMORY_GROW_CAPACITY(mCapacity);
+        mCode = MEMORY_GROW_ARRAY(mCode, std::uint8_t, mCapacity, capacity);
+        mCapacity = capacity;
+    }
+    mCode[mCount++] = value;
+}
+
+void X64Assembler::int32(std::int32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        byte((std::uint8_t)((std::uint32_t)value >> (8 * i)));
+    }
+}
+
+// Only written when needed : 64 bits operand, or one of r8-r15 in the reg or base field
+void X64Assembler::rex(bool wide, int reg, int base)
+{
+    std::uint8_t prefix = 0x40 | (wide ? 0x08 : 0) | ((reg & 8) ? 0x04 : 0) | ((base & 8) ? 0x01 : 0);
+    if (prefix != 0x40)
+    {
+        byte(prefix);
+    }
+}
+
+// [base + disp32], rsp and r12 as base need a SIB byte
+void X64Assembler::memory(int reg, Register base, std::int32_t displacement)
+{
+    byte((std::uint8_t)(0x80 | ((reg & 7) << 3) | (base & 7)));
+    if ((base & 7) == RSP)
+    {
+        byte(0x24);
+    }
+    int32(displacement);
+}
+
+void X64Assembler::registers(int reg, int rm)
+{
+    byte((std::uint8_t)(0xC0 | ((reg & 7) << 3) | (rm & 7)));
+}